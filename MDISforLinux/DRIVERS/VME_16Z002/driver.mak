@@ -27,9 +27,11 @@ MAK_NAME=vme4l-core
 
 MAK_LIBS=
 
-MAK_SWITCH = -DEXPORT_SYMTAB
+# vme4l-trace.h is included by <trace/define_trace.h> from this directory
+MAK_SWITCH = -DEXPORT_SYMTAB -I$(MEN_MOD_DIR)
 
 MAK_INCL=$(MEN_MOD_DIR)/vme4l-core.h \
+		 $(MEN_MOD_DIR)/vme4l-trace.h \
 		 $(MEN_INC_DIR)/../../NATIVE/MEN/vme4l.h \
 		 $(MEN_INC_DIR)/../../NATIVE/MEN/vme4l_old.h \
 		 $(MEN_INC_DIR)/../../NATIVE/MEN/men_vme_kernelif.h
@@ -0,0 +1,37 @@
+#**************************  M a k e f i l e ********************************
+#  
+#          $Date$
+#      $Revision$
+#  
+#    Description: makefile descriptor for VME4L bridge simulator
+#                      
+#-----------------------------------------------------------------------------
+#   Copyright (c) 2003-2019, MEN Mikro Elektronik GmbH
+#*****************************************************************************
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+MAK_NAME=vme4l-sim
+
+MAK_LIBS=
+
+MAK_INCL=$(MEN_MOD_DIR)/vme4l-core.h \
+		 $(MEN_INC_DIR)/../../NATIVE/MEN/vme4l.h \
+		 $(MEN_INC_DIR)/../../NATIVE/MEN/men_vme_kernelif.h
+
+MAK_INP1=vme4l-sim$(INP_SUFFIX)
+
+MAK_INP=$(MAK_INP1)
+
+WARN_LEVEL := -Wall
@@ -36,6 +36,16 @@
  */
 #include "vme4l-core.h"
 #include <linux/seq_file.h>
+#include <linux/interval_tree_generic.h>
+#include <linux/rculist.h>
+#include <linux/eventfd.h>
+#include <linux/poll.h>
+#include <linux/math64.h>
+#include <linux/percpu.h>
+#include <linux/u64_stats_sync.h>
+
+#define CREATE_TRACE_POINTS
+#include "vme4l-trace.h"
 
 /*--------------------------------------+
 |   DEFINES                             |
@@ -50,20 +60,69 @@
 /* if defined, start of user data from dma transfers is dumped */
 #undef VME4L_DBG_DMA_DATA
 
-/** max number of VME/PCI master address windows */
+/** default number of VME/PCI master address windows (max_adrs_wins) */
 #define VME4L_MAX_ADRS_WINS		16
 
-/** max number of ioremap-cached regions */
+/** default number of ioremap-cached regions (ioremap_cache_size) */
 #define VME4L_MAX_IOREMAP_CACHE	16
 
+/** root of an interval tree of windows or ioremap regions */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,14,0)
+# define VME4L_IT_ROOT			struct rb_root_cached
+# define VME4L_IT_ROOT_INIT		RB_ROOT_CACHED
+#else
+# define VME4L_IT_ROOT			struct rb_root
+# define VME4L_IT_ROOT_INIT		RB_ROOT
+#endif
+
+/** max number of DMA channels per bridge */
+#define VME4L_MAX_DMA_CHANNELS	2
+
+/** max time to wait for the DMA interrupt of a polled DMA (ms) */
+#define VME4L_DMA_STALE_IRQ_MS	10
+
+/** vme4l_zc_buf_map() direction: map for reads and writes */
+#define VME4L_ZC_BIDIR			(-1)
+
+/** vme4l_zc_buf_map() flag: buffer stays pinned after the call returns */
+#define VME4L_ZC_LONGTERM		0x40000000
+
+/* pin_user_pages() for DMA pins, FOLL_LONGTERM for registered buffers */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,6,0)
+# define VME4L_PIN_USER_PAGES
+#endif
+
+/** entries per VME level in the deferred interrupt ring */
+#define VME4L_IRQ_RING_LEN		64
+
+/** default per-level budget of the interrupt thread (irq_budget) */
+#define VME4L_IRQ_LEV_BUDGET	32
+
+/** max. bytes per readPioBlock/writePioBlock call */
+#define VME4L_PIO_BLOCK_CHUNK	256
+
+/** scatter elements of a VME4L_IO_RW_PINNED transfer kept on stack */
+#define VME4L_PINBUF_SG_STACK	20
+
+/** interrupt latency histogram buckets: <1us, <2us, <4us ... >=16ms */
+#define VME4L_LAT_BUCKETS		16
+
+/* interrupt path stages measured per level (G_latLev) */
+#define VME4L_LAT_IRQ			0	/**< bridge irq entry -> dispatch */
+#define VME4L_LAT_DLV			1	/**< dispatch -> handlers/events done */
+#define VME4L_LAT_USER			2	/**< bridge irq entry -> read() */
+#define VME4L_LAT_STAGES		3
+
 /** VME4L_IRQ_ENTRY.flags for old VME4L compat. */
 #define VME4L_IRQ_OLDHANDLER	0x8000
 
 /* irq entry types */
 #define VME4L_USER_IRQ			0
 #define VME4L_KERNEL_IRQ		1
+#define VME4L_EVENT_IRQ			2
 
-/** locks interrupt vector&level variables */
+/** serializes changes of interrupt vector&level variables.
+ *  vme4l_irq() reads G_vectTbl[] under rcu_read_lock() only */
 #define VME4L_LOCK_VECTORS(ps) 	 spin_lock_irqsave(&G_lockVectTbl, ps)
 #define VME4L_UNLOCK_VECTORS(ps) spin_unlock_irqrestore(&G_lockVectTbl, ps)
 
@@ -71,13 +130,42 @@
 #define VME4L_LOCK_DMA(ps) 		spin_lock_irqsave(&G_lockDma, ps)
 #define VME4L_UNLOCK_DMA(ps) 	spin_unlock_irqrestore(&G_lockDma, ps)
 
+/** update this CPU's statistics. Interrupts are disabled, so updates
+ *  from process, irq thread and hard irq context never nest */
+#define VME4L_STAT_BEGIN(st,ps) \
+	do { local_irq_save(ps); (st) = this_cpu_ptr(G_stats); \
+		 u64_stats_update_begin(&(st)->sync); } while(0)
+#define VME4L_STAT_END(st,ps) \
+	do { u64_stats_update_end(&(st)->sync); local_irq_restore(ps); } while(0)
+#define VME4L_STAT_ADD(field,n) \
+	do { VME4L_PCPU_STATS *_st; unsigned long _ps; \
+		 VME4L_STAT_BEGIN(_st,_ps); _st->s.field += (n); \
+		 VME4L_STAT_END(_st,_ps); } while(0)
+#define VME4L_STAT_INC(field)	VME4L_STAT_ADD(field,1)
+
 /** locks address window lists */
 #define VME4L_LOCK_MSTRLISTS()	spin_lock(&G_lockMstrLists);
 #define VME4L_UNLOCK_MSTRLISTS() spin_unlock(&G_lockMstrLists);
 
+#ifndef READ_ONCE
+# define READ_ONCE(x)		ACCESS_ONCE(x)
+# define WRITE_ONCE(x, v)	(ACCESS_ONCE(x) = (v))
+#endif
+
 /* page remapping changed to remap_pfn_range - use correct page parameter! */
 #define VME4L_REMAP(a,b,c,d,e) remap_pfn_range((a),(b),(c)>>PAGE_SHIFT,(d),(e))
 
+/* slave windows can be mapped by PMD sized PFN faults */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,12,0) && \
+	defined(CONFIG_ARCH_SUPPORTS_PMD_PFNMAP)
+# define VME4L_HUGE_PFNMAP
+# if LINUX_VERSION_CODE >= KERNEL_VERSION(6,17,0)
+#  define VME4L_PMD_PFN(pfn)	(pfn)
+# else
+#  define VME4L_PMD_PFN(pfn)	__pfn_to_pfn_t((pfn), PFN_DEV)
+# endif
+#endif
+
 /* Macros to disable hard irqs. */
 
 /* the spin_lock can safely be used on UP and SMP machines */
@@ -93,15 +181,86 @@
 |   TYPDEFS                             |
 +--------------------------------------*/
 
+/** pinned and DMA mapped buffer of a zero-copy DMA transfer */
+typedef struct {
+	struct page **pages;		/**< pages of buffer */
+	unsigned int nrPages;		/**< number of entries in \a pages */
+	unsigned int nrPinned;		/**< number of pages pinned */
+	struct scatterlist *sgt;	/**< kernel scatter list of contiguous runs */
+	int sgtNents;				/**< number of entries in \a sgt */
+	VME4L_SCATTER_ELEM *sgList;	/**< DMA mapped scatter list */
+	int sgNelems;				/**< number of mapped elements in \a sgList */
+	struct device *pDev;		/**< device the buffer is mapped for */
+	int dmaDir;					/**< DMA_FROM_DEVICE or DMA_TO_DEVICE */
+	int toUser;					/**< buffer is in user space */
+	uint32_t totlen;			/**< total number of bytes in \a sgList */
+} VME4L_ZC_BUF;
+
+/** one VME range of a zero-copy DMA transfer */
+typedef struct {
+	VME4L_SCATTER_ELEM *sgList;	/**< elements not yet set up */
+	int sgNelems;				/**< number of elements in \a sgList */
+	int direction;				/**< 0=read from VME 1=write to VME */
+	vmeaddr_t vmeAddr;			/**< VME address of \a sgList[0] */
+	int flags;					/**< VME4L_RW_xxx flags */
+} VME4L_DMA_SEG;
+
+/** asynchronous DMA request (one per submission queue entry) */
+typedef struct {
+	struct list_head node;		/**< list node within ctx->lstPending */
+	VME4L_ASYNC_SQE sqe;		/**< kernel copy of submission queue entry */
+	VME4L_ZC_BUF zc;			/**< pinned user buffer */
+	int swapMode;				/**< swapping mode at submission time */
+	VME4L_DMA_POLICY dmaPolicy;	/**< DMA policy at submission time */
+} VME4L_ASYNC_REQ;
+
+/** user buffer registered with VME4L_IO_PINBUF_REGISTER */
+typedef struct {
+	VME4L_ZC_BUF zc;			/**< pinned buffer, mapped bidirectional */
+	int useCount;				/**< transfers currently using the buffer */
+} VME4L_PINBUF;
+
+/** asynchronous DMA context, created by VME4L_IO_ASYNC_SETUP */
+typedef struct {
+	VME4L_ASYNC_RING_HDR *hdr;	/**< ring area (vmalloc_user, mapped by user) */
+	VME4L_ASYNC_SQE *sq;		/**< submission queue within ring area */
+	VME4L_ASYNC_CQE *cq;		/**< completion queue within ring area */
+	uint32_t mask;				/**< number of ring entries - 1 */
+	uint32_t mapSize;			/**< size of ring area (bytes) */
+	VME4L_SPACE spc;			/**< VME space of the file */
+	int inFlight;				/**< requests submitted but not completed */
+	struct list_head lstPending; /**< requests waiting for the DMA engine */
+	spinlock_t lock;			/**< protects lstPending, inFlight, cqTail */
+	struct semaphore submitSem;	/**< serializes VME4L_IO_ASYNC_SUBMIT */
+	struct work_struct work;	/**< feeds lstPending into the DMA engine */
+	wait_queue_head_t cqWq;		/**< object to wait for completions */
+} VME4L_ASYNC_CTX;
+
 /** structure that is kept in file->private_data */
 typedef struct {
 	int minor;					/**< minor number  */
 	int	swapMode;				/**< swapping mode  */
+	vmeaddr_t mmapBase;			/**< added to mmap offset of master spaces */
+	int mapMode;				/**< mmap mode, see \ref VME4L_MAPMODE */
+	VME4L_DMA_POLICY dmaPolicy;	/**< DMA completion policy */
+	VME4L_ASYNC_CTX *async;		/**< asynchronous DMA context or NULL */
+	VME4L_PINBUF *pinBuf[VME4L_PINBUF_MAX]; /**< registered buffers */
+	spinlock_t pinLock;			/**< protects pinBuf and useCounts */
+	VME4L_EVENT evQ[VME4L_EVENT_QUEUE_LEN]; /**< interrupts for read() */
+	unsigned int evHead;		/**< next record to write in evQ */
+	unsigned int evTail;		/**< next record to read from evQ */
+	uint32_t evLost;			/**< records dropped since last queued one */
+	spinlock_t evLock;			/**< protects evQ, evHead, evTail, evLost */
+	wait_queue_head_t evWq;		/**< object to wait for interrupt records */
 } VME4L_FILE_PRIV;
 
 /** structure that descibes a VME window that is mapped into PCI space */
 typedef struct {
 	struct list_head node;		/**< list node within spcEnt->lstAdrsWins  */
+	struct rb_node rb;			/**< node within G_adrsWinTree[spc] */
+	vmeaddr_t subtreeLast;		/**< interval tree: max. last addr of subtree */
+	int inTree;					/**< window is in G_adrsWinTree[spc] */
+	struct list_head idleNode;	/**< node within G_lstIdleAdrsWins */
 	VME4L_SPACE spc;			/**< VME space number */
 	vmeaddr_t vmeAddr;			/**< VME start address in this space  */
 	size_t size;				/**< size of VME window (bytes) */
@@ -109,15 +268,33 @@ typedef struct {
 	int useCount;				/**< window usage count  */
 	int flags;					/**< window flags  */
 	struct list_head lstIoremap; /**< cached ioremap regions */
+	VME4L_IT_ROOT regTree;		/**< cached ioremap regions by VME address */
 	void *bDrvData;				/**< bridge driver private data  */
 } VME4L_ADRSWIN;
 
+/** structure that maintains a DMA channel of the bridge */
+typedef struct {
+	wait_queue_head_t wq;		/**< object to wait for DMA to finish */
+	/* state of pipelined DMA (bridges with dmaSetupNext), locked by
+	   G_lockDma */
+	int pipeActive;				/**< pipelined DMA in progress */
+	int nextReady;				/**< next chain prepared by dmaSetupNext */
+	int chainDone;				/**< DMA idle, no prepared chain started */
+	int err;					/**< error detected in interrupt */
+	/* interrupt of DMA found finished by polling, locked by G_lockDma */
+	int irqSeen;				/**< DMA interrupt since last start */
+	int irqOwed;				/**< polled DMA's interrupt still to come */
+} VME4L_DMA_CHAN;
+
 /** structure for ioremap cache region
  *
  * ioremap cache is used only for user VME4L_Write()/VME4L_Read() calls
  */
 typedef struct {
 	struct list_head winNode;	/**< list node within VME4L_ADRSWIN */
+	struct rb_node rb;			/**< node within win->regTree */
+	vmeaddr_t subtreeLast;		/**< interval tree: max. last addr of subtree */
+	VME4L_ADRSWIN *win;			/**< window the region belongs to */
 	struct list_head cacheNode;	/**< list node within G_lstIoremapCache */
 	vmeaddr_t vmeAddr;			/**< VME start address of this region  */
 	size_t size;				/**< size of region (bytes) */
@@ -126,9 +303,43 @@ typedef struct {
 } VME4L_IOREMAP_REGION;
 
 
-/** structure to maintain registered VME irqs */
+/** VME interrupts of one level latched by vme4l_irq() for the irq thread
+ *
+ * Single producer (bridge hard irq handler), single consumer
+ * (vme4l_irq_thread()). For RORA vectors, the producer masks the level
+ * and publishes the entry under VME4L_LOCK_VECTORS, so the thread's
+ * unmask check sees both or none. Other entries are published and all
+ * entries are read without lock.
+ */
+typedef struct {
+	unsigned int head;			/**< next entry to write (hard irq) */
+	unsigned int tail;			/**< next entry to read (irq thread) */
+	uint32_t lost;				/**< interrupts dropped, ring full */
+	int vector[VME4L_IRQ_RING_LEN]; /**< latched VME vectors */
+	uint64_t stamp[VME4L_IRQ_RING_LEN]; /**< bridge irq entry time (ns) */
+} VME4L_IRQ_RING;
+
+/** latency histogram of one stage of the interrupt path
+ *
+ * Updated without lock from hard irq, irq thread and read(). A
+ * concurrent update of \em maxNs may get lost.
+ */
 typedef struct {
-	struct list_head node;		/**< list node */
+	atomic_t bucket[VME4L_LAT_BUCKETS]; /**< bucket n: < 2^n us */
+	atomic_t over;				/**< longer than irq_lat_budget_us */
+	uint32_t maxNs;				/**< max. latency (ns) */
+} VME4L_LAT_HIST;
+
+/** per-CPU statistics, see VME4L_STAT_BEGIN() */
+typedef struct {
+	struct u64_stats_sync sync;	/**< protects 64 bit counters on 32 bit */
+	VME4L_STATS s;				/**< counters, version/size unused */
+} VME4L_PCPU_STATS;
+
+/** structure to maintain registered VME irqs */
+typedef struct vme4l_irq_entry {
+	struct list_head node;		/**< RCU list node within G_vectTbl[] */
+	struct vme4l_irq_entry *nextFree; /**< chain of removed entries */
 	int flags;					/**< VME4L_IRQ_ROAK | VME4L_IRQ_ENBL*/
 	int entType;				/**< how to interpret following structure  */
 	int level;					/**< VME level */
@@ -153,6 +364,13 @@ typedef struct {
  #endif /*LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,19)*/
 			} h;
 		} kernel;
+
+		/** for entType == VME4L_EVENT_IRQ */
+		struct {
+			struct file *file;			/**< associated file */
+			VME4L_FILE_PRIV *fp;		/**< file's event queue */
+			struct eventfd_ctx *efd;	/**< eventfd or NULL to use queue */
+		} event;
 	} u;
 } VME4L_IRQ_ENTRY;
 
@@ -181,14 +399,18 @@ typedef struct vme4l_rt_pend_irq {
 |   GLOBALS                             |
 +--------------------------------------*/
 static VME4L_BRIDGE_DRV 	*G_bDrv; 	/**< current bridge driver 		 */
+static const VME4L_BRIDGE_DRV_EXT *G_bDrvExt; /**< its optional ops	 */
+static const VME4L_BRIDGE_DRV_EXT G_noBDrvExt; /**< for bridges w/o ext */
 static VME4L_BRIDGE_HANDLE	*G_bHandle;	/**< bridge driver's data  		 */
 
 /** address window pool  */
-static VME4L_ADRSWIN		G_adrsWinPool[VME4L_MAX_ADRS_WINS];
+static VME4L_ADRSWIN		*G_adrsWinPool;
 static struct list_head		G_freeAdrsWins;
+/** master windows with useCount 0, least recently used first */
+static struct list_head		G_lstIdleAdrsWins;
 
 /** ioremap cache */
-static VME4L_IOREMAP_REGION	G_ioremapCache[VME4L_MAX_IOREMAP_CACHE];
+static VME4L_IOREMAP_REGION	*G_ioremapCache;
 static struct list_head		G_lstIoremapCache;
 static uint32_t				G_ioremapRegSize = 0x100000;
 
@@ -198,20 +420,26 @@ static spinlock_t			G_lockMstrLists;
 static spinlock_t			G_lockVectTbl;
 /** spin lock for DMA controller */
 static spinlock_t			G_lockDma;
-/** object to wait for DMA to finish */
-static wait_queue_head_t	G_dmaWq;
+
+/** DMA channels of bridge */
+static VME4L_DMA_CHAN		G_dmaChan[VME4L_MAX_DMA_CHANNELS];
+/** number of DMA channels used */
+static int					G_dmaNumChan = 1;
+/** max. bytes per DMA scatter element (see dmaSegMaxGet) */
+static uint32_t				G_dmaSegMax = PAGE_SIZE;
+/** bit mask of DMA channels in use, locked by G_lockDma */
+static unsigned long		G_dmaChanBusy;
 
 #ifdef CONFIG_SMP
 /** spin lock to SAVE_FLAGS_AND_CLI on SMP machines*/
 static spinlock_t			G_lockFlags;
 #endif
 
-/** mutex for DMA */
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,36)
-static DEFINE_SEMAPHORE(G_dmaMutex);
-#else
-DECLARE_MUTEX(G_dmaMutex);
-#endif
+/** counts free DMA channels */
+static struct semaphore		G_dmaChanSem;
+
+/** workqueue that executes asynchronous DMA requests */
+static struct workqueue_struct *G_asyncWq;
 
 #ifdef CONFIG_PROC_FS
 static struct proc_dir_entry *vme4l_root;
@@ -258,14 +486,51 @@ VME4L_SPACE_ENT G_spaceTbl[] = {
 /** number of entries in #G_spaceTbl */
 #define VME4L_SPACE_TBL_SIZE (sizeof(G_spaceTbl)/sizeof(VME4L_SPACE_ENT))
 
+/** master address windows of each space, indexed by VME address range */
+static VME4L_IT_ROOT		G_adrsWinTree[VME4L_SPACE_TBL_SIZE];
+
+#define VME4L_IT_START(w)	((w)->vmeAddr)
+#define VME4L_IT_LAST(w)	((w)->vmeAddr + (w)->size - 1)
+
+INTERVAL_TREE_DEFINE(VME4L_ADRSWIN, rb, vmeaddr_t, subtreeLast,
+					 VME4L_IT_START, VME4L_IT_LAST, static, vme4l_win_it)
+
+INTERVAL_TREE_DEFINE(VME4L_IOREMAP_REGION, rb, vmeaddr_t, subtreeLast,
+					 VME4L_IT_START, VME4L_IT_LAST, static, vme4l_reg_it)
+
 VME4L_SPACE_ENT* vme4l_get_space_ent(unsigned int idx)
 {
     return idx < VME4L_SPACE_TBL_SIZE ? &G_spaceTbl[idx] : NULL;
 }
 
-/** list for each possible VME vector and pseudo vectors */
+/** list for each possible VME vector and pseudo vectors (RCU protected) */
 static struct list_head		G_vectTbl[VME4L_NUM_VECTORS];
 
+/** interrupt and transfer statistics */
+static VME4L_PCPU_STATS __percpu *G_stats;
+
+/** number of handlers per vector that need the level masked until they
+ *  ran (kernel handlers, signals/events without VME4L_IRQ_ROAK).
+ *  Changed under G_lockVectTbl */
+static int					G_vectRora[VME4L_NUM_VECTORS];
+
+/** deferred VME interrupts, indexed by level 1..7 */
+static VME4L_IRQ_RING		G_irqRing[VME4L_IRQLEV_NUM+1];
+/** bridge irq is threaded (see vme4l_request_irq()) */
+static int					G_irqThreaded;
+/** vme4l_irq() latched interrupts, irq thread must run */
+static int					G_irqWake;
+/** levels masked by vme4l_irq() until the irq thread ran */
+static unsigned long		G_irqLevMasked;
+/** affinity hint set for bridge irq */
+static int					G_irqAffinitySet;
+/** entry time of bridge irq handler (vme4l_irq_entry()), 0 if unknown */
+static uint64_t				G_irqEntryNs;
+/** latency of interrupt path stages per level */
+static VME4L_LAT_HIST		G_latLev[VME4L_NUM_LEVELS][VME4L_LAT_STAGES];
+/** latency bridge irq entry -> handlers/events done per vector */
+static VME4L_LAT_HIST		G_latVect[VME4L_NUM_VECTORS];
+
 /** array to keep track of number of enables/disables for each IRQ level */
 static int G_irqLevEnblCount[VME4L_NUM_LEVELS];
 static int G_postedWriteMode; 	 /** for old VME4L compat  */
@@ -280,6 +545,71 @@ module_param(debug, int, S_IRUGO | S_IWUSR);
 MODULE_PARM_DESC(debug, "Enable debugging printouts (default " \
 			M_INT_TO_STR(DEBUG_DEFAULT) ")");
 
+static unsigned int dma_poll_us = 0; /**< default DMA busy-poll time */
+
+module_param(dma_poll_us, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(dma_poll_us, "Default DMA busy-poll time in us before "
+				 "waiting for DMA interrupt (default 0)");
+
+/* off by default, as it moves VME_REQUEST_IRQ() handlers to a thread */
+static int irq_threaded = 0; /**< dispatch VME levels from irq thread */
+
+module_param(irq_threaded, int, S_IRUGO);
+MODULE_PARM_DESC(irq_threaded, "Dispatch VME interrupt levels 1..7 from a "
+				 "threaded irq handler, also VME_REQUEST_IRQ() "
+				 "handlers (default 0)");
+
+/** interrupts per level the irq thread dispatches before the next level */
+static int irq_budget[VME4L_IRQLEV_NUM] = {
+	[0 ... VME4L_IRQLEV_NUM-1] = VME4L_IRQ_LEV_BUDGET
+};
+
+module_param_array(irq_budget, int, NULL, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(irq_budget, "Per-level (1..7) irq thread budget (default "
+				 M_INT_TO_STR(VME4L_IRQ_LEV_BUDGET) ")");
+
+static int irq_cpu = -1; /**< CPU for bridge irq and irq thread */
+
+module_param(irq_cpu, int, S_IRUGO);
+MODULE_PARM_DESC(irq_cpu, "CPU to run bridge irq and irq thread on "
+				 "(default -1: don't change)");
+
+static int irq_latency = 1; /**< collect interrupt latency histograms */
+
+module_param(irq_latency, int, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(irq_latency, "Collect interrupt latency histograms in "
+				 "/proc/vme4l/irq_latency (default 1)");
+
+static unsigned int irq_lat_budget_us = 50; /**< interrupt latency budget */
+
+module_param(irq_lat_budget_us, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(irq_lat_budget_us, "Interrupt latency budget in us, longer "
+				 "latencies are counted as violations (default 50)");
+
+static unsigned int dma_timeout_ms = 5000; /**< default DMA timeout */
+
+module_param(dma_timeout_ms, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(dma_timeout_ms, "Default DMA timeout in ms (default 5000)");
+
+static unsigned int max_adrs_wins = VME4L_MAX_ADRS_WINS; /**< window pool */
+
+module_param(max_adrs_wins, uint, S_IRUGO);
+MODULE_PARM_DESC(max_adrs_wins, "Number of VME master address windows "
+				 "(default " M_INT_TO_STR(VME4L_MAX_ADRS_WINS) ")");
+
+static unsigned int ioremap_cache_size = VME4L_MAX_IOREMAP_CACHE; /**< regions */
+
+module_param(ioremap_cache_size, uint, S_IRUGO);
+MODULE_PARM_DESC(ioremap_cache_size, "Number of cached ioremap regions "
+				 "(default " M_INT_TO_STR(VME4L_MAX_IOREMAP_CACHE) ")");
+
+static int slave_hugemap = 1; /**< map slave windows with huge PMDs */
+
+module_param(slave_hugemap, int, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(slave_hugemap, "Map slave windows into user space with "
+				 "PMD sized pages where the window memory is PMD aligned, "
+				 "else with pages (default 1)");
+
 
 /*--------------------------------------+
 |   PROTOTYPES                          |
@@ -356,18 +686,25 @@ static VME4L_ADRSWIN *vme4l_find_adrswin(
 	size_t size,
 	int flags)
 {
-	struct list_head *pos;
-	VME4L_SPACE_ENT *spcEnt = &G_spaceTbl[spc];
+	VME4L_ADRSWIN *win;
+	vmeaddr_t last = vmeAddr + size - 1;
+
+	if( size == 0 )
+		return NULL;
 
 	VME4L_LOCK_MSTRLISTS();
 
-	list_for_each( pos, &spcEnt->lstAdrsWins ) {
-		VME4L_ADRSWIN *win = list_entry( pos, VME4L_ADRSWIN, node );
+	/* visit only windows that overlap the requested range */
+	for( win = vme4l_win_it_iter_first( &G_adrsWinTree[spc], vmeAddr, last );
+		 win;
+		 win = vme4l_win_it_iter_next( win, vmeAddr, last )) {
 
 		if( (win->vmeAddr <= vmeAddr) &&
-			((win->vmeAddr + win->size) >= (vmeAddr+size)) &&
+			(VME4L_IT_LAST(win) >= last) &&
 			(win->flags == flags)){
-			win->useCount++;
+			/* reused, no longer a candidate for eviction */
+			if( win->useCount++ == 0 )
+				list_del_init( &win->idleNode );
 			VME4L_UNLOCK_MSTRLISTS();
 			return win;
 		}
@@ -378,6 +715,11 @@ static VME4L_ADRSWIN *vme4l_find_adrswin(
 
 
 /** Free the resources of an address window.
+ *
+ * When \a checkUseCount is set and the last reference to a master window
+ * is dropped, the window stays mapped and is queued on G_lstIdleAdrsWins,
+ * so that the next request for the same range finds it again. Idle
+ * windows are freed by vme4l_evict_idle_adrswin() when resources run out.
  *
  * \param win is the window to be freed
  * \param checkUseCount selects whether the use counter should be checked or
@@ -396,6 +738,12 @@ static int do_free_adrswin(VME4L_ADRSWIN *win, bool checkUseCount)
 
 		/* mark the window as safe to be removed */
 		lastReference = (win->useCount == 0);
+
+		if( lastReference && win->inTree ){
+			/* keep it mapped, most recently used at tail */
+			list_add_tail( &win->idleNode, &G_lstIdleAdrsWins );
+			lastReference = false;
+		}
 	}
 
 	if(!checkUseCount || lastReference) {
@@ -405,6 +753,11 @@ static int do_free_adrswin(VME4L_ADRSWIN *win, bool checkUseCount)
 
 		if( !rv ) {
 			list_del(&win->node);
+			list_del_init(&win->idleNode);
+			if( win->inTree ){
+				vme4l_win_it_remove( win, &G_adrsWinTree[win->spc] );
+				win->inTree = 0;
+			}
 
 			/*--- free all ioremapped regions ---*/
 			while(!list_empty(&win->lstIoremap)) {
@@ -466,33 +819,33 @@ static void vme4l_release_adrswin( VME4L_ADRSWIN *win )
 
 
 /***********************************************************************/
-/** Free all VME address windows of all spaces whose useCount is 0
+/** Free the least recently used VME master window whose useCount is 0
+ *
+ * The window is taken out of the lookup tree before the lock is dropped,
+ * so it can not be found again while it is released.
  *
+ * \return 0 if a window has been freed or -ENOSPC if no idle window left
  */
-static void vme4l_release_unused_adrswins(void)
+static int vme4l_evict_idle_adrswin(void)
 {
-	VME4L_SPACE_ENT *spcEnt = G_spaceTbl;
-	VME4L_SPACE spc;
+	VME4L_ADRSWIN *win;
 
 	VME4L_LOCK_MSTRLISTS();
 
-	for( spc=0; spc<VME4L_SPACE_TBL_SIZE; spc++, spcEnt++ ){
-		struct list_head *pos, *tmpPos;
-
-		if( spcEnt->isSlv )
-			continue;			/* don't free slave windows */
+	if( list_empty( &G_lstIdleAdrsWins )){
+		VME4L_UNLOCK_MSTRLISTS();
+		return -ENOSPC;
+	}
 
-		list_for_each_safe( pos, tmpPos, &spcEnt->lstAdrsWins ) {
-			VME4L_ADRSWIN *win = list_entry( pos, VME4L_ADRSWIN, node );
+	win = list_entry( G_lstIdleAdrsWins.next, VME4L_ADRSWIN, idleNode );
+	list_del_init( &win->idleNode );
+	vme4l_win_it_remove( win, &G_adrsWinTree[win->spc] );
+	win->inTree = 0;
 
-			if( win->useCount == 0 ){
-				VME4L_UNLOCK_MSTRLISTS();
-				vme4l_discard_adrswin( win );
-				VME4L_LOCK_MSTRLISTS();
-			}
-		}
-	}
 	VME4L_UNLOCK_MSTRLISTS();
+
+	vme4l_discard_adrswin( win );
+	return 0;
 }
 
 static VME4L_ADRSWIN *vme4l_alloc_adrswin(void)
@@ -513,10 +866,68 @@ static VME4L_ADRSWIN *vme4l_alloc_adrswin(void)
 	return win;
 }
 
+/***********************************************************************/
+/** Check if a bus range is used by a window of the other cache mode
+ *
+ * Write-combining and uncached mappings of the same bus address must not
+ * coexist (conflicting memory types). Bridges with fixed windows return
+ * the same bus address for every window of a space, so separate window
+ * objects are not enough.
+ *
+ * Idle aliasing windows are taken out of the lookup tree and moved to
+ * \a idle, the caller must discard them with vme4l_discard_adrswin().
+ *
+ * Must be called with VME4L_LOCK_MSTRLISTS held.
+ *
+ * \param physAddr	bus address of new window
+ * \param size		size of new window
+ * \param flags		flags of new window
+ * \param idle		\OUT receives idle aliasing windows (by idleNode)
+ *
+ * \return 1 if range is used by a window with other VME4L_AW_WC setting
+ *		   that is in use
+ */
+static int vme4l_adrswin_alias(
+	void *physAddr,
+	size_t size,
+	int flags,
+	struct list_head *idle)
+{
+	uintptr_t start = (uintptr_t)physAddr;
+	VME4L_ADRSWIN *win;
+	int spc, alias = 0;
+
+	for( spc=0; spc<VME4L_SPACE_TBL_SIZE; spc++ ){
+		if( G_spaceTbl[spc].isSlv )
+			continue;
+
+		list_for_each_entry( win, &G_spaceTbl[spc].lstAdrsWins, node ){
+			if( !((win->flags ^ flags) & VME4L_AW_WC) ||
+				(uintptr_t)win->physAddr >= start + size ||
+				start >= (uintptr_t)win->physAddr + win->size )
+				continue;
+
+			if( win->useCount == 0 && win->inTree ){
+				/* idle, see vme4l_evict_idle_adrswin() */
+				list_del_init( &win->idleNode );
+				vme4l_win_it_remove( win, &G_adrsWinTree[spc] );
+				win->inTree = 0;
+				list_add_tail( &win->idleNode, idle );
+			}
+			else
+				alias = 1;
+		}
+	}
+	return alias;
+}
+
 /***********************************************************************/
 /** Try to Request VME->PCI address window from bridge driver
  *
  * give up if no address windows available (even unused)!
+ * Fails with -EEXIST if the bridge window overlaps one that is in use
+ * with the other cache mode, see vme4l_adrswin_alias(). Idle windows
+ * overlapping it are freed.
  *
  * \param spc	   \IN	VME4L space number
  * \param vmeAddr  \IN	requested VME start address
@@ -533,8 +944,9 @@ static int vme4l_try_request_adrswin(
 	int flags,
 	VME4L_ADRSWIN **winP)
 {
-	VME4L_ADRSWIN *win;
-	int rv;
+	VME4L_ADRSWIN *win, *old, *tmp;
+	LIST_HEAD( idle );
+	int rv, alias;
 
 	VME4LDBG("vme4l_try request_adrswin spc=%d vmeAddr=0x%llx sz=0x%llx "
 			 "flg=0x%x\n", spc, vmeAddr, (uint64_t) size, flags );
@@ -574,9 +986,31 @@ static int vme4l_try_request_adrswin(
 
 	/*--- add window to list of available windows for space ---*/
 	VME4L_LOCK_MSTRLISTS();
-	list_add_tail( &win->node, &G_spaceTbl[spc].lstAdrsWins );
+
+	alias = vme4l_adrswin_alias( win->physAddr, win->size, flags, &idle );
+	if( !alias ){
+		list_add_tail( &win->node, &G_spaceTbl[spc].lstAdrsWins );
+		vme4l_win_it_insert( win, &G_adrsWinTree[spc] );
+		win->inTree = 1;
+	}
 	VME4L_UNLOCK_MSTRLISTS();
 
+	/* unmap idle windows (and their ioremaps) of the other cache mode */
+	list_for_each_entry_safe( old, tmp, &idle, idleNode )
+		vme4l_discard_adrswin( old );
+
+	if( alias ){
+		VME4L_LOCK_MSTRLISTS();
+		G_bDrv->releaseAddrWindow( G_bHandle, spc, win->vmeAddr, win->size,
+								   flags, win->bDrvData );
+		list_add_tail( &win->node, &G_freeAdrsWins );
+		VME4L_UNLOCK_MSTRLISTS();
+
+		VME4LDBG("%s: bus addr %p used with other cache mode\n",
+				 __func__, win->physAddr );
+		return -EEXIST;
+	}
+
 	VME4LDBG("vme4l_try_request_adrswin exit ok. "
 			 "spc=%d vmeAddr=0x%llx sz=0x%llx phys=0x%p "
 			 "flg=0x%x\n", spc, win->vmeAddr, (uint64_t) win->size,
@@ -611,23 +1045,29 @@ static int vme4l_request_adrswin(
 	VME4LDBG("vme4l_request_adrswin spc=%d vmeAddr=0x%llx sz=0x%llx flg=0x%x\n", spc, vmeAddr, (uint64_t) size, flags);
 
 	/* try to find an already mapped VME window */
-	if( (win = vme4l_find_adrswin( spc, vmeAddr, size, flags )) == NULL ){
+	if( (win = vme4l_find_adrswin( spc, vmeAddr, size, flags )) != NULL ){
+		VME4L_STAT_INC( spaces[spc].winHits );
+		trace_vme4l_adrswin( spc, vmeAddr, size, flags, 1, 0 );
+	}
+	else {
+		VME4L_STAT_INC( spaces[spc].winMisses );
 
 		/* not found, try to setup a new one */
-		if( vme4l_try_request_adrswin( spc, vmeAddr, size, flags, &win ) < 0){
-			/* perhaps all windows already setup */
-			vme4l_release_unused_adrswins();
-
-			if( (rv = vme4l_try_request_adrswin( spc,
-												 vmeAddr,
-												 size,
-												 flags,
-												 & win)) < 0 ){
+		while( (rv = vme4l_try_request_adrswin( spc, vmeAddr, size, flags,
+												&win )) < 0 ){
+			/*
+			 * out of windows (no VME4L_ADRSWIN or bridge has none left):
+			 * free the oldest idle one. Other errors won't go away.
+			 */
+			if( (rv != -ENOSPC && rv != -EBUSY) ||
+				vme4l_evict_idle_adrswin() < 0 ){
 				printk(KERN_ERR_PFX "%s: adrswin request failed\n",
 				       __func__);
+				trace_vme4l_adrswin( spc, vmeAddr, size, flags, 0, rv );
 				return rv;
 			}
 		}
+		trace_vme4l_adrswin( spc, vmeAddr, size, flags, 0, 0 );
 	}
 
 	VME4LDBG("vme4l_request_adrswin ok win=%p\n", win);
@@ -651,7 +1091,9 @@ void *vme4l_destroy_ioremap_region( VME4L_IOREMAP_REGION *region )
 	void *vaddr=NULL;
 
 	if( region->isValid ){
+		trace_vme4l_iounmap( region->vmeAddr, region->size, region->vaddr );
 		list_del( &region->winNode ); 	/* remove it from windows list */
+		vme4l_reg_it_remove( region, &region->win->regTree );
 
 		vaddr = region->vaddr;
 		region->isValid = 0;
@@ -735,17 +1177,22 @@ static int vme4l_make_ioremap_region(
 			  "Map vme=0x%llx (0x%llx) pa=0x%x\n", vmeAddr, (uint64_t) size,
 			  vmeStart, (uint64_t) useSize, physAddr );
 
-	if( (region->vaddr = ioremap_nocache( physAddr, useSize )) != NULL ){
+	region->vaddr = ioremap_nocache( physAddr, useSize );
+	trace_vme4l_ioremap( vmeStart, useSize, region->vaddr );
+
+	if( region->vaddr != NULL ){
 		VME4LDBG( "ioremap ok: Mapped 0x%08x to 0x%p\n",
 				  physAddr, region->vaddr );
 
 		/* remap ok, add it to window list and in front of cache list */
 		region->vmeAddr = vmeStart;
 		region->size	= useSize;
+		region->win		= win;
 		region->isValid	= 1;
 
 		VME4L_LOCK_MSTRLISTS();
 		list_add( &region->winNode, &win->lstIoremap );
+		vme4l_reg_it_insert( region, &win->regTree );
 		list_add( &region->cacheNode, &G_lstIoremapCache );
 		VME4L_UNLOCK_MSTRLISTS();
 		*regionP = region;
@@ -775,16 +1222,20 @@ static VME4L_IOREMAP_REGION *vme4l_find_ioremap_region(
 	vmeaddr_t vmeAddr,
 	size_t size)
 {
-	struct list_head *pos;
 	VME4L_IOREMAP_REGION *region;
+	vmeaddr_t last = vmeAddr + size - 1;
+
+	if( size == 0 )
+		return NULL;
 
 	VME4L_LOCK_MSTRLISTS();
 
-	list_for_each( pos, &win->lstIoremap ){
-		region = list_entry( pos, VME4L_IOREMAP_REGION, winNode );
+	for( region = vme4l_reg_it_iter_first( &win->regTree, vmeAddr, last );
+		 region;
+		 region = vme4l_reg_it_iter_next( region, vmeAddr, last )){
 
 		if( (region->vmeAddr <= vmeAddr) &&
-			(region->vmeAddr + region->size) >= (vmeAddr+size)){
+			(VME4L_IT_LAST(region) >= last) ){
 
 			list_del( &region->cacheNode );
 			list_add( &region->cacheNode, &G_lstIoremapCache );
@@ -913,7 +1364,10 @@ static int vme4l_setup_pio(
 	}
 
 	/*--- ioremap this region (or use it from the ioremap cache) ---*/
-	if( (region = vme4l_find_ioremap_region( win, vmeAddr, size )) == NULL ){
+	if( (region = vme4l_find_ioremap_region( win, vmeAddr, size )) != NULL )
+		VME4L_STAT_INC( spaces[spc].mapHits );
+	else {
+		VME4L_STAT_INC( spaces[spc].mapMisses );
 
 		/* not cached, setup a new one */
 		if( (rv = vme4l_make_ioremap_region( win, vmeAddr, size,
@@ -934,6 +1388,53 @@ static int vme4l_setup_pio(
 
 
 
+/***********************************************************************/
+/** PIO transfer using the bridge's block functions
+ *
+ * The block is transferred in chunks of VME4L_PIO_BLOCK_CHUNK bytes
+ * through a kernel buffer, so the bridge can access the data while
+ * holding its locks. The size must be a multiple of the access width;
+ * as the chunk size is one, so is every chunk.
+ *
+ * \param win			the address window used for the transfer
+ * \param vaddr			starting virtual address for this transfer
+ * \param blk			ioctl argument from user
+ * \return 0 on success or negative error number
+ */
+static int vme4l_pio_block( VME4L_ADRSWIN *win, char *vaddr,
+							VME4L_RW_BLOCK *blk )
+{
+	uint32_t buf[VME4L_PIO_BLOCK_CHUNK/sizeof(uint32_t)];
+	char *userSpc = blk->dataP;
+	size_t left = blk->size, n;
+	int rv = 0;
+
+	if( blk->accWidth <= 0 || VME4L_PIO_BLOCK_CHUNK % blk->accWidth ||
+		blk->size % blk->accWidth )
+		return -EINVAL;
+
+	while( left > 0 && rv == 0 ){
+		n = min_t( size_t, left, sizeof(buf) );
+
+		if( blk->direction == READ ){
+			rv = G_bDrvExt->readPioBlock( G_bHandle, vaddr, buf, n,
+									   blk->accWidth, 0, win->bDrvData );
+			if( rv == 0 && __copy_to_user( userSpc, buf, n ))
+				rv = -EFAULT;
+		}
+		else {
+			if( __copy_from_user( buf, userSpc, n ))
+				return -EFAULT;
+			rv = G_bDrvExt->writePioBlock( G_bHandle, vaddr, buf, n,
+										blk->accWidth, 0, win->bDrvData );
+		}
+		vaddr 	+= n;
+		userSpc += n;
+		left 	-= n;
+	}
+	return rv;
+}
+
 /***********************************************************************/
 /** Handler for VME4L_IO_RW_BLOCK PIO transfers
  *
@@ -957,7 +1458,15 @@ static int vme4l_rw_pio( VME4L_SPACE spc, VME4L_RW_BLOCK *blk, int swapMode )
 		return rv;
 
 	/*--- perform access here ---*/
-	if( blk->direction == READ) {
+	if( (blk->flags & VME4L_RW_PIO_BLOCK) &&
+		!(swAdrSwap && blk->accWidth == 1) &&
+		(blk->direction == READ ? G_bDrvExt->readPioBlock :
+		 G_bDrvExt->writePioBlock) ) {
+
+		/* bridge copies block, checks bus errors once per chunk */
+		rv = vme4l_pio_block( win, vaddr, blk );
+	}
+	else if( blk->direction == READ) {
 
 		/* read from VME */
 		switch( blk->accWidth ) {
@@ -1000,18 +1509,145 @@ static int vme4l_rw_pio( VME4L_SPACE spc, VME4L_RW_BLOCK *blk, int swapMode )
 	return rv;
 }
 
+/***********************************************************************/
+/** Allocate a free DMA channel
+ *
+ * Sleeps until one of the bridge's DMA channels is free.
+ *
+ * \return channel number, or negative error number
+ */
+static int vme4l_dma_chan_get(void)
+{
+	int ch;
+	unsigned long ps;
+
+	if( down_interruptible( &G_dmaChanSem ))
+		return -ERESTARTSYS;
+
+	VME4L_LOCK_DMA(ps);
+	ch = ffz( G_dmaChanBusy );
+	G_dmaChanBusy |= 1 << ch;
+	VME4L_UNLOCK_DMA(ps);
+
+	return ch;
+}
+
+/***********************************************************************/
+/** Release DMA channel allocated by vme4l_dma_chan_get()
+ *
+ * \param ch			DMA channel
+ */
+static void vme4l_dma_chan_put( int ch )
+{
+	unsigned long ps;
+
+	VME4L_LOCK_DMA(ps);
+	G_dmaChanBusy &= ~(1 << ch);
+	VME4L_UNLOCK_DMA(ps);
+
+	up( &G_dmaChanSem );
+}
+
+/***********************************************************************/
+/** Set DMA policy to module parameter defaults
+ *
+ * \param pol			policy to initialize
+ */
+static void vme4l_dma_policy_default( VME4L_DMA_POLICY *pol )
+{
+	pol->pollUs 	= min_t( uint32_t, dma_poll_us, VME4L_DMA_POLL_MAX_US );
+	pol->timeoutMs 	= clamp_t( uint32_t, dma_timeout_ms, 1,
+							   VME4L_DMA_TIMEOUT_MAX_MS );
+}
+
+/***********************************************************************/
+/** Prepare DMA channel for dmaStart
+ *
+ * If the last DMA was found finished by polling, its interrupt may still
+ * be pending. Wait for it, so it isn't taken for the completion of the
+ * new DMA (see vme4l_dma_irq_stale()).
+ *
+ * \param ch			DMA channel
+ */
+static void vme4l_dma_prepare( int ch )
+{
+	VME4L_DMA_CHAN *dch = &G_dmaChan[ch];
+	unsigned long ps;
+
+	if( READ_ONCE( dch->irqOwed ))
+		wait_event_timeout( dch->wq, !READ_ONCE( dch->irqOwed ),
+							msecs_to_jiffies( VME4L_DMA_STALE_IRQ_MS ));
+
+	VME4L_LOCK_DMA(ps);
+	dch->irqOwed = 0;			/* bridge didn't raise it */
+	dch->irqSeen = 0;
+	VME4L_UNLOCK_DMA(ps);
+}
+
+/***********************************************************************/
+/** Account DMA interrupt, check if it belongs to a polled DMA
+ *
+ * Called by vme4l_irq().
+ *
+ * \param ch			DMA channel
+ * \return 1 if the DMA was already found finished by polling
+ */
+static int vme4l_dma_irq_stale( int ch )
+{
+	VME4L_DMA_CHAN *dch = &G_dmaChan[ch];
+	unsigned long ps;
+	int stale;
+
+	VME4L_LOCK_DMA(ps);
+	dch->irqSeen = 1;
+	stale = dch->irqOwed;
+	dch->irqOwed = 0;
+	VME4L_UNLOCK_DMA(ps);
+
+	return stale;
+}
+
+/***********************************************************************/
+/** Busy-poll DMA status of a running DMA
+ *
+ * \param ch			DMA channel
+ * \param pollUs		max. time to poll (us)
+ * \return 1 if DMA still running after \a pollUs, otherwise result of
+ *		   dmaStatus (0=ok, or negative error number)
+ */
+static int vme4l_dma_poll( int ch, uint32_t pollUs )
+{
+	ktime_t start = ktime_get();
+	int rv;
+
+	do {
+		if( (rv = G_bDrv->dmaStatus( G_bHandle, ch )) <= 0 )
+			return rv;
+		cpu_relax();
+	} while( ktime_us_delta( ktime_get(), start ) < pollUs );
+
+	return 1;
+}
+
 /***********************************************************************/
 /** Start DMA and wait for DMA to finish
  *
  * Starts DMA and waits until finished ok, bus error or DMA timeout.
  * This function ignores all signals while waiting for the DMA
  *
+ * If \a pol->pollUs is set, the DMA status is busy-polled for this time
+ * before sleeping on the DMA interrupt. This saves the interrupt latency
+ * and task switch for short transfers.
+ *
+ * \param ch			DMA channel
+ * \param pol			DMA completion policy
  * \return 0 on success, or negative error number
  */
-static int vme4l_start_wait_dma(void)
+static int vme4l_start_wait_dma( int ch, const VME4L_DMA_POLICY *pol )
 {
-	int rv;
-	uint32_t ticks = 5 * HZ;
+	int rv, polled=0;
+	uint32_t ticks = msecs_to_jiffies( pol->timeoutMs );
+	unsigned long ps;
 
 #if LINUX_VERSION_CODE < KERNEL_VERSION(4,13,0)
 	wait_queue_t __wait;
@@ -1019,29 +1655,31 @@ static int vme4l_start_wait_dma(void)
 	wait_queue_entry_t __wait;
 #endif
 
+	vme4l_dma_prepare( ch );
+
 	/* Add to wait queue before starting DMA */
 	init_waitqueue_entry(&__wait, current);
-	add_wait_queue(&G_dmaWq, &__wait);
-	set_current_state(TASK_UNINTERRUPTIBLE);
+	add_wait_queue(&G_dmaChan[ch].wq, &__wait);
 
 	/* start DMA */
-	if( (rv = G_bDrv->dmaStart( G_bHandle )) < 0 ){
+	if( (rv = G_bDrv->dmaStart( G_bHandle, ch )) < 0 ){
 		if (rv < 0)
 			VME4LERR(PFX "%s: DMA dmaStart rv=%d\n",
 			       __func__, rv );
 		goto ABORT;
 	}
+	trace_vme4l_dma_start( ch );
 
-	for (;;) {
-		VME4LDBG("vme4l_start_wait_dma: going to sleep %d\n", ticks);
-		ticks = schedule_timeout( ticks );
-
-		if( ticks == 0 ){
-			VME4LERR(PFX "%s: DMA timeout\n", __func__);
-		}
+	/* busy-poll first, DMA interrupt wakes nobody then */
+	if( pol->pollUs && (rv = vme4l_dma_poll( ch, pol->pollUs )) <= 0 ){
+		polled = 1;
+		goto POLLED;
+	}
 
-		/* check DMA state */
-		rv = G_bDrv->dmaStatus( G_bHandle );
+	for (;;) {
+		/* check DMA state after setting task state, not to miss wakeup */
+		set_current_state(TASK_UNINTERRUPTIBLE);
+		rv = G_bDrv->dmaStatus( G_bHandle, ch );
 		if( rv <= 0 ){
 			/* error or ok */
 			if (rv < 0)
@@ -1056,18 +1694,26 @@ static int vme4l_start_wait_dma(void)
 			rv = -ETIME;
 			break;
 		}
-		VME4LDBG("vme4l_start_wait_dma: remaining %d ticks\n", ticks );
 
-		/* In case we execute more loop iterations task has go to
-		   TASK_UNINTERRUPTIBLE again */
-		set_current_state(TASK_UNINTERRUPTIBLE);
+		VME4LDBG("vme4l_start_wait_dma: going to sleep %d\n", ticks);
+		ticks = schedule_timeout( ticks );
 	}
 
+ POLLED:
 	set_current_state(TASK_RUNNING);
+
+	/* DMA found finished before its interrupt came: it is still to come */
+	if( rv != -ETIME ){
+		VME4L_LOCK_DMA(ps);
+		if( !G_dmaChan[ch].irqSeen )
+			G_dmaChan[ch].irqOwed = 1;
+		VME4L_UNLOCK_DMA(ps);
+	}
+	trace_vme4l_dma_complete( ch, polled, rv );
  ABORT:
 
 
-	remove_wait_queue(&G_dmaWq, &__wait);
+	remove_wait_queue(&G_dmaChan[ch].wq, &__wait);
 
 	if (rv<0)
 		VME4LERR(PFX "%s: exit rv=%d\n", __func__, rv);
@@ -1076,43 +1722,335 @@ static int vme4l_start_wait_dma(void)
 }
 
 /***********************************************************************/
-/** Perform zero-copy DMA with VME bridge
+/** Start prepared DMA chain from DMA finished interrupt
  *
- * \param spc			VME4L space number
- * \param sgList		list with \a sgElems scatter elements
- * \param sgNelems		number of valid elements in \a sgList
- * \param direction		0=read from VME 1=write to VME
+ * Called by vme4l_irq() while a pipelined DMA is active. If the next
+ * chain has already been prepared by dmaSetupNext, it is started right
+ * away. Otherwise, the waiting task is told that the DMA is idle.
  *
- * \return 0 on success, or negative error number
+ * \param ch			DMA channel
+ * \param failed		true if bridge reported DMA error
  */
-static int vme4l_perform_zc_dma(
-	VME4L_SPACE spc,
+static void vme4l_dma_chain_next( int ch, int failed )
+{
+	int rv;
+	unsigned long ps;
+	VME4L_DMA_CHAN *dch = &G_dmaChan[ch];
+
+	VME4L_LOCK_DMA(ps);
+	if( dch->pipeActive && !dch->chainDone ){
+		if( failed ){
+			dch->err = -EIO;
+		}
+		else if( dch->nextReady ){
+			if( (rv = G_bDrvExt->dmaStartNext( G_bHandle, ch )) < 0 )
+				dch->err = rv;
+			else
+				dch->irqSeen = 0;
+		}
+
+		if( failed || !dch->nextReady || dch->err )
+			dch->chainDone = 1;
+		dch->nextReady = 0;
+	}
+	VME4L_UNLOCK_DMA(ps);
+}
+
+/***********************************************************************/
+/** Describe one VME range of a zero-copy DMA transfer
+ *
+ * \param seg			segment to initialize
+ * \param sgList		DMA mapped scatter list
+ * \param sgNelems		number of elements in \a sgList
+ * \param direction		0=read from VME 1=write to VME
+ * \param vmeAddr		VME start address
+ * \param flags			VME4L_RW_xxx flags
+ */
+static void vme4l_dma_seg_init(
+	VME4L_DMA_SEG *seg,
 	VME4L_SCATTER_ELEM *sgList,
 	int sgNelems,
 	int direction,
 	vmeaddr_t vmeAddr,
-	int swapMode,
 	int flags)
 {
-	int rv=0;
+	seg->sgList 	= sgList;
+	seg->sgNelems 	= sgNelems;
+	seg->direction 	= direction;
+	seg->vmeAddr 	= vmeAddr;
+	seg->flags 		= flags;
+}
 
-	if( down_interruptible( &G_dmaMutex ))
-		return -ERESTARTSYS;
+/***********************************************************************/
+/** Account scatter elements set up by the bridge, skip finished segments
+ *
+ * \param segP			\IN current segment
+ *						\OUT next segment with elements left
+ * \param nSegs			number of segments starting at \a *segP
+ * \param n				number of elements consumed from \a *segP
+ * \return number of segments left
+ */
+static int vme4l_dma_seg_consume( VME4L_DMA_SEG **segP, int nSegs, int n )
+{
+	VME4L_DMA_SEG *seg = *segP;
+
+	seg->sgList 	+= n;
+	seg->sgNelems 	-= n;
+
+	while( nSegs > 0 && seg->sgNelems == 0 ){
+		seg++;
+		nSegs--;
+	}
+	*segP = seg;
+	return nSegs;
+}
+
+/***********************************************************************/
+/** Perform zero-copy DMA using pipelined descriptor chains
+ *
+ * Used when the bridge provides dmaSetupNext/dmaStartNext. While one
+ * chain is running, the next chain is written to the bridge's second
+ * descriptor area. It is started by vme4l_dma_chain_next() from the
+ * DMA finished interrupt, so there is no gap for task wakeup and
+ * descriptor setup between the chains. This also applies between the
+ * segments of a vectored transfer.
+ *
+ * \param ch			DMA channel allocated by vme4l_dma_chan_get()
+ * \param spc			VME4L space number
+ * \param seg			segments to transfer (modified)
+ * \param nSegs			number of segments in \a seg (>0, first segment
+ *						not empty)
+ * \param swapMode		window swapping mode
+ * \param pol			DMA completion policy
+ *
+ * \return 0 on success, or negative error number
+ */
+static int vme4l_pipelined_zc_dma(
+	int ch,
+	VME4L_SPACE spc,
+	VME4L_DMA_SEG *seg,
+	int nSegs,
+	int swapMode,
+	const VME4L_DMA_POLICY *pol)
+{
+	int rv, n, ready, done, pending, polled=0, abortRv=0;
+	uint32_t ticks;
+	unsigned long ps;
+	vmeaddr_t vmeAddr;
+	VME4L_DMA_CHAN *dch = &G_dmaChan[ch];
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(4,13,0)
+	wait_queue_t __wait;
+#else
+	wait_queue_entry_t __wait;
+#endif
+
+	vme4l_dma_prepare( ch );
+
+	/* first chain is setup the normal way */
+	vmeAddr = seg->vmeAddr;
+	n = G_bDrv->dmaSetup( G_bHandle, ch, spc, seg->sgList, seg->sgNelems,
+						  seg->direction, swapMode, &seg->vmeAddr, seg->flags);
+	if( n <= 0 || n > seg->sgNelems ){
+		VME4LERR(PFX "%s: dmaSetup rv=%d\n", __func__, n);
+		return n < 0 ? n : -EINVAL;	/* bug in bridge driver... */
+	}
+	trace_vme4l_dma_chunk( ch, spc, seg->direction, vmeAddr, seg->sgList, n );
+	nSegs = vme4l_dma_seg_consume( &seg, nSegs, n );
+
+	VME4L_LOCK_DMA(ps);
+	dch->pipeActive	= 1;
+	dch->nextReady	= 0;
+	dch->chainDone	= 0;
+	dch->err		= 0;
+	VME4L_UNLOCK_DMA(ps);
+
+	init_waitqueue_entry(&__wait, current);
+	add_wait_queue(&dch->wq, &__wait);
+
+	if( (rv = G_bDrv->dmaStart( G_bHandle, ch )) < 0 ){
+		VME4LERR(PFX "%s: DMA dmaStart rv=%d\n", __func__, rv );
+		goto ABORT;
+	}
+	trace_vme4l_dma_start( ch );
+
+	for(;;){
+		/* prepare next chain while DMA is running */
+		if( nSegs > 0 ){
+			vmeAddr = seg->vmeAddr;
+			n = G_bDrvExt->dmaSetupNext( G_bHandle, ch, spc, seg->sgList,
+									  seg->sgNelems, seg->direction, swapMode,
+									  &seg->vmeAddr, seg->flags);
+
+			VME4LDBG( "vme4l_pipelined_zc_dma: dmaSetupNext rv=%d, "
+					  "next vmeAddr=0x%lx\n", n, seg->vmeAddr );
+
+			if( n <= 0 || n > seg->sgNelems ){
+				VME4LERR(PFX "%s: dmaSetupNext rv=%d\n", __func__, n);
+				/* let running chain finish, then abort */
+				abortRv = n < 0 ? n : -EINVAL;
+				nSegs = 0;
+			}
+			else {
+				trace_vme4l_dma_chunk( ch, spc, seg->direction, vmeAddr,
+									   seg->sgList, n );
+				nSegs = vme4l_dma_seg_consume( &seg, nSegs, n );
+
+				VME4L_LOCK_DMA(ps);
+				if( dch->chainDone ){
+					/* DMA finished before next chain was ready */
+					if( !dch->err ){
+						dch->chainDone = 0;
+						if( (rv = G_bDrvExt->dmaStartNext( G_bHandle, ch )) < 0 ){
+							dch->err = rv;
+							dch->chainDone = 1;
+						}
+						else
+							dch->irqSeen = 0;
+					}
+				}
+				else {
+					dch->nextReady = 1;
+				}
+				VME4L_UNLOCK_DMA(ps);
+			}
+		}
+
+		/* last chain is running: busy-poll before sleeping */
+		if( pol->pollUs && nSegs == 0 ){
+			VME4L_LOCK_DMA(ps);
+			pending = dch->nextReady;
+			VME4L_UNLOCK_DMA(ps);
+
+			if( !pending && vme4l_dma_poll( ch, pol->pollUs ) <= 0 ){
+				VME4L_LOCK_DMA(ps);
+				dch->chainDone = 1;
+				if( !dch->irqSeen )
+					dch->irqOwed = 1;	/* see vme4l_dma_irq_stale() */
+				VME4L_UNLOCK_DMA(ps);
+				polled = 1;
+			}
+		}
+
+		/* wait until prepared chain was started or DMA is idle */
+		ticks = msecs_to_jiffies( pol->timeoutMs );
+		for(;;){
+			set_current_state(TASK_UNINTERRUPTIBLE);
+
+			VME4L_LOCK_DMA(ps);
+			ready = dch->chainDone ||
+				(nSegs > 0 && !dch->nextReady);
+			VME4L_UNLOCK_DMA(ps);
+
+			if( ready || ticks == 0 )
+				break;
+
+			ticks = schedule_timeout( ticks );
+		}
+		set_current_state(TASK_RUNNING);
+
+		VME4L_LOCK_DMA(ps);
+		done = dch->chainDone;
+		rv = dch->err;
+		if( !ready )
+			dch->nextReady = 0;	/* don't start it anymore */
+		VME4L_UNLOCK_DMA(ps);
+
+		if( !ready ){
+			VME4LERR(PFX "%s: DMA timeout DMA not finished\n", __func__);
+			G_bDrv->dmaStop( G_bHandle, ch );
+			rv = -ETIME;
+			break;
+		}
+
+		if( rv < 0 ){
+			VME4LERR(PFX "%s: DMA status %d\n", __func__, rv);
+			break;
+		}
+
+		if( done ){
+			/* status of last chain, wait until engine is idle */
+			while( (rv = G_bDrv->dmaStatus( G_bHandle, ch )) > 0 &&
+				   ticks > 0 ){
+				schedule_timeout_uninterruptible( 1 );
+				ticks--;
+			}
+
+			if( rv > 0 ){
+				VME4LERR(PFX "%s: DMA timeout DMA not finished\n",
+						 __func__);
+				G_bDrv->dmaStop( G_bHandle, ch );
+				rv = -ETIME;
+			}
+			else if( rv < 0 )
+				VME4LERR(PFX "%s: DMA status %d\n", __func__, rv);
+			break;
+		}
+	}
+	trace_vme4l_dma_complete( ch, polled, rv );
+
+ ABORT:
+	VME4L_LOCK_DMA(ps);
+	dch->pipeActive = 0;
+	VME4L_UNLOCK_DMA(ps);
+
+	remove_wait_queue(&dch->wq, &__wait);
+
+	return rv < 0 ? rv : abortRv;
+}
+
+/***********************************************************************/
+/** Perform zero-copy DMA with VME bridge
+ *
+ * All segments are transferred on the same DMA channel.
+ *
+ * \param spc			VME4L space number
+ * \param seg			segments to transfer (modified)
+ * \param nSegs			number of segments in \a seg
+ * \param swapMode		window swapping mode
+ * \param pol			DMA completion policy
+ *
+ * \return 0 on success, or negative error number
+ */
+static int vme4l_perform_zc_dma(
+	VME4L_SPACE spc,
+	VME4L_DMA_SEG *seg,
+	int nSegs,
+	int swapMode,
+	const VME4L_DMA_POLICY *pol)
+{
+	int rv=0, ch;
+	vmeaddr_t vmeAddr;
+
+	/* skip empty segments */
+	if( (nSegs = vme4l_dma_seg_consume( &seg, nSegs, 0 )) == 0 )
+		return 0;
+
+	if( (ch = vme4l_dma_chan_get()) < 0 )
+		return ch;
+
+	/* bridge can prepare next chain while DMA is running */
+	if( G_bDrvExt->dmaSetupNext && G_bDrvExt->dmaStartNext ){
+		rv = vme4l_pipelined_zc_dma( ch, spc, seg, nSegs, swapMode, pol );
+		goto ABORT;
+	}
 
-	while( sgNelems > 0 ){
+	while( nSegs > 0 ){
 
 		/* setup DMA */
+		vmeAddr = seg->vmeAddr;
 		rv = G_bDrv->dmaSetup(
 			G_bHandle,
+			ch,
 			spc,
-			sgList,
-			sgNelems,
-			direction,
+			seg->sgList,
+			seg->sgNelems,
+			seg->direction,
 			swapMode,
-			&vmeAddr,
-			flags);
+			&seg->vmeAddr,
+			seg->flags);
 
-		VME4LDBG( "vme4l_perform_zc_dma: dmaSetup rv=%d, next vmeAddr=0x%lx\n", rv, vmeAddr );
+		VME4LDBG( "vme4l_perform_zc_dma: dmaSetup rv=%d, next vmeAddr=0x%lx\n", rv, seg->vmeAddr );
 
 		if( rv < 0 ) {
 			VME4LERR(PFX "%s: dmaSetup rv=%d\n",
@@ -1120,16 +2058,17 @@ static int vme4l_perform_zc_dma(
 			goto ABORT;
 		}
 
-		if( rv == 0 || rv > sgNelems){
+		if( rv == 0 || rv > seg->sgNelems){
 			rv = -EINVAL;		/* bug in bridge driver... */
 			goto ABORT;
 		}
+		trace_vme4l_dma_chunk( ch, spc, seg->direction, vmeAddr,
+							   seg->sgList, rv );
 
-		sgNelems -= rv;
-		sgList += rv;
+		nSegs = vme4l_dma_seg_consume( &seg, nSegs, rv );
 
 		/* start&wait for DMA */
-		rv = vme4l_start_wait_dma();
+		rv = vme4l_start_wait_dma( ch, pol );
 
 		if (rv < 0) {
 			VME4LERR(PFX "%s: vme4l_start_wait_dma rv=%d\n",
@@ -1139,7 +2078,7 @@ static int vme4l_perform_zc_dma(
 	}
 
  ABORT:
-	up( &G_dmaMutex );
+	vme4l_dma_chan_put( ch );
 	return rv;
 }
 
@@ -1183,51 +2122,110 @@ static void vme4l_user_pages_print(unsigned int nr_pages,
 #endif
 
 /***********************************************************************/
-/** prepare zero-copy DMA with VME bridge
+/** Release buffer setup by vme4l_zc_buf_map()
  *
- * \param spc			VME4L space number
- * \param blk			pointer with kernel address of user buffer
- * \param swapMode		if 1 swap Data in VME core
+ * Unmaps all DMA mapped scatter elements and releases the pinned pages
+ *
+ * \param zc			buffer to release
+ */
+static void vme4l_zc_buf_unmap( VME4L_ZC_BUF *zc )
+{
+#ifndef VME4L_PIN_USER_PAGES
+	int i;
+#endif
+
+	if( zc->sgNelems )
+		dma_unmap_sg( zc->pDev, zc->sgt, zc->sgtNents, zc->dmaDir );
+
+	/* release pinned pages, device may have written them */
+#ifdef VME4L_PIN_USER_PAGES
+	if( zc->nrPinned )
+		unpin_user_pages_dirty_lock( zc->pages, zc->nrPinned,
+									 zc->dmaDir != DMA_TO_DEVICE );
+#else
+	for (i = 0; i < zc->nrPinned; i++){
+		if( zc->dmaDir != DMA_TO_DEVICE )
+			set_page_dirty_lock( zc->pages[i] );
+		put_page( zc->pages[i] );
+	}
+#endif
+
+	if( zc->sgList )
+		kfree( zc->sgList );
+	if( zc->sgt )
+		kfree( zc->sgt );
+	if( zc->pages )
+		kfree( zc->pages );
+
+	zc->sgList 		= NULL;
+	zc->sgt 		= NULL;
+	zc->pages 		= NULL;
+	zc->sgNelems 	= 0;
+	zc->nrPinned 	= 0;
+}
+
+/***********************************************************************/
+/** Get the device zero-copy DMA buffers are mapped for
+ *
+ * \return dmaDevGet() of the bridge, the bridge's PCI device, or NULL
+ *		   if the bridge cannot do zero-copy DMA
+ */
+static struct device *vme4l_dma_dev( void )
+{
+	if( G_bDrvExt->dmaDevGet )
+		return G_bDrvExt->dmaDevGet( G_bHandle );
+	if( G_bDrv->pciDevGet )
+		return &G_bDrv->pciDevGet( G_bHandle )->dev;
+	return NULL;
+}
+
+/***********************************************************************/
+/** Pin a user (or kernel) buffer and build the DMA mapped scatter list
+ *
+ * Physically contiguous pages are merged into one scatter element of up
+ * to G_dmaSegMax bytes. The list is mapped with dma_map_sg(), so an IOMMU
+ * may merge elements further (limited by the device's max_seg_size).
+ *
+ * \param dataP			start of buffer
+ * \param count			size of buffer in bytes
+ * \param direction		READ=read from VME, WRITE=write to VME,
+ *						VME4L_ZC_BIDIR=both
+ * \param flags			VME4L_RW_KERNEL_SPACE_DMA if \a dataP is a kernel
+ *						address, VME4L_ZC_LONGTERM if the buffer stays
+ *						pinned beyond the current call
+ * \param zc			\OUT receives the mapped buffer. Must be
+ *						released with vme4l_zc_buf_unmap()
  *
  * \return 0 on success, or negative error number
  */
-static int vme4l_zc_dma( VME4L_SPACE spc, VME4L_RW_BLOCK *blk, int swapMode )
+static int vme4l_zc_buf_map(
+	void *dataP,
+	size_t count,
+	int direction,
+	int flags,
+	VME4L_ZC_BUF *zc)
 {
 	int rv = 0, i;
-	uintptr_t uaddr 	= (uintptr_t)blk->dataP;
-	int flags 		= blk->flags;
-	size_t count 		= blk->size;
+	uintptr_t uaddr 	= (uintptr_t)dataP;
 	unsigned int nr_pages	= 0;
-	struct page **pages 	= NULL;
-	uint32_t totlen		= 0;
 	unsigned int offset 	= 0;
-	int direction 		= 0;
-	struct pci_dev *pciDev	= NULL;
-	struct device *pDev	= NULL;
-	void *pKmalloc		= NULL;
-        unsigned char *pVirtAddr= NULL;
-	int locked		= 0;
-	dma_addr_t dmaAddr 	= 0;
-	VME4L_SCATTER_ELEM *sgListStart = NULL, *sgList;
-	int to_user		= 0;
+	unsigned int len;
+	size_t left;
+	struct scatterlist *sg 	= NULL;
+	VME4L_SCATTER_ELEM *sgList;
 	void *addr 		= NULL;
-#ifdef VME4L_DBG_DMA_DATA
-	unsigned int initOffs 	= 0;
-#endif
 
-	/* direction as seen from  DMA API context */
-	direction = ( blk->direction == READ ) ? DMA_FROM_DEVICE : DMA_TO_DEVICE;
-	to_user = !(blk->flags & VME4L_RW_KERNEL_SPACE_DMA);
-
-	/* be paranoid.. */
-	if (count == 0)
-		return 0;
+	memset( zc, 0, sizeof(*zc) );
 
-	pciDev = G_bDrv->pciDevGet( G_bHandle );
-	pDev = &pciDev->dev;
+	/* direction as seen from  DMA API context */
+	if( direction == VME4L_ZC_BIDIR )
+		zc->dmaDir = DMA_BIDIRECTIONAL;
+	else
+		zc->dmaDir = ( direction == READ ) ? DMA_FROM_DEVICE : DMA_TO_DEVICE;
+	zc->toUser = !(flags & VME4L_RW_KERNEL_SPACE_DMA);
 
-	/*--- Allocate array to hold page pointers ---*/
-	nr_pages = ((uaddr & ~PAGE_MASK) + count + ~PAGE_MASK) >> PAGE_SHIFT;
+	if( (zc->pDev = vme4l_dma_dev()) == NULL )
+		return -ENOTTY;
 
 	/* User attempted Overflow! */
 	if ((uaddr + count) < uaddr) {
@@ -1238,25 +2236,43 @@ static int vme4l_zc_dma( VME4L_SPACE spc, VME4L_RW_BLOCK *blk, int swapMode )
 		return -EINVAL;
 	}
 
-	if ((pages = kmalloc(nr_pages * sizeof(*pages), GFP_ATOMIC)) == NULL)
+	/*--- Allocate array to hold page pointers ---*/
+	nr_pages = ((uaddr & ~PAGE_MASK) + count + ~PAGE_MASK) >> PAGE_SHIFT;
+	zc->nrPages = nr_pages;
+
+	if ((zc->pages = kmalloc(nr_pages * sizeof(*zc->pages), GFP_ATOMIC)) == NULL)
 		return -ENOMEM;
 
-	/* allocate scatter list */
-	sgListStart = sgList = kmalloc(sizeof(*sgList) * nr_pages, GFP_ATOMIC);
-	if( sgListStart == NULL ) {
+	/* allocate scatter lists */
+	zc->sgt = kmalloc(sizeof(*zc->sgt) * nr_pages, GFP_ATOMIC);
+	zc->sgList = sgList = kmalloc(sizeof(*sgList) * nr_pages, GFP_ATOMIC);
+	if( zc->sgt == NULL || sgList == NULL ) {
 		rv = -ENOMEM;
 		goto CLEANUP;
 	}
 
-	if (to_user) {
+	if (zc->toUser) {
 		VME4LDBG("To/from Userspace DMA transfer\n");
-		rv = get_user_pages_fast( uaddr, nr_pages, direction, pages);
-		if (rv < 0)
-			printk(KERN_ERR_PFX "%s: get_user_pages_fast failed rv"
+#ifdef VME4L_PIN_USER_PAGES
+		rv = pin_user_pages_fast( uaddr, nr_pages,
+					(zc->dmaDir != DMA_TO_DEVICE ? FOLL_WRITE : 0) |
+					(flags & VME4L_ZC_LONGTERM ? FOLL_LONGTERM : 0),
+					zc->pages );
+#else
+		rv = get_user_pages_fast( uaddr, nr_pages,
+								  zc->dmaDir != DMA_TO_DEVICE, zc->pages);
+#endif
+		if (rv < 0) {
+			printk(KERN_ERR_PFX "%s: pinning user pages failed rv"
 			       "%d nr pages %d\n",
 			       __func__, rv, nr_pages);
+			goto CLEANUP;
+		}
+		/* pages are now locked in memory */
+		zc->nrPinned = rv;
 
 		if (rv < nr_pages) {
+			rv = -EFAULT;
 			goto CLEANUP;
 		}
 	} else {
@@ -1264,81 +2280,107 @@ static int vme4l_zc_dma( VME4L_SPACE spc, VME4L_RW_BLOCK *blk, int swapMode )
 		addr = (void *)uaddr;
 		if (is_vmalloc_addr(addr)) {
 			for (i = 0; i < nr_pages; i++)
-				pages[i] = vmalloc_to_page(addr + PAGE_SIZE * i);
+				zc->pages[i] = vmalloc_to_page(addr + PAGE_SIZE * i);
 		} else {
 			/* Note: this supports lowmem pages only */
 			if (!virt_addr_valid(uaddr)) {
 				printk(KERN_ERR_PFX "%s: virt_addr_valid not valid\n",
 				       __func__);
-				return -EINVAL;
+				rv = -EINVAL;
+				goto CLEANUP;
 			}
 			for (i = 0; i < nr_pages; i++)
-				pages[i] = virt_to_page(uaddr + PAGE_SIZE * i);
+				zc->pages[i] = virt_to_page(uaddr + PAGE_SIZE * i);
 		}
 	}
 
-	/* pages are now locked in memory */
-	locked++;
-
-	/*--- build scatter/gather list ---*/
+	/*--- build scatter/gather list of physically contiguous runs ---*/
+	sg_init_table( zc->sgt, nr_pages );
 	offset = uaddr & ~PAGE_MASK; /* ts@men this gives initial offset betw. userdata and first mapped page, often > 0 */
-#ifdef VME4L_DBG_DMA_DATA
-	initOffs = offset;
-#endif
-	for (i = 0; i < nr_pages; ++i, sgList++) {
-		struct page *page = pages[i];
-		sgList->dmaLength  = PAGE_SIZE - offset;
-            pVirtAddr = ((unsigned char*)(page_address( page ))) + offset;
-
-		if( totlen + sgList->dmaLength > count ){
-			sgList->dmaLength = count - totlen;
+	left = count;
+	for (i = 0; i < nr_pages; ++i) {
+		len = min_t(size_t, PAGE_SIZE - offset, left);
+
+		if( sg != NULL &&
+			page_to_pfn(zc->pages[i]) == page_to_pfn(zc->pages[i-1]) + 1 &&
+			sg->length + len <= G_dmaSegMax ){
+			sg->length += len;		/* extend current run */
 		}
-
-            dmaAddr = dma_map_single( pDev, pVirtAddr, sgList->dmaLength, direction );
-		if ( dma_mapping_error(pDev, dmaAddr ) ) {
-                   printk(KERN_ERR_PFX "%s: *** error mapping DMA space!\n" ,
-			  __func__);
-			goto CLEANUP;
-		} else {
-                   sgList->dmaAddress = dmaAddr;      /* store page address for later dma_unmap_page */
+		else {
+			sg = &zc->sgt[zc->sgtNents++];
+			sg_set_page( sg, zc->pages[i], len, offset );
 		}
+		left -= len;
+		offset = 0;
+	}
+	sg_mark_end( sg );
 
+	zc->sgNelems = dma_map_sg( zc->pDev, zc->sgt, zc->sgtNents, zc->dmaDir );
+	if( zc->sgNelems == 0 ) {
+		printk(KERN_ERR_PFX "%s: *** error mapping DMA space!\n" ,
+			   __func__);
+		rv = -ENOMEM;
+		goto CLEANUP;
+	}
 
-		VME4LDBG(" sglist %d: pageAddr=%p off=0x%04lx dmaAddr=%p length=0x%04x\n", i, page_address(page), offset, dmaAddr, sgList->dmaLength);
-		totlen += sgList->dmaLength;
-		offset = 0;
+	for_each_sg( zc->sgt, sg, zc->sgNelems, i ) {
+		sgList[i].dmaAddress = sg_dma_address( sg );
+		sgList[i].dmaLength  = sg_dma_len( sg );
+		zc->totlen += sgList[i].dmaLength;
+
+		VME4LDBG(" sglist %d: dmaAddr=%p length=0x%04x\n", i,
+				 (void *)sgList[i].dmaAddress, sgList[i].dmaLength);
 	}
 
-	/*--- now do DMA in HW (device touches memory) ---*/
-	rv = vme4l_perform_zc_dma( spc, sgListStart, nr_pages, blk->direction, blk->vmeAddr, swapMode, flags);
+	return 0;
 
 CLEANUP:
-	/*--- free pages ---*/
-	if( locked) {
-		sgList = sgListStart;
-		for (i = 0; i < nr_pages; i++, sgList++) {
-			dma_unmap_single( pDev, sgList->dmaAddress, sgList->dmaLength , direction );
-
-			if (to_user)
-				put_page( pages[i] ); /* release pages locked with get_user_pages */
-			}
-	}
+	vme4l_zc_buf_unmap( zc );
+	return rv;
+}
+
+/***********************************************************************/
+/** prepare zero-copy DMA with VME bridge
+ *
+ * \param spc			VME4L space number
+ * \param blk			pointer with kernel address of user buffer
+ * \param swapMode		if 1 swap Data in VME core
+ * \param pol			DMA completion policy
+ *
+ * \return 0 on success, or negative error number
+ */
+static int vme4l_zc_dma( VME4L_SPACE spc, VME4L_RW_BLOCK *blk, int swapMode,
+						 const VME4L_DMA_POLICY *pol )
+{
+	int rv;
+	VME4L_ZC_BUF zc;
+	VME4L_DMA_SEG seg;
+
+	/* be paranoid.. */
+	if (blk->size == 0)
+		return 0;
+
+	if( (rv = vme4l_zc_buf_map( blk->dataP, blk->size, blk->direction,
+								blk->flags, &zc )) < 0 )
+		goto ABORT;
+
+	/*--- now do DMA in HW (device touches memory) ---*/
+	vme4l_dma_seg_init( &seg, zc.sgList, zc.sgNelems, blk->direction,
+						blk->vmeAddr, blk->flags );
+	rv = vme4l_perform_zc_dma( spc, &seg, 1, swapMode, pol );
 
 #ifdef VME4L_DBG_DMA_DATA
-	vme4l_user_pages_print(nr_pages, pages, 32, initOffs );
+	vme4l_user_pages_print(zc.nrPages, zc.pages, 32,
+						   (uintptr_t)blk->dataP & ~PAGE_MASK );
 #endif
 
-	if( sgListStart )
-		kfree( sgListStart );
-	if( pages )
-		kfree( pages );
-	if (pKmalloc)
-		kfree ( pKmalloc );
+	vme4l_zc_buf_unmap( &zc );
 
+ ABORT:
 	if (rv < 0)
 		VME4LERR(PFX "%s: rv=%d\n", __func__, rv);
 
-	return rv >= 0 ? totlen : rv;
+	return rv >= 0 ? zc.totlen : rv;
 }
 
 /***********************************************************************/
@@ -1347,18 +2389,20 @@ CLEANUP:
  * \param spc			VME4L space number
  * \param blk			ioctl argument from user
  * \param swapMode		window swapping mode
+ * \param pol			DMA completion policy
  * \return >=0 number of bytes transferred, or negative error number
  */
 static int vme4l_bounce_dma( VME4L_SPACE spc, VME4L_RW_BLOCK *blk,
-							 int swapMode )
+							 int swapMode, const VME4L_DMA_POLICY *pol )
 {
-	int rv=0;
+	int rv=0, ch;
 	size_t len = blk->size;
 	vmeaddr_t vmeAddr = blk->vmeAddr;
 	char *userSpc = blk->dataP;
 
-	if( down_interruptible( &G_dmaMutex ))
-		return -ERESTARTSYS;
+	/* bounce buffer bridges have a single DMA channel */
+	if( (ch = vme4l_dma_chan_get()) < 0 )
+		return ch;
 
 	VME4LDBG("-> vme4l_bounce_dma\n");
 
@@ -1400,7 +2444,7 @@ static int vme4l_bounce_dma( VME4L_SPACE spc, VME4L_RW_BLOCK *blk,
 		}
 
 		/* start&wait for DMA */
-		if( (rv = vme4l_start_wait_dma()) < 0 )
+		if( (rv = vme4l_start_wait_dma( ch, pol )) < 0 )
 		  goto ABORT;
 
 		/* for VME reads, copy data to user space */
@@ -1419,22 +2463,55 @@ static int vme4l_bounce_dma( VME4L_SPACE spc, VME4L_RW_BLOCK *blk,
 
 	}
  ABORT:
-	up( &G_dmaMutex );
+	vme4l_dma_chan_put( ch );
 	VME4LDBG("<- vme4l_bounce_dma\n");
 	return rv < 0 ? rv : blk->size;
 }
 
+/***********************************************************************/
+/** Account a finished transfer in the space statistics
+ *
+ * \param spc			VME4L space number
+ * \param direction		0=read 1=write
+ * \param dma			transfer used DMA
+ * \param rv			number of bytes transferred or negative error
+ *						number (-EIO is a bus error)
+ */
+static void vme4l_stat_xfer( VME4L_SPACE spc, int direction, int dma, int rv )
+{
+	VME4L_SPACE_STATS *sp;
+	VME4L_PCPU_STATS *st;
+	unsigned long ps;
+
+	if( rv >= 0 || rv == -EIO ){
+		VME4L_STAT_BEGIN( st, ps );
+		sp = &st->s.spaces[spc];
+		if( rv == -EIO )
+			sp->busErrors++;
+		else if( dma )
+			sp->dmaBytes[direction ? 1 : 0] += rv;
+		else
+			sp->pioBytes[direction ? 1 : 0] += rv;
+		VME4L_STAT_END( st, ps );
+	}
+}
+
 /***********************************************************************/
 /** Handler for VME4L_IO_RW_BLOCK
  *
  * \param spc			VME4L space number
  * \param blk			ioctl argument from user
- * \return >=0 number of bytes transferred, or negative error number
  * \param swapMode		window swapping mode
+ * \param pol			DMA completion policy
+ * \return >=0 number of bytes transferred, or negative error number
  */
-int vme4l_rw(VME4L_SPACE spc, VME4L_RW_BLOCK *blk, int swapMode)
+static int vme4l_rw_pol(
+	VME4L_SPACE spc,
+	VME4L_RW_BLOCK *blk,
+	int swapMode,
+	const VME4L_DMA_POLICY *pol)
 {
-	int rv;
+	int rv, isDma;
 	VME4L_SPACE_ENT *spcEnt = &G_spaceTbl[spc];
 	VME4LDBG("vme4l_rw %s spc=%d vmeAddr=0x%lx acc=%d sz=0x%lx dataP=0x%p swp=0x%x\n",
 			 blk->direction ? "write":"read",
@@ -1445,7 +2522,9 @@ int vme4l_rw(VME4L_SPACE spc, VME4L_RW_BLOCK *blk, int swapMode)
 			 blk->dataP,
 			 swapMode );
 
-	if( spcEnt->isBlt || (blk->flags & VME4L_RW_USE_SGL_DMA))
+	isDma = spcEnt->isBlt || (blk->flags & VME4L_RW_USE_SGL_DMA);
+
+	if( isDma )
 	{
 		if( G_bDrv->dmaSetup == NULL ){
 			if( G_bDrv->dmaBounceSetup == NULL ){
@@ -1454,12 +2533,12 @@ int vme4l_rw(VME4L_SPACE spc, VME4L_RW_BLOCK *blk, int swapMode)
 			}
 			/* bounce buffer DMA */
 			VME4LDBG("calling vme4l_bounce_dma()\n" );
-			rv = vme4l_bounce_dma( spc, blk, swapMode );
+			rv = vme4l_bounce_dma( spc, blk, swapMode, pol );
 		}
 		else {
 			/* zero copy DMA */
 		        VME4LDBG("calling vme4l_zc_dma()\n" );
-			rv = vme4l_zc_dma( spc, blk, swapMode );
+			rv = vme4l_zc_dma( spc, blk, swapMode, pol );
 		}
 	}
 	else {
@@ -1480,72 +2559,781 @@ int vme4l_rw(VME4L_SPACE spc, VME4L_RW_BLOCK *blk, int swapMode)
 		       blk->flags,
 		       swapMode);
 
+	vme4l_stat_xfer( spc, blk->direction, isDma, rv );
+	trace_vme4l_rw( spc, blk->direction, blk->vmeAddr, blk->accWidth,
+					blk->size, blk->flags, isDma, rv );
+
  ABORT:
 	VME4LDBG("vme4l_rw exit rv=%d\n", rv);
 	return rv;
 }
 
 /***********************************************************************/
-/** Handler for VME4L_IO_RMW_CYCLE
+/** Read/write VME block using default DMA completion policy
  *
  * \param spc			VME4L space number
- * \param blk			ioctl argument from user
+ * \param blk			block description (kernel or user buffer)
  * \param swapMode		window swapping mode
  * \return >=0 number of bytes transferred, or negative error number
  */
-static int vme4l_rmw_cycle( VME4L_SPACE spc, VME4L_RMW_CYCLE *blk,
-							int swapMode )
+int vme4l_rw(VME4L_SPACE spc, VME4L_RW_BLOCK *blk, int swapMode)
 {
-	int rv, winFlags;
-	VME4L_ADRSWIN *win;
-	char *vaddr;
-	void *physAddr;
-	VME4L_SPACE_ENT *spcEnt = &G_spaceTbl[spc];
-
-	VME4LDBG("vme4l_rmw_cycle spc=%d vmeAddr=0x%08lx acc=%d mask=%x\n",
-			 spc, blk->vmeAddr, blk->accWidth, blk->mask);
-
-	winFlags = (swapMode & VME4L_HW_SWAP1) ?
-		VME4L_AW_HW_SWAP1 : 0;
-
-	if( spcEnt->isBlt )
-		rv = -EINVAL;
-	else {
-		if( (rv = vme4l_setup_pio( spc, blk->vmeAddr, blk->accWidth,
-								   blk->accWidth,
-								   winFlags, &win, &vaddr )) < 0)
-			goto ABORT;
-
-		physAddr = blk->vmeAddr - win->vmeAddr + win->physAddr;
-
-		if( G_bDrv->rmwCycle )
-			rv = G_bDrv->rmwCycle( G_bHandle, vaddr, physAddr, blk->accWidth,
-								   blk->mask, &blk->rv );
-		else
-			rv = -ENOTTY;
+	VME4L_DMA_POLICY pol;
 
-		/*--- release VME address mapping window ---*/
-		vme4l_release_adrswin( win );
-	}
- ABORT:
-	VME4LDBG("vme4l_rmw_cycle exit rv=%d\n", rv);
-	return rv;
+	vme4l_dma_policy_default( &pol );
+	return vme4l_rw_pol( spc, blk, swapMode, &pol );
 }
 
 /***********************************************************************/
-/** Handler for VME4L_IO_AONLY_CYCLE
+/** Handler for VME4L_IO_RW_VECTOR
+ *
+ * Transfers all segments within one call. Consecutive segments that use
+ * zero-copy DMA are mapped first and then transferred on one DMA channel,
+ * with pipelined descriptor chains if the bridge supports them. Other
+ * segments (PIO, bounce buffer DMA) are transferred in between with
+ * vme4l_rw_pol().
+ *
+ * The total size is capped at INT_MAX. If a segment fails after others
+ * were transferred, the number of bytes transferred before is returned.
  *
  * \param spc			VME4L space number
- * \param blk			ioctl argument from user
- * \param swapMode		window swapping mode
- * \return >=0 number of bytes transferred, or negative error number
+ * \param fp			file private data
+ * \param vec			ioctl argument from user
+ * \return >=0 total number of bytes transferred, or negative error number
  */
-static int vme4l_aonly_cycle( VME4L_SPACE spc, VME4L_AONLY_CYCLE *blk,
-							  int swapMode )
+static int vme4l_rw_vector(
+	VME4L_SPACE spc,
+	VME4L_FILE_PRIV *fp,
+	VME4L_RW_VECTOR *vec)
 {
-	int rv, winFlags;
-	VME4L_ADRSWIN *win;
-	char *vaddr;
+	VME4L_SPACE_ENT *spcEnt = &G_spaceTbl[spc];
+	VME4L_RW_BLOCK *blk = NULL;
+	VME4L_ZC_BUF *zc = NULL;
+	VME4L_DMA_SEG *seg = NULL;
+	int rv = 0, i, j, isZc, nZc = 0;
+	ssize_t total = 0;
+	size_t left = INT_MAX;
+	int zcAvail = G_bDrv->dmaSetup && vme4l_dma_dev();
+
+	if( vec->count == 0 )
+		return 0;
+
+	if( vec->count < 0 || vec->count > VME4L_RW_VECTOR_MAX )
+		return -EINVAL;
+
+	blk = kmalloc( vec->count * sizeof(*blk), GFP_KERNEL );
+	zc  = kmalloc( vec->count * sizeof(*zc), GFP_KERNEL );
+	seg = kmalloc( vec->count * sizeof(*seg), GFP_KERNEL );
+	if( blk == NULL || zc == NULL || seg == NULL ){
+		rv = -ENOMEM;
+		goto CLEANUP;
+	}
+
+	if( copy_from_user( blk, vec->blkP, vec->count * sizeof(*blk) )){
+		rv = -EFAULT;
+		goto CLEANUP;
+	}
+
+	for( i=0; i<vec->count; i++ ){
+		/* cap total size at INT_MAX, as rw_verify_area() */
+		if( blk[i].size > left )
+			blk[i].size = left;
+		left -= blk[i].size;
+
+		if( !access_ok( (blk[i].direction == WRITE) ? VERIFY_READ :
+						VERIFY_WRITE, blk[i].dataP, blk[i].size )){
+			rv = -EFAULT;
+			goto CLEANUP;
+		}
+		blk[i].flags &= ~VME4L_RW_KERNEL_SPACE_DMA;	/* user buffers only */
+	}
+
+	for( i=0; i<=vec->count; i++ ){
+		isZc = i < vec->count && zcAvail && blk[i].size != 0 &&
+			(spcEnt->isBlt || (blk[i].flags & VME4L_RW_USE_SGL_DMA));
+
+		if( isZc ){
+			/* collect DMA segments */
+			if( (rv = vme4l_zc_buf_map( blk[i].dataP, blk[i].size,
+										blk[i].direction, blk[i].flags,
+										&zc[nZc] )) < 0 )
+				goto CLEANUP;
+
+			vme4l_dma_seg_init( &seg[nZc], zc[nZc].sgList, zc[nZc].sgNelems,
+								blk[i].direction, blk[i].vmeAddr,
+								blk[i].flags );
+			nZc++;
+			continue;
+		}
+
+		/* transfer collected DMA segments */
+		if( nZc ){
+			rv = vme4l_perform_zc_dma( spc, seg, nZc, fp->swapMode,
+									   &fp->dmaPolicy );
+			/* a failed chain counts as error for each of its segments */
+			for( j=0; j<nZc; j++ ){
+				vme4l_stat_xfer( spc, zc[j].dmaDir == DMA_TO_DEVICE, 1,
+								 rv < 0 ? rv : zc[j].totlen );
+				if( rv >= 0 )
+					total += zc[j].totlen;
+				vme4l_zc_buf_unmap( &zc[j] );
+			}
+			nZc = 0;
+
+			if( rv < 0 )
+				goto CLEANUP;
+		}
+
+		if( i < vec->count ){
+			rv = vme4l_rw_pol( spc, &blk[i], fp->swapMode, &fp->dmaPolicy );
+			if( rv < 0 )
+				goto CLEANUP;
+			total += rv;
+		}
+	}
+	rv = total;
+
+ CLEANUP:
+	for( j=0; j<nZc; j++ )
+		vme4l_zc_buf_unmap( &zc[j] );
+
+	kfree( seg );
+	kfree( zc );
+	kfree( blk );
+
+	if (rv < 0){
+		VME4LERR(PFX "%s: rv=%d after 0x%zx bytes\n", __func__, rv, total);
+		/* report partial transfer, like read()/write() */
+		if( total > 0 )
+			rv = total;
+	}
+	return rv;
+}
+
+/***********************************************************************/
+/** Handler for VME4L_IO_PINBUF_REGISTER
+ *
+ * Pins and DMA maps the user buffer for both directions and stores it
+ * in the first free slot of the file's buffer table.
+ *
+ * \param fp			file private data
+ * \param blk			ioctl argument from user. blk->handle receives the
+ *						buffer handle
+ * \return 0 on success, or negative error number
+ */
+static int vme4l_pinbuf_register( VME4L_FILE_PRIV *fp, VME4L_PINBUF_REG *blk )
+{
+	VME4L_PINBUF *pb;
+	int rv, handle;
+
+	if( G_bDrv->dmaSetup == NULL )
+		return -ENOTTY;				/* no zero-copy DMA */
+
+	if( blk->size == 0 )
+		return -EINVAL;
+
+	if( (pb = kmalloc( sizeof(*pb), GFP_KERNEL )) == NULL )
+		return -ENOMEM;
+
+	pb->useCount = 0;
+
+	if( (rv = vme4l_zc_buf_map( blk->dataP, blk->size, VME4L_ZC_BIDIR,
+								VME4L_ZC_LONGTERM, &pb->zc )) < 0 ){
+		kfree( pb );
+		return rv;
+	}
+
+	spin_lock( &fp->pinLock );
+	for( handle=0; handle<VME4L_PINBUF_MAX; handle++ ){
+		if( fp->pinBuf[handle] == NULL ){
+			fp->pinBuf[handle] = pb;
+			break;
+		}
+	}
+	spin_unlock( &fp->pinLock );
+
+	if( handle == VME4L_PINBUF_MAX ){
+		vme4l_zc_buf_unmap( &pb->zc );
+		kfree( pb );
+		return -ENOSPC;
+	}
+
+	VME4LDBG("vme4l_pinbuf_register: handle %d %d elems 0x%x bytes\n",
+			 handle, pb->zc.sgNelems, pb->zc.totlen );
+
+	blk->handle = handle;
+	return 0;
+}
+
+/***********************************************************************/
+/** Handler for VME4L_IO_PINBUF_UNREGISTER
+ *
+ * \param fp			file private data
+ * \param handle		handle from vme4l_pinbuf_register()
+ * \return 0 on success, or negative error number
+ */
+static int vme4l_pinbuf_unregister( VME4L_FILE_PRIV *fp, int handle )
+{
+	VME4L_PINBUF *pb;
+	int rv = 0;
+
+	if( handle < 0 || handle >= VME4L_PINBUF_MAX )
+		return -EINVAL;
+
+	spin_lock( &fp->pinLock );
+	pb = fp->pinBuf[handle];
+	if( pb == NULL )
+		rv = -EINVAL;
+	else if( pb->useCount )
+		rv = -EBUSY;				/* transfer running */
+	else
+		fp->pinBuf[handle] = NULL;
+	spin_unlock( &fp->pinLock );
+
+	if( rv == 0 ){
+		vme4l_zc_buf_unmap( &pb->zc );
+		kfree( pb );
+	}
+	return rv;
+}
+
+/***********************************************************************/
+/** Release all buffers registered for a file (called on close)
+ *
+ * \param fp			file private data
+ */
+static void vme4l_pinbuf_release( VME4L_FILE_PRIV *fp )
+{
+	int handle;
+
+	for( handle=0; handle<VME4L_PINBUF_MAX; handle++ ){
+		if( fp->pinBuf[handle] ){
+			vme4l_zc_buf_unmap( &fp->pinBuf[handle]->zc );
+			kfree( fp->pinBuf[handle] );
+			fp->pinBuf[handle] = NULL;
+		}
+	}
+}
+
+/***********************************************************************/
+/** Cache maintenance for the part of a registered buffer used by a DMA
+ *
+ * Syncs only the bytes transferred, in the transfer direction, so the
+ * cost doesn't depend on the buffer size and CPU writes to other parts
+ * of the buffer are not discarded.
+ *
+ * \param pb			registered buffer
+ * \param src			first element of pb->zc.sgList touched
+ * \param off			offset within \a src
+ * \param size			number of bytes transferred
+ * \param direction		0=read from VME 1=write to VME
+ * \param forCpu		0=before DMA, 1=after DMA
+ */
+static void vme4l_pinbuf_sync(
+	VME4L_PINBUF *pb,
+	const VME4L_SCATTER_ELEM *src,
+	size_t off,
+	size_t size,
+	int direction,
+	int forCpu)
+{
+	enum dma_data_direction dir =
+		direction == READ ? DMA_FROM_DEVICE : DMA_TO_DEVICE;
+	size_t n;
+
+	/* nothing to do for the CPU after writing to VME */
+	if( forCpu && direction != READ )
+		return;
+
+	for( ; size > 0; src++, off = 0 ){
+		n = min_t( size_t, src->dmaLength - off, size );
+		if( forCpu )
+			dma_sync_single_for_cpu( pb->zc.pDev, src->dmaAddress + off,
+									 n, dir );
+		else
+			dma_sync_single_for_device( pb->zc.pDev, src->dmaAddress + off,
+										n, dir );
+		size -= n;
+	}
+}
+
+/***********************************************************************/
+/** Handler for VME4L_IO_RW_PINNED
+ *
+ * Builds the scatter list for the requested part of a registered buffer
+ * from the buffer's prebuilt list and performs a zero-copy DMA. Only
+ * the cache maintenance of the transferred part is done per transfer.
+ *
+ * \param spc			VME4L space number
+ * \param fp			file private data
+ * \param blk			ioctl argument from user
+ * \return >=0 number of bytes transferred, or negative error number
+ */
+static int vme4l_pinbuf_dma(
+	VME4L_SPACE spc,
+	VME4L_FILE_PRIV *fp,
+	VME4L_RW_PINNED *blk)
+{
+	VME4L_SCATTER_ELEM sgStack[VME4L_PINBUF_SG_STACK];
+	VME4L_SCATTER_ELEM *sgList = sgStack, *src;
+	VME4L_SPACE_ENT *spcEnt = &G_spaceTbl[spc];
+	VME4L_PINBUF *pb = NULL;
+	VME4L_DMA_SEG seg;
+	size_t off, len;
+	int rv, nElems;
+
+	if( blk->handle < 0 || blk->handle >= VME4L_PINBUF_MAX )
+		return -EINVAL;
+
+	/* DMA capable master space only, as VME4L_IO_RW_BLOCK */
+	if( spcEnt->isSlv ||
+		!(spcEnt->isBlt || (blk->flags & VME4L_RW_USE_SGL_DMA)) )
+		return -EINVAL;
+
+	if( blk->direction != READ && blk->direction != WRITE )
+		return -EINVAL;
+
+	if( blk->size == 0 )
+		return 0;
+
+	/* byte count is returned as int */
+	if( blk->size > INT_MAX )
+		return -EINVAL;
+
+	spin_lock( &fp->pinLock );
+	if( (pb = fp->pinBuf[blk->handle]) != NULL )
+		pb->useCount++;
+	spin_unlock( &fp->pinLock );
+
+	if( pb == NULL )
+		return -EINVAL;
+
+	if( blk->offset > pb->zc.totlen ||
+		blk->size > pb->zc.totlen - blk->offset ){
+		rv = -EINVAL;
+		goto ABORT;
+	}
+
+	/* find first element and count elements touched */
+	src = pb->zc.sgList;
+	for( off = blk->offset; off >= src->dmaLength; src++ )
+		off -= src->dmaLength;
+
+	for( nElems=0, len=0; len < off + blk->size; nElems++ )
+		len += src[nElems].dmaLength;
+
+	if( nElems > VME4L_PINBUF_SG_STACK ){
+		sgList = kmalloc( nElems * sizeof(*sgList), GFP_KERNEL );
+		if( sgList == NULL ){
+			rv = -ENOMEM;
+			goto ABORT;
+		}
+	}
+
+	/* copy elements and trim first and last one */
+	memcpy( sgList, src, nElems * sizeof(*sgList) );
+	sgList[0].dmaAddress += off;
+	sgList[0].dmaLength  -= off;
+	sgList[nElems-1].dmaLength -= len - (off + blk->size);
+
+	vme4l_pinbuf_sync( pb, src, off, blk->size, blk->direction, 0 );
+
+	vme4l_dma_seg_init( &seg, sgList, nElems, blk->direction, blk->vmeAddr,
+						blk->flags );
+	rv = vme4l_perform_zc_dma( spc, &seg, 1, fp->swapMode, &fp->dmaPolicy );
+	vme4l_stat_xfer( spc, blk->direction, 1, rv < 0 ? rv : blk->size );
+
+	vme4l_pinbuf_sync( pb, src, off, blk->size, blk->direction, 1 );
+
+	if( sgList != sgStack )
+		kfree( sgList );
+
+ ABORT:
+	spin_lock( &fp->pinLock );
+	pb->useCount--;
+	spin_unlock( &fp->pinLock );
+
+	if (rv < 0)
+		VME4LERR(PFX "%s: rv=%d\n", __func__, rv);
+
+	return rv < 0 ? rv : (int)blk->size;
+}
+
+/***********************************************************************/
+/** Post completion entry for asynchronous DMA request and free request
+ *
+ * \param ctx			asynchronous DMA context
+ * \param req			completed request
+ * \param result		bytes transferred or negative error number
+ */
+static void vme4l_async_complete(
+	VME4L_ASYNC_CTX *ctx,
+	VME4L_ASYNC_REQ *req,
+	int result)
+{
+	VME4L_ASYNC_CQE *cqe;
+
+	spin_lock( &ctx->lock );
+	cqe = &ctx->cq[ctx->hdr->cqTail & ctx->mask];
+	cqe->userData = req->sqe.userData;
+	cqe->result = result;
+	smp_wmb();			/* CQE must be visible before new tail */
+	ctx->hdr->cqTail++;
+	ctx->inFlight--;
+	spin_unlock( &ctx->lock );
+
+	kfree( req );
+	wake_up_interruptible( &ctx->cqWq );
+}
+
+/***********************************************************************/
+/** Worker that feeds pending asynchronous requests into the DMA engine
+ *
+ * Buffers have already been pinned/mapped in the submitter's context,
+ * so this only has to start the DMA and post the completion.
+ *
+ * \param work			&ctx->work
+ */
+static void vme4l_async_work( struct work_struct *work )
+{
+	VME4L_ASYNC_CTX *ctx = container_of( work, VME4L_ASYNC_CTX, work );
+	VME4L_ASYNC_REQ *req;
+	VME4L_DMA_SEG seg;
+	int rv;
+
+	for(;;){
+		spin_lock( &ctx->lock );
+		if( list_empty( &ctx->lstPending )){
+			spin_unlock( &ctx->lock );
+			break;
+		}
+		req = list_entry( ctx->lstPending.next, VME4L_ASYNC_REQ, node );
+		list_del( &req->node );
+		spin_unlock( &ctx->lock );
+
+		vme4l_dma_seg_init( &seg, req->zc.sgList, req->zc.sgNelems,
+							req->sqe.direction, req->sqe.vmeAddr,
+							req->sqe.flags );
+		rv = vme4l_perform_zc_dma( ctx->spc, &seg, 1, req->swapMode,
+								   &req->dmaPolicy );
+		vme4l_zc_buf_unmap( &req->zc );
+
+		if( rv >= 0 )
+			rv = req->zc.totlen;
+		else
+			VME4LERR(PFX "%s: rv=%d\n", __func__, rv);
+
+		vme4l_async_complete( ctx, req, rv );
+	}
+}
+
+/***********************************************************************/
+/** Handler for VME4L_IO_ASYNC_SETUP
+ *
+ * Allocates the submission/completion rings of \a fp. The rings stay
+ * until the file is closed.
+ *
+ * \param fp			file private data
+ * \param blk			ioctl argument from user
+ * \return 0=ok, or negative error number
+ */
+static int vme4l_async_setup( VME4L_FILE_PRIV *fp, VME4L_ASYNC_SETUP *blk )
+{
+	VME4L_ASYNC_CTX *ctx;
+	uint32_t entries = blk->entries;
+	uint32_t sqOff, cqOff;
+
+	if( G_bDrv->dmaSetup == NULL || G_spaceTbl[fp->minor].isSlv )
+		return -ENOTTY;
+
+	if( fp->async != NULL )
+		return -EBUSY;
+
+	if( entries == 0 || entries > VME4L_ASYNC_MAX_ENTRIES ||
+		(entries & (entries - 1)) )
+		return -EINVAL;
+
+	if( (ctx = kmalloc( sizeof(*ctx), GFP_KERNEL )) == NULL )
+		return -ENOMEM;
+	memset( ctx, 0, sizeof(*ctx) );
+
+	sqOff = sizeof(VME4L_ASYNC_RING_HDR);
+	cqOff = sqOff + entries * sizeof(VME4L_ASYNC_SQE);
+	ctx->mapSize = PAGE_ALIGN( cqOff + entries * sizeof(VME4L_ASYNC_CQE) );
+
+	/* zeroed and suitable for remap_vmalloc_range() */
+	if( (ctx->hdr = vmalloc_user( ctx->mapSize )) == NULL ){
+		kfree( ctx );
+		return -ENOMEM;
+	}
+
+	ctx->hdr->entries = entries;
+	ctx->hdr->sqOff = sqOff;
+	ctx->hdr->cqOff = cqOff;
+	ctx->sq = (VME4L_ASYNC_SQE *)((char *)ctx->hdr + sqOff);
+	ctx->cq = (VME4L_ASYNC_CQE *)((char *)ctx->hdr + cqOff);
+	ctx->mask = entries - 1;
+	ctx->spc = fp->minor;
+
+	INIT_LIST_HEAD( &ctx->lstPending );
+	spin_lock_init( &ctx->lock );
+	sema_init( &ctx->submitSem, 1 );
+	INIT_WORK( &ctx->work, vme4l_async_work );
+	init_waitqueue_head( &ctx->cqWq );
+
+	fp->async = ctx;
+	blk->mapSize = ctx->mapSize;
+
+	VME4LDBG("vme4l_async_setup: entries=%d mapSize=0x%x\n", entries,
+			 ctx->mapSize );
+	return 0;
+}
+
+/***********************************************************************/
+/** Handler for VME4L_IO_ASYNC_SUBMIT
+ *
+ * Consumes up to \a count entries from the submission queue. The user
+ * buffers are pinned and mapped here (in the caller's context), then
+ * the requests are handed to the async worker.
+ *
+ * Requests that cannot be started (e.g. non-DMA space, bad buffer)
+ * consume their entry and are completed immediately with an error.
+ * No more requests are consumed than free completion queue entries.
+ *
+ * \param fp			file private data
+ * \param count			max. number of entries to consume
+ * \return >=0 number of entries consumed, or negative error number
+ */
+static int vme4l_async_submit( VME4L_FILE_PRIV *fp, unsigned int count )
+{
+	VME4L_ASYNC_CTX *ctx = fp->async;
+	VME4L_SPACE_ENT *spcEnt = &G_spaceTbl[fp->minor];
+	VME4L_ASYNC_REQ *req;
+	uint32_t head, tail;
+	int n = 0, full, rv = 0, queued = 0;
+
+	if( ctx == NULL )
+		return -EINVAL;
+
+	if( down_interruptible( &ctx->submitSem ))
+		return -ERESTARTSYS;
+
+	head = ctx->hdr->sqHead;
+	tail = ctx->hdr->sqTail;
+	smp_rmb();			/* read SQEs after tail */
+
+	if( tail - head > ctx->mask + 1 ){
+		rv = -EINVAL;	/* user corrupted ring indices */
+		goto ABORT;
+	}
+
+	while( n < count && head != tail ){
+
+		/* reserve completion queue entry */
+		spin_lock( &ctx->lock );
+		full = (ctx->hdr->cqTail - ctx->hdr->cqHead) + ctx->inFlight
+			> ctx->mask;
+		if( !full )
+			ctx->inFlight++;
+		spin_unlock( &ctx->lock );
+
+		if( full ){
+			if( n == 0 )
+				rv = -EBUSY;
+			break;
+		}
+
+		if( (req = kmalloc( sizeof(*req), GFP_KERNEL )) == NULL ){
+			spin_lock( &ctx->lock );
+			ctx->inFlight--;
+			spin_unlock( &ctx->lock );
+			rv = -ENOMEM;
+			break;
+		}
+
+		req->sqe = ctx->sq[head & ctx->mask];
+		req->swapMode = fp->swapMode;
+		req->dmaPolicy = fp->dmaPolicy;
+		ctx->hdr->sqHead = ++head;
+		n++;
+
+		VME4LDBG("vme4l_async_submit: %s vmeAddr=0x%lx sz=0x%lx "
+				 "dataP=%p\n", req->sqe.direction ? "write":"read",
+				 req->sqe.vmeAddr, req->sqe.size, req->sqe.dataP );
+
+		/* user must not request kernel address DMA */
+		req->sqe.flags &= ~VME4L_RW_KERNEL_SPACE_DMA;
+
+		if( !(spcEnt->isBlt || (req->sqe.flags & VME4L_RW_USE_SGL_DMA)) ){
+			vme4l_async_complete( ctx, req, -EINVAL );
+			continue;
+		}
+		if( req->sqe.size == 0 ){
+			vme4l_async_complete( ctx, req, 0 );
+			continue;
+		}
+		if( !access_ok( (req->sqe.direction == WRITE) ?
+						VERIFY_READ : VERIFY_WRITE,
+						req->sqe.dataP, req->sqe.size )){
+			vme4l_async_complete( ctx, req, -EFAULT );
+			continue;
+		}
+		if( (rv = vme4l_zc_buf_map( req->sqe.dataP, req->sqe.size,
+									req->sqe.direction, req->sqe.flags,
+									&req->zc )) < 0 ){
+			vme4l_async_complete( ctx, req, rv );
+			rv = 0;
+			continue;
+		}
+
+		spin_lock( &ctx->lock );
+		list_add_tail( &req->node, &ctx->lstPending );
+		spin_unlock( &ctx->lock );
+		queued++;
+	}
+
+	if( queued )
+		queue_work( G_asyncWq, &ctx->work );
+
+ ABORT:
+	up( &ctx->submitSem );
+	return n ? n : rv;
+}
+
+/***********************************************************************/
+/** Check if enough completion entries are available
+ *
+ * \param ctx			asynchronous DMA context
+ * \param minComplete	number of completion entries requested
+ * \return true if at least \a minComplete entries are available or no
+ *		   more requests are in flight
+ */
+static int vme4l_async_cq_ready( VME4L_ASYNC_CTX *ctx,
+								 unsigned int minComplete )
+{
+	int ready;
+
+	spin_lock( &ctx->lock );
+	ready = (ctx->hdr->cqTail - ctx->hdr->cqHead) >= minComplete ||
+		ctx->inFlight == 0;
+	spin_unlock( &ctx->lock );
+
+	return ready;
+}
+
+/***********************************************************************/
+/** Handler for VME4L_IO_ASYNC_WAIT
+ *
+ * \param fp			file private data
+ * \param minComplete	number of completion entries to wait for
+ * \return >=0 number of completion entries available,
+ *		   or negative error number
+ */
+static int vme4l_async_wait( VME4L_FILE_PRIV *fp, unsigned int minComplete )
+{
+	VME4L_ASYNC_CTX *ctx = fp->async;
+
+	if( ctx == NULL || minComplete > ctx->mask + 1 )
+		return -EINVAL;
+
+	if( wait_event_interruptible( ctx->cqWq,
+								  vme4l_async_cq_ready( ctx, minComplete )))
+		return -ERESTARTSYS;
+
+	return ctx->hdr->cqTail - ctx->hdr->cqHead;
+}
+
+/***********************************************************************/
+/** Map asynchronous DMA rings to user space
+ *
+ * \param ctx			asynchronous DMA context
+ * \param vma			vm_area_struct
+ * \return 				0=ok, or negative error number
+ */
+static int vme4l_async_mmap( VME4L_ASYNC_CTX *ctx, struct vm_area_struct *vma )
+{
+	if( vma->vm_pgoff != 0 ||
+		(vma->vm_end - vma->vm_start) > ctx->mapSize )
+		return -EINVAL;
+
+	return remap_vmalloc_range( vma, ctx->hdr, 0 );
+}
+
+/***********************************************************************/
+/** Free asynchronous DMA context
+ *
+ * Waits until all pending requests of \a ctx have been executed.
+ *
+ * \param ctx			asynchronous DMA context
+ */
+static void vme4l_async_release( VME4L_ASYNC_CTX *ctx )
+{
+	flush_work( &ctx->work );
+	vfree( ctx->hdr );
+	kfree( ctx );
+}
+
+/***********************************************************************/
+/** Handler for VME4L_IO_RMW_CYCLE
+ *
+ * \param spc			VME4L space number
+ * \param blk			ioctl argument from user
+ * \param swapMode		window swapping mode
+ * \return >=0 number of bytes transferred, or negative error number
+ */
+static int vme4l_rmw_cycle( VME4L_SPACE spc, VME4L_RMW_CYCLE *blk,
+							int swapMode )
+{
+	int rv, winFlags;
+	VME4L_ADRSWIN *win;
+	char *vaddr;
+	void *physAddr;
+	VME4L_SPACE_ENT *spcEnt = &G_spaceTbl[spc];
+
+	VME4LDBG("vme4l_rmw_cycle spc=%d vmeAddr=0x%08lx acc=%d mask=%x\n",
+			 spc, blk->vmeAddr, blk->accWidth, blk->mask);
+
+	winFlags = (swapMode & VME4L_HW_SWAP1) ?
+		VME4L_AW_HW_SWAP1 : 0;
+
+	if( spcEnt->isBlt )
+		rv = -EINVAL;
+	else {
+		if( (rv = vme4l_setup_pio( spc, blk->vmeAddr, blk->accWidth,
+								   blk->accWidth,
+								   winFlags, &win, &vaddr )) < 0)
+			goto ABORT;
+
+		physAddr = blk->vmeAddr - win->vmeAddr + win->physAddr;
+
+		if( G_bDrv->rmwCycle )
+			rv = G_bDrv->rmwCycle( G_bHandle, vaddr, physAddr, blk->accWidth,
+								   blk->mask, &blk->rv );
+		else
+			rv = -ENOTTY;
+
+		/*--- release VME address mapping window ---*/
+		vme4l_release_adrswin( win );
+	}
+ ABORT:
+	VME4LDBG("vme4l_rmw_cycle exit rv=%d\n", rv);
+	return rv;
+}
+
+/***********************************************************************/
+/** Handler for VME4L_IO_AONLY_CYCLE
+ *
+ * \param spc			VME4L space number
+ * \param blk			ioctl argument from user
+ * \param swapMode		window swapping mode
+ * \return >=0 number of bytes transferred, or negative error number
+ */
+static int vme4l_aonly_cycle( VME4L_SPACE spc, VME4L_AONLY_CYCLE *blk,
+							  int swapMode )
+{
+	int rv, winFlags;
+	VME4L_ADRSWIN *win;
+	char *vaddr;
 	VME4L_SPACE_ENT *spcEnt = &G_spaceTbl[spc];
 
 	VME4LDBG("vme4l_aonly_cycle spc=%d vmeAddr=0x%08lx\n",
@@ -1708,12 +3496,22 @@ static int vme4l_irqlevel_disable( int level )
 
 
 
+/***********************************************************************/
+/** Check if the level must stay masked until the handler of \a ent ran
+ */
+static inline int vme4l_irq_entry_rora( VME4L_IRQ_ENTRY *ent )
+{
+	return ent->entType == VME4L_KERNEL_IRQ ||
+		!(ent->flags & VME4L_IRQ_ROAK);
+}
+
 /***********************************************************************/
 /** Install IRQ vector entry
  *
  * \param entry			irq entry struct to install
  * \param vector		vector to install entry
- * \return 0 on success or negative error number
+ * \return 0 on success or negative error number. On error, \a ent has
+ *		   not been published and can be freed at once.
  *
  * \brief				This function simply hooks the new vme handler
  *						into the global G_vectTbl[] vector table.
@@ -1723,93 +3521,534 @@ static int vme4l_irq_install( VME4L_IRQ_ENTRY *ent, int vme_vector )
 	unsigned long ps;
 	int rv=0;
 
-	if( vme_vector >= VME4L_NUM_VECTORS )
+	if( vme_vector < 0 || vme_vector >= VME4L_NUM_VECTORS )
+		return -EINVAL;
+
+	VME4L_LOCK_VECTORS(ps);
+
+	/*
+	 * enable irq if requested. Before publishing the entry: once
+	 * vme4l_irq() can see it, the caller may no longer free it on error.
+	 */
+	if( ent->flags & VME4L_IRQ_ENBL )
+		rv = vme4l_irqlevel_enable( ent->level );
+
+	if( rv == 0 ){
+		list_add_tail_rcu( &ent->node, &G_vectTbl[vme_vector] );
+		if( vme4l_irq_entry_rora( ent ))
+			G_vectRora[vme_vector]++;
+	}
+
+	VME4L_UNLOCK_VECTORS(ps);
+
+	return rv;
+}
+
+/***********************************************************************/
+/** Free IRQ vector entries removed from G_vectTbl[]
+ *
+ * Waits until vme4l_irq() can no longer reference them.
+ *
+ * \param ent			first entry of chain linked by nextFree or NULL
+ */
+static void vme4l_irq_entries_free( VME4L_IRQ_ENTRY *ent )
+{
+	VME4L_IRQ_ENTRY *next;
+
+	if( ent == NULL )
+		return;
+
+	synchronize_rcu();
+
+	for( ; ent; ent = next ){
+		next = ent->nextFree;
+		if( ent->entType == VME4L_EVENT_IRQ && ent->u.event.efd )
+			eventfd_ctx_put( ent->u.event.efd );
+		kfree( ent );
+	}
+}
+
+/***********************************************************************/
+/** Handler for VME4L_IO_SIG_INSTALL2
+ *
+ * \param blk			ioctl argument from user
+ * \return 0 on success or negative error number
+ */
+static int vme4l_signal_install( VME4L_SIG_INSTALL2 *blk, struct file *file )
+{
+	VME4L_IRQ_ENTRY *ent;
+	int rv;
+	VME4LDBG("%s()\n", __FUNCTION__ );
+	if( (ent = kmalloc( sizeof( *ent ), GFP_KERNEL )) == NULL )
+		return -ENOMEM;
+	memset( ent, 0, sizeof(*ent));
+
+	ent->flags	 		= blk->flags;
+	ent->level 			= blk->level;
+	ent->u.user.signal	= blk->signal;
+	ent->u.user.task	= current;
+	ent->u.user.file	= file;
+
+	/* install a LINUX USER irq (aka signal..)*/
+	ent->entType		= VME4L_USER_IRQ;
+	if( (rv = vme4l_irq_install( ent, blk->vector )) < 0 )
+		kfree( ent );
+
+	return rv;
+}
+
+
+
+/***********************************************************************/
+/** Handler for VME4L_IO_SIG_UNINSTALL
+ *
+ * This removes \b all installed signals on this vector for the current
+ * process created on top of \a file
+ *
+ * \param vector		vector to uninstall
+ * \param file			only vectors associated with \a file are removed
+ *
+ * \return 0 on success or negative error number
+ */
+static int vme4l_signal_uninstall( int vector, struct file *file )
+{
+	VME4L_IRQ_ENTRY *ent, *tmp, *freeLst = NULL;
+	unsigned long ps;
+
+	if( vector >= VME4L_NUM_VECTORS )
+		return -EINVAL;
+
+	VME4L_LOCK_VECTORS(ps);
+
+	list_for_each_entry_safe( ent, tmp, &G_vectTbl[vector], node ){
+		if( ent->entType == VME4L_USER_IRQ ){
+			if( ent->u.user.task == current && ent->u.user.file == file ){
+
+				/* remove entry, free it after grace period */
+				list_del_rcu( &ent->node );
+				if( vme4l_irq_entry_rora( ent ))
+					G_vectRora[vector]--;
+				ent->nextFree = freeLst;
+				freeLst = ent;
+			}
+		}
+	}
+	VME4L_UNLOCK_VECTORS(ps);
+
+	vme4l_irq_entries_free( freeLst );
+	return 0;
+}
+
+/***********************************************************************/
+/** Handler for VME4L_IO_EVENT_INSTALL
+ *
+ * Binds \a blk->vector to an eventfd or, when \a blk->eventFd is negative,
+ * to the event queue of \a file, which is read by vme4l_read().
+ *
+ * \param blk			ioctl argument from user
+ * \param file			file the event is bound to
+ * \return 0 on success or negative error number
+ */
+static int vme4l_event_install( VME4L_EVENT_INSTALL *blk, struct file *file )
+{
+	VME4L_IRQ_ENTRY *ent;
+	int rv;
+
+	VME4LDBG("%s() vector=%d efd=%d\n", __FUNCTION__, blk->vector,
+			 blk->eventFd );
+
+	if( blk->vector < 0 )
+		return -EINVAL;
+
+	if( (ent = kmalloc( sizeof( *ent ), GFP_KERNEL )) == NULL )
+		return -ENOMEM;
+	memset( ent, 0, sizeof(*ent));
+
+	ent->flags	 		= blk->flags;
+	ent->level 			= blk->level;
+	ent->u.event.file	= file;
+	ent->u.event.fp		= (VME4L_FILE_PRIV *)file->private_data;
+
+	if( blk->eventFd >= 0 ){
+		ent->u.event.efd = eventfd_ctx_fdget( blk->eventFd );
+		if( IS_ERR( ent->u.event.efd )){
+			rv = PTR_ERR( ent->u.event.efd );
+			kfree( ent );
+			return rv;
+		}
+	}
+
+	ent->entType		= VME4L_EVENT_IRQ;
+	if( (rv = vme4l_irq_install( ent, blk->vector )) < 0 ){
+		if( ent->u.event.efd )
+			eventfd_ctx_put( ent->u.event.efd );
+		kfree( ent );
+	}
+
+	return rv;
+}
+
+/***********************************************************************/
+/** Handler for VME4L_IO_EVENT_UNINSTALL
+ *
+ * This removes \b all events on this vector bound to \a file
+ *
+ * \param vector		vector to uninstall
+ * \param file			only events associated with \a file are removed
+ *
+ * \return 0 on success or negative error number
+ */
+static int vme4l_event_uninstall( int vector, struct file *file )
+{
+	VME4L_IRQ_ENTRY *ent, *tmp, *freeLst = NULL;
+	unsigned long ps;
+
+	if( vector < 0 || vector >= VME4L_NUM_VECTORS )
 		return -EINVAL;
 
-	VME4L_LOCK_VECTORS(ps);
+	VME4L_LOCK_VECTORS(ps);
+
+	list_for_each_entry_safe( ent, tmp, &G_vectTbl[vector], node ){
+		if( ent->entType == VME4L_EVENT_IRQ && ent->u.event.file == file ){
+			list_del_rcu( &ent->node );
+			if( vme4l_irq_entry_rora( ent ))
+				G_vectRora[vector]--;
+			ent->nextFree = freeLst;
+			freeLst = ent;
+		}
+	}
+	VME4L_UNLOCK_VECTORS(ps);
+
+	vme4l_irq_entries_free( freeLst );
+	return 0;
+}
+
+/***********************************************************************/
+/** Remove all signals and events bound to a file (called on close)
+ *
+ * Unlinks the entries of all vectors first, so only one RCU grace
+ * period is waited for, no matter how many vectors were installed.
+ *
+ * \param file			file being released
+ */
+static void vme4l_irq_file_release( struct file *file )
+{
+	VME4L_IRQ_ENTRY *ent, *tmp, *freeLst = NULL;
+	unsigned long ps;
+	int vector;
+
+	for( vector=0; vector<VME4L_NUM_VECTORS; vector++ ){
+		VME4L_LOCK_VECTORS(ps);
+
+		list_for_each_entry_safe( ent, tmp, &G_vectTbl[vector], node ){
+			if( (ent->entType == VME4L_USER_IRQ &&
+				 ent->u.user.file == file) ||
+				(ent->entType == VME4L_EVENT_IRQ &&
+				 ent->u.event.file == file) ){
+				list_del_rcu( &ent->node );
+				if( vme4l_irq_entry_rora( ent ))
+					G_vectRora[vector]--;
+				ent->nextFree = freeLst;
+				freeLst = ent;
+			}
+		}
+		VME4L_UNLOCK_VECTORS(ps);
+	}
+
+	vme4l_irq_entries_free( freeLst );
+}
+
+/***********************************************************************/
+/** Get timestamp for interrupt latency measurement
+ *
+ * \return CLOCK_MONOTONIC time in ns
+ */
+static inline uint64_t vme4l_lat_now( void )
+{
+	return ktime_to_ns( ktime_get() );
+}
+
+/***********************************************************************/
+/** Add a latency to a histogram
+ *
+ * \param hist		histogram
+ * \param ns		latency in ns
+ */
+static void vme4l_lat_add( VME4L_LAT_HIST *hist, uint64_t ns )
+{
+	uint64_t us = div_u64( ns, NSEC_PER_USEC );
+	int n = us ? fls64( us ) : 0;
+	uint32_t ns32 = ns > U32_MAX ? U32_MAX : (uint32_t)ns;
+
+	if( n >= VME4L_LAT_BUCKETS )
+		n = VME4L_LAT_BUCKETS - 1;
+	atomic_inc( &hist->bucket[n] );
+
+	if( ns > (uint64_t)READ_ONCE( irq_lat_budget_us ) * NSEC_PER_USEC )
+		atomic_inc( &hist->over );
+
+	if( ns32 > READ_ONCE( hist->maxNs ))
+		WRITE_ONCE( hist->maxNs, ns32 );
+}
+
+/***********************************************************************/
+/** Add a latency to the histogram of an interrupt path stage of \a level
+ *
+ * \param level		interrupt level
+ * \param stage		VME4L_LAT_xxx
+ * \param ns		latency in ns
+ */
+static void vme4l_lat_level( int level, int stage, uint64_t ns )
+{
+	if( level >= 0 && level < VME4L_NUM_LEVELS )
+		vme4l_lat_add( &G_latLev[level][stage], ns );
+}
+
+/***********************************************************************/
+/** Clear an interrupt latency histogram
+ */
+static void vme4l_lat_clear( VME4L_LAT_HIST *hist )
+{
+	int n;
+
+	for( n=0; n<VME4L_LAT_BUCKETS; n++ )
+		atomic_set( &hist->bucket[n], 0 );
+	atomic_set( &hist->over, 0 );
+	WRITE_ONCE( hist->maxNs, 0 );
+}
+
+/***********************************************************************/
+/** Clear all interrupt latency histograms
+ */
+static void vme4l_lat_reset( void )
+{
+	int i, n;
+
+	for( i=0; i<VME4L_NUM_LEVELS; i++ )
+		for( n=0; n<VME4L_LAT_STAGES; n++ )
+			vme4l_lat_clear( &G_latLev[i][n] );
+	for( i=0; i<VME4L_NUM_VECTORS; i++ )
+		vme4l_lat_clear( &G_latVect[i] );
+}
+
+/***********************************************************************/
+/** Deliver an interrupt to an event entry
+ *
+ * Signals the eventfd or appends a record to the file's event queue.
+ * When the queue is full the record is dropped and counted in the
+ * \em lost field of the next queued record.
+ *
+ * \param ent			VME4L_EVENT_IRQ entry from G_vectTbl
+ * \param level			interrupt level
+ * \param vector		interrupt vector
+ * \param t0			bridge irq entry time (ns) or 0 if unknown
+ */
+static void vme4l_event_post( VME4L_IRQ_ENTRY *ent, int level, int vector,
+							  uint64_t t0 )
+{
+	VME4L_FILE_PRIV *fp = ent->u.event.fp;
+	VME4L_EVENT *ev;
+	unsigned long ps;
+
+	if( ent->u.event.efd ){
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,8,0)
+		eventfd_signal( ent->u.event.efd );
+#else
+		eventfd_signal( ent->u.event.efd, 1 );
+#endif
+		return;
+	}
+
+	spin_lock_irqsave( &fp->evLock, ps );
+
+	if( fp->evHead - fp->evTail >= VME4L_EVENT_QUEUE_LEN ){
+		fp->evLost++;
+		spin_unlock_irqrestore( &fp->evLock, ps );
+		return;
+	}
+
+	ev = &fp->evQ[fp->evHead % VME4L_EVENT_QUEUE_LEN];
+	ev->vector		= vector;
+	ev->level		= level;
+	ev->lost		= fp->evLost;
+	ev->reserved	= 0;
+	ev->timeNs		= t0 ? t0 : vme4l_lat_now();
+	fp->evLost		= 0;
+	fp->evHead++;
+
+	spin_unlock_irqrestore( &fp->evLock, ps );
+
+	wake_up_interruptible( &fp->evWq );
+}
+
+
+/***********************************************************************/
+/** Dispatch a VME interrupt to the handlers installed for \a vector
+ *
+ * Called from vme4l_irq() in hard irq context or from vme4l_irq_thread().
+ *
+ * \param level		the interrupt level code, see \ref VME4L_IRQLEV
+ * \param vector 	VME vector or pseudo vector
+ * \param regs		regs argument passed to bridge irq (for whatever)
+ * \param t0		bridge irq entry time (ns), 0 if latency not measured
+ *
+ * \brief   the occuring Interrupts are dispatched to one of
+ *		   	the possible handling environments. These are:
+ *
+ *		   	- Linux Kernel handlers  ent->entType = VME4L_KERNEL_IRQ
+ *		   	- Linux Usermode signals ent->entType = VME4L_USER_IRQ
+ *		   	- eventfd / read() queue ent->entType = VME4L_EVENT_IRQ
+ *
+ *			The handler lists are walked under rcu_read_lock(), so
+ *			installing or removing handlers never blocks dispatching.
+ */
+static void vme4l_irq_dispatch( int level, int vector, struct pt_regs *regs,
+								uint64_t t0 )
+{
+	VME4L_IRQ_ENTRY *ent;
+	unsigned long ps;
+	uint64_t t1 = 0, t2;
+	int doDisable=0;
+
+	VME4L_STAT_INC( vectors[vector] );
+
+	if( t0 ){
+		t1 = vme4l_lat_now();
+		vme4l_lat_level( level, VME4L_LAT_IRQ, t1 - t0 );
+	}
+	trace_vme4l_irq_dispatch( level, vector, t0 ? t1 - t0 : 0 );
+
+	rcu_read_lock();
+
+	if( list_empty( &G_vectTbl[vector]) && (level != VME4L_IRQLEV_BUSERR)){
+		VME4LDBG( "VME4L: Uninitialized VME Interrupt lev %d vect %d\n",
+				  level, vector);
+	}
+
+	/* --- Skip thru list of all registered Handlers for vector --  */
+	list_for_each_entry_rcu( ent, &G_vectTbl[vector], node )
+	{
+		switch( ent->entType ){
 
-	list_add_tail( &ent->node, &G_vectTbl[vme_vector] );
+		case VME4L_KERNEL_IRQ:
 
-	/* enable irq if requested */
-	if( ent->flags & VME4L_IRQ_ENBL )
-		rv = vme4l_irqlevel_enable( ent->level );
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,19)
+			ent->u.kernel.h.lHandler( level, ent->u.kernel.dev_id );
+#else
+			ent->u.kernel.h.lHandler( level, ent->u.kernel.dev_id, regs );
+#endif /*LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,19)*/
+			break;
 
-	VME4L_UNLOCK_VECTORS(ps);
 
-	return rv;
-}
+		case VME4L_USER_IRQ:
+			/* send signal to process */
+			if( (level == VME4L_IRQLEV_BUSERR) &&
+				(ent->flags & VME4L_IRQ_OLDHANDLER )){
+				if( G_postedWriteMode || (current == ent->u.user.task) ){
+					vme4l_send_sig( ent, 1 );
+				}
+			}
+			else {
+				vme4l_send_sig( ent, 1 );
+			}
+			if( ((vector < 0x100) ||
+				 (vector == VME4L_IRQVEC_ACFAIL) ||
+				 (vector == VME4L_IRQVEC_SYSFAIL)) &&
+				!(ent->flags & VME4L_IRQ_ROAK))
+				/* level must be reenabled by USER application */
+				doDisable++;
+			break;
 
-/***********************************************************************/
-/** Handler for VME4L_IO_SIG_INSTALL2
- *
- * \param blk			ioctl argument from user
- * \return 0 on success or negative error number
- */
-static int vme4l_signal_install( VME4L_SIG_INSTALL2 *blk, struct file *file )
-{
-	VME4L_IRQ_ENTRY *ent;
-	int rv;
-	VME4LDBG("%s()\n", __FUNCTION__ );
-	if( (ent = kmalloc( sizeof( *ent ), GFP_KERNEL )) == NULL )
-		return -ENOMEM;
-	memset( ent, 0, sizeof(*ent));
+		case VME4L_EVENT_IRQ:
+			vme4l_event_post( ent, level, vector, t0 );
 
-	ent->flags	 		= blk->flags;
-	ent->level 			= blk->level;
-	ent->u.user.signal	= blk->signal;
-	ent->u.user.task	= current;
-	ent->u.user.file	= file;
+			if( ((vector < 0x100) ||
+				 (vector == VME4L_IRQVEC_ACFAIL) ||
+				 (vector == VME4L_IRQVEC_SYSFAIL)) &&
+				!(ent->flags & VME4L_IRQ_ROAK))
+				/* level must be reenabled by USER application */
+				doDisable++;
+			break;
 
-	/* install a LINUX USER irq (aka signal..)*/
-	ent->entType		= VME4L_USER_IRQ;
-	if( (rv = vme4l_irq_install( ent, blk->vector )) < 0 )
-		kfree( ent );
+		default:
+			printk( KERN_WARNING "VME4L: unknown handler type"
+					"lev %d vec %d\n", level, vector);
+			break;
+		} /* /switch */
+	}/* /list_for_each */
 
-	return rv;
-}
+	rcu_read_unlock();
 
+	if( t0 ){
+		t2 = vme4l_lat_now();
+		vme4l_lat_level( level, VME4L_LAT_DLV, t2 - t1 );
+		vme4l_lat_add( &G_latVect[vector], t2 - t0 );
+	}
 
+	if( doDisable ){
+		VME4L_LOCK_VECTORS(ps);
+		vme4l_irqlevel_disable( level );
+		VME4L_UNLOCK_VECTORS(ps);
+	}
+}
 
 /***********************************************************************/
-/** Handler for VME4L_IO_SIG_UNINSTALL
+/** Latch a VME interrupt for the irq thread
  *
- * This removes \b all installed signals on this vector for the current
- * process created on top of \a file
+ * If a handler of \a vector must run before the interrupter is released
+ * (RORA), the level is masked until vme4l_irq_thread() dispatched it.
+ * Must be called from the bridge hard irq handler only.
  *
- * \param vector		vector to uninstall
- * \param file			only vectors associated with \a file are removed
+ * For RORA vectors, masking and publishing the entry happen under the
+ * vectors lock, as does the thread's check for an empty ring before it
+ * unmasks. Otherwise the thread could unmask the level before the entry
+ * is visible. Other vectors don't take the lock.
  *
- * \return 0 on success or negative error number
+ * \param level		VME level 1..7
+ * \param vector 	VME vector
+ * \param t0		bridge irq entry time (ns) or 0
  */
-static int vme4l_signal_uninstall( int vector, struct file *file )
+static void vme4l_irq_defer( int level, int vector, uint64_t t0 )
 {
-	VME4L_IRQ_ENTRY *ent;
-	struct list_head *pos, *tmp;
-	unsigned long ps;
-
-	if( vector >= VME4L_NUM_VECTORS )
-		return -EINVAL;
-
-	VME4L_LOCK_VECTORS(ps);
-
-	list_for_each_safe( pos, tmp, &G_vectTbl[vector] ){
-		ent = list_entry( pos, VME4L_IRQ_ENTRY, node );
-		if( ent->entType == VME4L_USER_IRQ ){
-			if( ent->u.user.task == current && ent->u.user.file == file ){
+	VME4L_IRQ_RING *ring = &G_irqRing[level];
+	unsigned int head;
+	unsigned long ps = 0;
+	int rora = READ_ONCE( G_vectRora[vector] ) != 0;
 
-				/* remove entry */
-				list_del( &ent->node );
+	if( rora ){
+		VME4L_LOCK_VECTORS(ps);
+		set_bit( level, &G_irqLevMasked );
+		G_bDrv->irqLevelCtrl( G_bHandle, level, 0 );
+	}
 
-				VME4L_UNLOCK_VECTORS(ps);
-				kfree( ent );
-				VME4L_LOCK_VECTORS(ps);
-			}
-		}
+	head = ring->head;
+	if( head - READ_ONCE( ring->tail ) >= VME4L_IRQ_RING_LEN ){
+		ring->lost++;
 	}
-	VME4L_UNLOCK_VECTORS(ps);
-	return 0;
+	else {
+		ring->vector[head % VME4L_IRQ_RING_LEN] = vector;
+		ring->stamp[head % VME4L_IRQ_RING_LEN] = t0;
+		smp_wmb();				/* entry visible before head */
+		WRITE_ONCE( ring->head, head + 1 );
+	}
+	if( rora )
+		VME4L_UNLOCK_VECTORS(ps);
+
+	G_irqWake = 1;
 }
 
+/***********************************************************************/
+/** Timestamp entry of the bridge irq handler
+ *
+ * Bridge drivers call this first in their hard irq handler. The time is
+ * the start of the latencies measured for all interrupts the handler
+ * passes to vme4l_irq() (see /proc/vme4l/irq_latency).
+ */
+void vme4l_irq_entry( void )
+{
+	G_irqEntryNs = READ_ONCE( irq_latency ) ? vme4l_lat_now() : 0;
+	VME4L_STAT_INC( hwIrqs );
+}
 
 /***********************************************************************/
 /** vme4l Interrupt handler
@@ -1819,100 +4058,319 @@ static int vme4l_signal_uninstall( int vector, struct file *file )
  * The special interrupts >= VME4L_IRQLEV7 must be cleared
  * by the bridge driver before calling this function.
  *
+ * DMA completion and special interrupts are handled immediately. When
+ * the bridge irq is threaded (vme4l_request_irq()), VME levels 1..7 are
+ * latched and dispatched later by vme4l_irq_thread(); the bridge handler
+ * must then return vme4l_irq_done().
+ *
  * \param level		the interrupt level code, see \ref VME4L_IRQLEV
  * \param vector 	VME vector or pseudo vector
  * \param regs		regs argument passed to bridge irq (for whatever)
- *
- * \brief   the occuring Interrupts are dispatched to one of
- *		   	the 3 possible handling environments. These are:
- *
- *		   	- Linux Kernel handlers  ent->entType = VME4L_KERNEL_IRQ
- *		   	- Linux Usermode signals ent->entType = VME4L_USER_IRQ
- *
  */
 void vme4l_irq( int level, int vector, struct pt_regs *regs)
 {
-	VME4L_IRQ_ENTRY *ent;
-	struct list_head *pos;
+	VME4L_PCPU_STATS *st;
 	unsigned long ps;
-	static unsigned long _flags=0; /* Adam: Why static? */
-	int doDisable=0;
 
 	VME4LDBG("vme4l_irq() level=%d vector=%d \n", level, vector);
 
+	VME4L_STAT_BEGIN( st, ps );
+	st->s.handled++;
+	if( level >= 0 && level < VME4L_NUM_LEVELS )
+		st->s.levels[level]++;
+	if( level >= VME4L_IRQLEV_1 && level <= VME4L_IRQLEV_7 )
+		st->s.vmeIrqs++;
+	else if( level == VME4L_IRQLEV_BUSERR )
+		st->s.busErrIrqs++;
+	else if( level == VME4L_IRQLEV_DMAFINISHED )
+		st->s.dmaIrqs++;
+	else if( level >= VME4L_IRQLEV_MBOXRD(0) &&
+			 level < VME4L_IRQLEV_LOCMON(0) )
+		st->s.mboxIrqs++;
+	else if( level >= VME4L_IRQLEV_LOCMON(0) &&
+			 level < VME4L_IRQLEV_LOCMON(VME4L_IRQLEV_LOCMON_NUM) )
+		st->s.locMonIrqs++;
+	VME4L_STAT_END( st, ps );
+
 	if( vector == VME4L_IRQVEC_SPUR )
 		printk( KERN_WARNING "VME4L: spurious interrupt level %d\n", level );
 	else if(level == VME4L_IRQLEV_DMAFINISHED /* DMA finished */
 		|| (level == VME4L_IRQLEV_BUSERR && vector == 0) /* DMA failed */
 		){
-		VME4LDBG("DMA finished, wake G_dmaWq\n");
+		/* vector is the DMA channel (always 0 for failed DMA) */
+		int ch = (level == VME4L_IRQLEV_DMAFINISHED &&
+				  vector < G_dmaNumChan) ? vector : 0;
+
+		trace_vme4l_irq( level, vector, 0 );
+		VME4LDBG("DMA %d finished, wake up channel\n", ch);
+		/* start next prepared chain of pipelined DMA, unless the
+		   interrupt belongs to a DMA already found finished by polling */
+		if( !vme4l_dma_irq_stale( ch ))
+			vme4l_dma_chain_next( ch, level != VME4L_IRQLEV_DMAFINISHED );
+
 		/* wake up waiting task */
-		wake_up( &G_dmaWq );
+		wake_up( &G_dmaChan[ch].wq );
 	}
-	else
-	{  /* brace2 */
-		VME4L_LOCK_VECTORS(ps);
+	else if( vector >= 0 && vector < VME4L_NUM_VECTORS ){
+		uint64_t t0 = 0;
+
+		/* bridges not calling vme4l_irq_entry() measure from here */
+		if( READ_ONCE( irq_latency ))
+			t0 = G_irqEntryNs ? G_irqEntryNs : vme4l_lat_now();
 
-		if( list_empty( &G_vectTbl[vector]) && (level != VME4L_IRQLEV_BUSERR)){
-			VME4LDBG( "VME4L: Uninitialized VME Interrupt lev %d vect %d\n",
-					  level, vector);
+		if( G_irqThreaded &&
+			level >= VME4L_IRQLEV_1 && level <= VME4L_IRQLEV_7 ){
+			trace_vme4l_irq( level, vector, 1 );
+			vme4l_irq_defer( level, vector, t0 );
 		}
+		else {
+			trace_vme4l_irq( level, vector, 0 );
+			vme4l_irq_dispatch( level, vector, regs, t0 );
+		}
+	}
+}
 
-		/* --- Skip thru list of all registered Handlers for vector --  */
-		list_for_each( pos, &G_vectTbl[vector] )
-		{
-			ent = list_entry( pos, VME4L_IRQ_ENTRY, node );
-			switch( ent->entType ){
+/***********************************************************************/
+/** Return value for the bridge hard irq handler
+ *
+ * \return IRQ_WAKE_THREAD if vme4l_irq() latched interrupts for the irq
+ *		   thread, IRQ_HANDLED otherwise
+ */
+irqreturn_t vme4l_irq_done( void )
+{
+	G_irqEntryNs = 0;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,30)
+	if( G_irqWake ){
+		G_irqWake = 0;
+		return IRQ_WAKE_THREAD;
+	}
+#endif
+	return IRQ_HANDLED;
+}
 
-			case VME4L_KERNEL_IRQ:
+/***********************************************************************/
+/** Return value for the bridge hard irq handler if nothing was pending
+ *
+ * Counts the interrupt as spurious.
+ *
+ * \return IRQ_NONE
+ */
+irqreturn_t vme4l_irq_none( void )
+{
+	VME4L_STAT_INC( spurious );
+	return IRQ_NONE;
+}
 
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,19)
-				ent->u.kernel.h.lHandler( level, ent->u.kernel.dev_id );
-#else
-				ent->u.kernel.h.lHandler( level, ent->u.kernel.dev_id, regs );
-#endif /*LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,19)*/
-				break;
+/***********************************************************************/
+/** Bottom half of the bridge irq: dispatch latched VME interrupts
+ *
+ * Levels are served from 7 down to 1, at most irq_budget[] interrupts
+ * of a level per round, until all rings are empty. Then levels masked
+ * by vme4l_irq_defer() are unmasked again, unless a handler disabled
+ * them (RORA signals) or new interrupts were latched meanwhile.
+ *
+ * \param irq		Linux irq number
+ * \param dev_id	bridge handle
+ * \return IRQ_HANDLED
+ */
+irqreturn_t vme4l_irq_thread( int irq, void *dev_id )
+{
+	VME4L_IRQ_RING *ring;
+	unsigned int head, tail;
+	unsigned long ps;
+	uint64_t t0;
+	int level, n, vector, more;
 
+	do {
+		more = 0;
+		for( level = VME4L_IRQLEV_7; level >= VME4L_IRQLEV_1; level-- ){
+			ring = &G_irqRing[level];
 
-			case VME4L_USER_IRQ:
-				/* send signal to process */
-				if( (level == VME4L_IRQLEV_BUSERR) &&
-					(ent->flags & VME4L_IRQ_OLDHANDLER )){
-					if( G_postedWriteMode || (current == ent->u.user.task) ){
-						vme4l_send_sig( ent, 1 );
-					}
-				}
-				else {
-					vme4l_send_sig( ent, 1 );
-				}
-				if( ((vector < 0x100) ||
-					 (vector == VME4L_IRQVEC_ACFAIL) ||
-					 (vector == VME4L_IRQVEC_SYSFAIL)) &&
-					!(ent->flags & VME4L_IRQ_ROAK))
-					/* level must be reenabled by USER application */
-					doDisable++;
-				break;
+			n = irq_budget[level-1] > 0 ? irq_budget[level-1] : 1;
 
-			default:
-				printk( KERN_WARNING "VME4L: unknown handler type"
-						"lev %d vec %d\n", level, vector);
-				break;
-			} /* /switch */
-		}/* /list_for_each */
+			for( ; n > 0; n-- ){
+				tail = ring->tail;
+				head = READ_ONCE( ring->head );
+				if( tail == head )
+					break;
+				smp_rmb();		/* read entry after head */
+				vector = ring->vector[tail % VME4L_IRQ_RING_LEN];
+				t0 = ring->stamp[tail % VME4L_IRQ_RING_LEN];
+				smp_mb();		/* entry read before slot is released */
+				WRITE_ONCE( ring->tail, tail + 1 );
 
-		if( doDisable ){
-			SAVE_FLAGS_AND_CLI(_flags);
-			vme4l_irqlevel_disable( level );
-			RESTORE_FLAGS(_flags);
+				vme4l_irq_dispatch( level, vector, NULL, t0 );
+			}
+			if( ring->tail != READ_ONCE( ring->head ))
+				more = 1;
 		}
+	} while( more );
 
-
+	if( READ_ONCE( G_irqLevMasked )){
+		VME4L_LOCK_VECTORS(ps);
+		for( level = VME4L_IRQLEV_1; level <= VME4L_IRQLEV_7; level++ ){
+			if( !test_and_clear_bit( level, &G_irqLevMasked ))
+				continue;
+
+			ring = &G_irqRing[level];
+			if( ring->tail != READ_ONCE( ring->head )){
+				/* latched meanwhile, thread runs again */
+				set_bit( level, &G_irqLevMasked );
+				continue;
+			}
+			if( G_irqLevEnblCount[level] > 0 )
+				G_bDrv->irqLevelCtrl( G_bHandle, level, 1 );
+		}
 		VME4L_UNLOCK_VECTORS(ps);
-	} /* /brace2 */
+	}
+
+	return IRQ_HANDLED;
+}
+
+/***********************************************************************/
+/** Request the bridge irq
+ *
+ * Bridge drivers call this instead of request_irq(). If the irq_threaded
+ * module parameter is set, \a handler becomes the top half of a threaded
+ * irq with vme4l_irq_thread() as bottom half. The irq is bound to the
+ * CPU given by the irq_cpu module parameter.
+ *
+ * \param irq		Linux irq number
+ * \param handler	bridge hard irq handler
+ * \param flags		IRQF_xxx flags
+ * \param name		name of irq
+ * \param dev		passed to \a handler
+ * \return 0 on success or negative error number
+ */
+int vme4l_request_irq(
+	unsigned int irq,
+	irq_handler_t handler,
+	unsigned long flags,
+	const char *name,
+	void *dev)
+{
+	int rv;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,30)
+	if( irq_threaded ){
+		rv = request_threaded_irq( irq, handler, vme4l_irq_thread, flags,
+								   name, dev );
+		if( rv == 0 )
+			G_irqThreaded = 1;
+	}
+	else
+#endif
+		rv = request_irq( irq, handler, flags, name, dev );
+
+	if( rv )
+		return rv;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,35)
+	if( irq_cpu >= 0 && irq_cpu < nr_cpu_ids && cpu_online( irq_cpu )){
+		if( irq_set_affinity_hint( irq, cpumask_of( irq_cpu )) == 0 )
+			G_irqAffinitySet = 1;
+		else
+			printk( KERN_WARNING PFX "can't bind irq %d to CPU %d\n",
+					irq, irq_cpu );
+	}
+#endif
+
+	printk( KERN_INFO PFX "irq %d %sthreaded\n", irq,
+			G_irqThreaded ? "" : "not " );
+	return 0;
+}
+
+/***********************************************************************/
+/** Free the bridge irq requested with vme4l_request_irq()
+ *
+ * \param irq		Linux irq number
+ * \param dev		as passed to vme4l_request_irq()
+ */
+void vme4l_free_irq( unsigned int irq, void *dev )
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,35)
+	if( G_irqAffinitySet ){
+		irq_set_affinity_hint( irq, NULL );
+		G_irqAffinitySet = 0;
+	}
+#endif
+	free_irq( irq, dev );
+	G_irqThreaded = 0;
+	G_irqLevMasked = 0;
+}
+
+/***********************************************************************/
+/** Enable threaded dispatch for a bridge without Linux irq
+ *
+ * Software bridges raising VME interrupts from a timer call this instead
+ * of vme4l_request_irq(). If the irq_threaded module parameter is set,
+ * levels 1..7 are deferred like for threaded irqs. The bridge must then
+ * run vme4l_irq_thread() from process context whenever vme4l_irq_done()
+ * returns IRQ_WAKE_THREAD.
+ *
+ * \return 1 if threaded dispatch is enabled, 0 otherwise
+ */
+int vme4l_request_soft_irq( void )
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,30)
+	if( irq_threaded )
+		G_irqThreaded = 1;
+#endif
+	printk( KERN_INFO PFX "soft irq %sthreaded\n",
+			G_irqThreaded ? "" : "not " );
+	return G_irqThreaded;
+}
+
+/***********************************************************************/
+/** Disable dispatch enabled with vme4l_request_soft_irq()
+ *
+ * The bridge must no longer raise interrupts and must have flushed
+ * its vme4l_irq_thread() work.
+ */
+void vme4l_free_soft_irq( void )
+{
+	G_irqThreaded = 0;
+	G_irqLevMasked = 0;
 }
 
 /* -- LINUX DRIVER ENTRY POINTS -- */
 
+/***********************************************************************/
+/** Sum up the per-CPU statistics
+ *
+ * Each counter is read consistently (also on 32 bit CPUs), the counters
+ * are not a snapshot of a single point in time.
+ *
+ * \param sum		(OUT) statistics
+ */
+static void vme4l_stats_get( VME4L_STATS *sum )
+{
+	const int nCnt = (sizeof(VME4L_STATS) -
+					  offsetof(VME4L_STATS, hwIrqs)) / sizeof(uint64_t);
+	uint64_t *dst = &sum->hwIrqs, val;
+	const uint64_t *src;
+	VME4L_PCPU_STATS *st;
+	unsigned int start;
+	int cpu, i;
+
+	memset( sum, 0, sizeof(*sum) );
+	sum->version	= VME4L_STATS_VERSION;
+	sum->size		= sizeof(*sum);
+
+	for_each_possible_cpu( cpu ){
+		st  = per_cpu_ptr( G_stats, cpu );
+		src = &st->s.hwIrqs;
+
+		for( i=0; i<nCnt; i++ ){
+			do {
+				start = u64_stats_fetch_begin( &st->sync );
+				val = src[i];
+			} while( u64_stats_fetch_retry( &st->sync, start ));
+			dst[i] += val;
+		}
+	}
+}
+
 /***********************************************************************/
 /** Open entry point of VME4L driver
  *
@@ -1945,6 +4403,16 @@ static int vme4l_open(
 
 	fp->minor = minor;
 	fp->swapMode = VME4L_NO_SWAP;
+	fp->mmapBase = 0;
+	fp->mapMode = VME4L_MAP_NOFLAGS;
+	vme4l_dma_policy_default( &fp->dmaPolicy );
+	fp->async = NULL;
+	memset( fp->pinBuf, 0, sizeof(fp->pinBuf) );
+	spin_lock_init( &fp->pinLock );
+	fp->evHead = fp->evTail = 0;
+	fp->evLost = 0;
+	spin_lock_init( &fp->evLock );
+	init_waitqueue_head( &fp->evWq );
 	file->private_data = fp;
 
 
@@ -1964,15 +4432,19 @@ static int vme4l_release(
 )
 {
 	int minor = MINOR(inode->i_rdev);
-	int vector;
+	VME4L_FILE_PRIV *fp = (VME4L_FILE_PRIV *)file->private_data;
 
 	VME4LDBG("vme4l_close %s\n", G_spaceTbl[minor].devName );
 
-	/* remove all signals associated with this file */
-	for( vector=0; vector<VME4L_NUM_VECTORS; vector++ )
-		vme4l_signal_uninstall( vector, file );
+	/* remove all signals and events associated with this file */
+	vme4l_irq_file_release( file );
+
+	if( fp->async )
+		vme4l_async_release( fp->async );
 
-	kfree( file->private_data );
+	vme4l_pinbuf_release( fp );
+
+	kfree( fp );
 	file->private_data = NULL;
 
 	return 0;
@@ -2012,26 +4484,185 @@ static inline pgprot_t pgprot_noncached(pgprot_t _prot)
 		prot = (prot & _CACHEMASK040) | _PAGE_NOCACHE_S;
 #endif
 
-	return __pgprot(prot);
-}
+	return __pgprot(prot);
+}
+
+#endif /* !pgprot_noncached */
+
+#ifndef pgprot_writecombine
+# define pgprot_writecombine(prot)	pgprot_noncached(prot)
+#endif
+
+/***********************************************************************/
+/** Unmap VM area mapped by vme4l_mmap
+ *
+ * Kernel will call this when VM area is destroyed
+ */
+void vme4l_mmap_close( struct vm_area_struct *vma )
+{
+	VME4L_ADRSWIN *win = (VME4L_ADRSWIN *)vma->vm_private_data;
+	vme4l_release_adrswin( win ); /* decrease use count */
+}
+
+static struct vm_operations_struct vme4l_remap_vm_ops = {
+	.close = vme4l_mmap_close,
+};
+
+#ifdef VME4L_HUGE_PFNMAP
+/***********************************************************************/
+/** Fault handler for slave windows mapped by vme4l_mmap
+ *
+ * vm_pgoff is the page offset within the window. A PMD is inserted if
+ * the PMD range lies completely within the VM area and the window memory
+ * below it is PMD aligned, otherwise the kernel falls back to pages.
+ * Bridge drivers should place windows of PMD_SIZE or more at a PMD
+ * boundary (vme4l-tsi148 does so for kernel memory windows). Otherwise,
+ * or if the mmap offset is not PMD aligned, the window is mapped with
+ * pages only.
+ *
+ * \param vmf			fault description
+ * \param order			requested page order (0 or PMD_ORDER)
+ * \return 				VM_FAULT_xxx code
+ */
+static vm_fault_t vme4l_slv_huge_fault( struct vm_fault *vmf,
+										unsigned int order )
+{
+	struct vm_area_struct *vma = vmf->vma;
+	VME4L_ADRSWIN *win = (VME4L_ADRSWIN *)vma->vm_private_data;
+	unsigned long addr = ALIGN_DOWN( vmf->address, PAGE_SIZE << order );
+	unsigned long pfn;
+
+	if( addr < vma->vm_start || addr + (PAGE_SIZE << order) > vma->vm_end )
+		return VM_FAULT_FALLBACK;
+
+	pfn = ((uintptr_t)win->physAddr >> PAGE_SHIFT) + vma->vm_pgoff +
+		((addr - vma->vm_start) >> PAGE_SHIFT);
+
+	if( !IS_ALIGNED( pfn, 1UL << order ))
+		return VM_FAULT_FALLBACK;
+
+	switch( order ){
+	case 0:
+		return vmf_insert_pfn( vma, addr, pfn );
+	case PMD_ORDER:
+		return vmf_insert_pfn_pmd( vmf, VME4L_PMD_PFN( pfn ),
+								   vmf->flags & FAULT_FLAG_WRITE );
+	default:
+		return VM_FAULT_FALLBACK;
+	}
+}
+
+static vm_fault_t vme4l_slv_fault( struct vm_fault *vmf )
+{
+	return vme4l_slv_huge_fault( vmf, 0 );
+}
+
+static struct vm_operations_struct vme4l_slv_vm_ops = {
+	.close		= vme4l_mmap_close,
+	.fault		= vme4l_slv_fault,
+	.huge_fault	= vme4l_slv_huge_fault,
+};
+#endif /* VME4L_HUGE_PFNMAP */
+
+
+/***********************************************************************/
+/** Check if the event queue of a file holds records
+ */
+static int vme4l_event_pending( VME4L_FILE_PRIV *fp )
+{
+	unsigned long ps;
+	int pending;
+
+	spin_lock_irqsave( &fp->evLock, ps );
+	pending = (fp->evHead != fp->evTail);
+	spin_unlock_irqrestore( &fp->evLock, ps );
+
+	return pending;
+}
+
+/***********************************************************************/
+/** Read entry point of VME4L driver
+ *
+ * Returns VME4L_EVENT records of interrupts bound to the file with
+ * VME4L_IO_EVENT_INSTALL. Blocks until at least one record is available,
+ * unless the file is opened with O_NONBLOCK. The time from bridge irq
+ * entry until the record is read is accounted as VME4L_LAT_USER.
+ *
+ * \param file			pointer to file structure
+ * \param buf			user buffer, receives VME4L_EVENT records
+ * \param count			size of \a buf (at least one record)
+ * \param ppos			not used
+ * \return number of bytes read or negative error number
+ */
+static ssize_t vme4l_read(
+	struct file *file,
+	char __user *buf,
+	size_t count,
+	loff_t *ppos)
+{
+	VME4L_FILE_PRIV *fp = (VME4L_FILE_PRIV *)file->private_data;
+	VME4L_EVENT ev;
+	unsigned long ps;
+	unsigned int tail;
+	ssize_t done = 0;
+
+	if( count < sizeof(ev) )
+		return -EINVAL;
+
+	if( !(file->f_flags & O_NONBLOCK) &&
+		wait_event_interruptible( fp->evWq, vme4l_event_pending( fp )))
+		return -ERESTARTSYS;
 
-#endif /* !pgprot_noncached */
+	while( count - done >= sizeof(ev) ){
+		spin_lock_irqsave( &fp->evLock, ps );
+		if( fp->evHead == fp->evTail ){
+			spin_unlock_irqrestore( &fp->evLock, ps );
+			break;
+		}
+		tail = fp->evTail;
+		ev = fp->evQ[tail % VME4L_EVENT_QUEUE_LEN];
+		spin_unlock_irqrestore( &fp->evLock, ps );
+
+		/* keep the record queued if the user buffer faults */
+		if( copy_to_user( buf + done, &ev, sizeof(ev) ))
+			return done ? done : -EFAULT;
+
+		/* dequeue, unless a concurrent reader got it first */
+		spin_lock_irqsave( &fp->evLock, ps );
+		if( fp->evTail != tail ){
+			spin_unlock_irqrestore( &fp->evLock, ps );
+			continue;
+		}
+		fp->evTail++;
+		spin_unlock_irqrestore( &fp->evLock, ps );
+
+		if( READ_ONCE( irq_latency ))
+			vme4l_lat_level( ev.level, VME4L_LAT_USER,
+							 vme4l_lat_now() - ev.timeNs );
+
+		done += sizeof(ev);
+	}
+
+	return done ? done : -EAGAIN;
+}
 
 /***********************************************************************/
-/** Unmap VM area mapped by vme4l_mmap
+/** Poll entry point of VME4L driver
  *
- * Kernel will call this when VM area is destroyed
+ * The file is readable when interrupt records are queued.
+ *
+ * \param file			pointer to file structure
+ * \param wait			poll table
+ * \return poll mask
  */
-void vme4l_mmap_close( struct vm_area_struct *vma )
+static unsigned int vme4l_poll( struct file *file, poll_table *wait )
 {
-	VME4L_ADRSWIN *win = (VME4L_ADRSWIN *)vma->vm_private_data;
-	vme4l_release_adrswin( win ); /* decrease use count */
-}
+	VME4L_FILE_PRIV *fp = (VME4L_FILE_PRIV *)file->private_data;
 
-static struct vm_operations_struct vme4l_remap_vm_ops = {
-	.close = vme4l_mmap_close,
-};
+	poll_wait( file, &fp->evWq, wait );
 
+	return vme4l_event_pending( fp ) ? (POLLIN | POLLRDNORM) : 0;
+}
 
 /***********************************************************************/
 /** Mmap entry point of VME4L driver
@@ -2050,16 +4681,22 @@ static int vme4l_mmap(
 	VME4L_FILE_PRIV *fp;
 	VME4L_SPACE_ENT *spcEnt;
 	int rv=0;
-	/* hmm, vm_pgoff is unsigned long -> 32 bit at 32 bit systems, so how we
-	   can map VME addresses > 4 GB ??? */
-	uintptr_t vmeAddr	= vma->vm_pgoff << PAGE_SHIFT;
+	/* vm_pgoff has only 32 bit on 32 bit systems, VME addresses beyond
+	   are reached with VME4L_IO_MMAP_BASE_SET */
+	vmeaddr_t offset	= (vmeaddr_t)vma->vm_pgoff << PAGE_SHIFT;
+	vmeaddr_t vmeAddr	= offset;
 	unsigned long size		= vma->vm_end - vma->vm_start;
+	unsigned long vmFlags;
 	uintptr_t physAddr;
 
 	fp = (VME4L_FILE_PRIV *) file->private_data;
 	spc = fp->minor;
 	spcEnt = &G_spaceTbl[spc];
 
+	/* file has asynchronous DMA rings: map these */
+	if( fp->async )
+		return vme4l_async_mmap( fp->async, vma );
+
 	if( ! spcEnt->isSlv ){
 		/*---------------+
 		|  Master space  |
@@ -2067,13 +4704,18 @@ static int vme4l_mmap(
 		if( fp->swapMode & VME4L_SW_ADR_SWAP )
 			return -EINVAL;
 
-		VME4LDBG("vme4l_mmap %s vmeAddr=%lx (%lx) swapMode=%x\n",
+		vmeAddr += fp->mmapBase;
+
+		VME4LDBG("vme4l_mmap %s vmeAddr=%llx (%lx) swapMode=%x\n",
 				 G_spaceTbl[spc].devName,
 				 vmeAddr, size, fp->swapMode );
 
+		/* WC regions never share a window with uncached ones */
 		if( (rv = vme4l_request_adrswin( spc, vmeAddr, size,
-										 (fp->swapMode & VME4L_HW_SWAP1) ?
-										 VME4L_AW_HW_SWAP1 : 0,
+										 ((fp->swapMode & VME4L_HW_SWAP1) ?
+										  VME4L_AW_HW_SWAP1 : 0) |
+										 ((fp->mapMode & VME4L_MAP_WC) ?
+										  VME4L_AW_WC : 0),
 										 &win )) < 0 )
 			goto ABORT;
 
@@ -2084,8 +4726,6 @@ static int vme4l_mmap(
 		/*---------------+
 		|  Slave Window  |
 		+---------------*/
-		unsigned long offset = vmeAddr;
-
 		VME4L_LOCK_MSTRLISTS();
 
 		/* get the window that was previously setup (if any) */
@@ -2094,7 +4734,7 @@ static int vme4l_mmap(
 
 		VME4L_UNLOCK_MSTRLISTS();
 
-		VME4LDBG("vme4l_mmap %s for slave win win=%p off=%lx (%lx)\n",
+		VME4LDBG("vme4l_mmap %s for slave win win=%p off=%llx (%lx)\n",
 				 G_spaceTbl[spc].devName, win,
 				 offset, size );
 
@@ -2117,20 +4757,38 @@ static int vme4l_mmap(
 
 	/* replace discontinued VM_RESERVED as stated in Torvalds' mail:
 	https://git.kernel.org/cgit/linux/kernel/git/stable/linux-stable.git/commit/?id=547b1e81afe3119f7daf702cc03b158495535a25 */
-	vma->vm_flags |= ( VM_IO | VM_DONTEXPAND |
+	vmFlags = VM_IO | VM_DONTEXPAND |
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(3,7,0)
-			  VM_DONTDUMP
+			  VM_DONTDUMP;
 #else
-			  VM_RESERVED
+			  VM_RESERVED;
 #endif
-			 );
-	vma->vm_page_prot = pgprot_noncached(vma->vm_page_prot);
+	if( !spcEnt->isSlv && (fp->mapMode & VME4L_MAP_WC) )
+		vma->vm_page_prot = pgprot_writecombine(vma->vm_page_prot);
+	else
+		vma->vm_page_prot = pgprot_noncached(vma->vm_page_prot);
 	/*
 	 * Setup a callback to free our window when user unmaps area
 	 */
 	vma->vm_private_data = (void *)win;
 	vma->vm_ops = &vme4l_remap_vm_ops;
 
+#ifdef VME4L_HUGE_PFNMAP
+	/* shared slave window mappings are populated on fault, using PMDs */
+	if( spcEnt->isSlv && slave_hugemap && (vma->vm_flags & VM_SHARED) ){
+		vm_flags_set( vma, vmFlags | VM_PFNMAP | VM_HUGEPAGE );
+		vma->vm_ops = &vme4l_slv_vm_ops;
+		win->useCount++;
+		return 0;
+	}
+#endif
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,3,0)
+	vm_flags_set( vma, vmFlags );
+#else
+	vma->vm_flags |= vmFlags;
+#endif
+
 	if( VME4L_REMAP(vma,
 					vma->vm_start,
 					physAddr,
@@ -2145,7 +4803,7 @@ static int vme4l_mmap(
 	return 0;
 
  ABORT:
-	VME4LERR(PFX "%s: vme4l_mmap failed for spc %d addr %lx (%lx), rv=%d\n",
+	VME4LERR(PFX "%s: vme4l_mmap failed for spc %d addr %llx (%lx), rv=%d\n",
 	       __func__, spc, vmeAddr, size, rv );
 
 	return rv;
@@ -2170,6 +4828,7 @@ static long vme4l_ioctl(
 	/* FIXME I might need some locking here */
 	int rv;
 	unsigned long ps;
+	size_t statsSize = 0;
 	VME4L_FILE_PRIV *fp= (VME4L_FILE_PRIV *)file->private_data;
 	VME4L_SPACE spc = fp->minor;
 
@@ -2183,6 +4842,17 @@ static long vme4l_ioctl(
     if (_IOC_TYPE(cmd) != VME4L_IOC_MAGIC) return -ENOTTY;
     if (_IOC_NR(cmd) > VME4L_IOC_MAXNR) return -ENOTTY;
 
+	/*
+	 * VME4L_STATS only grows at the end, its size is part of the cmd.
+	 * Accept the cmd of callers built with an older or newer layout.
+	 */
+	if( _IOC_NR(cmd) == _IOC_NR(VME4L_IO_STATS_GET) &&
+		_IOC_DIR(cmd) == _IOC_READ ){
+		if( _IOC_SIZE(cmd) < offsetof(VME4L_STATS, hwIrqs) )
+			return -EINVAL;
+		statsSize = min_t( size_t, _IOC_SIZE(cmd), sizeof(VME4L_STATS) );
+		cmd = VME4L_IO_STATS_GET;
+	}
 
 	switch( cmd ){
 
@@ -2203,7 +4873,111 @@ static long vme4l_ioctl(
 
 		VME4LDBG( "vme4l_ioctl: VME4L_IO_RW_BLOCK: %s with size 0x%lx, data @ %p\n", blk.direction ? "write" : "read", blk.size, blk.dataP );
 
-		rv = vme4l_rw( spc, &blk, fp->swapMode );
+		rv = vme4l_rw_pol( spc, &blk, fp->swapMode, &fp->dmaPolicy );
+		break;
+	}
+
+	case VME4L_IO_ASYNC_SETUP:
+	{
+		VME4L_ASYNC_SETUP blk;
+
+		if( copy_from_user( &blk, (void *)arg, sizeof(blk)) ){
+			rv = -EFAULT;
+			break;
+		}
+
+		if( (rv = vme4l_async_setup( fp, &blk )) < 0 )
+			break;
+
+		if( copy_to_user( (void *)arg, &blk, sizeof(blk)) )
+			rv = -EFAULT;
+		break;
+	}
+
+	case VME4L_IO_ASYNC_SUBMIT:
+		rv = vme4l_async_submit( fp, (unsigned int)arg );
+		break;
+
+	case VME4L_IO_ASYNC_WAIT:
+		rv = vme4l_async_wait( fp, (unsigned int)arg );
+		break;
+
+	case VME4L_IO_PINBUF_REGISTER:
+	{
+		VME4L_PINBUF_REG blk;
+
+		if( copy_from_user( &blk, (void *)arg, sizeof(blk)) ){
+			rv = -EFAULT;
+			break;
+		}
+
+		if( !access_ok( VERIFY_WRITE, blk.dataP, blk.size )){
+			rv = -EFAULT;
+			break;
+		}
+
+		if( (rv = vme4l_pinbuf_register( fp, &blk )) < 0 )
+			break;
+
+		if( copy_to_user( (void *)arg, &blk, sizeof(blk)) ){
+			vme4l_pinbuf_unregister( fp, blk.handle );
+			rv = -EFAULT;
+		}
+		break;
+	}
+
+	case VME4L_IO_PINBUF_UNREGISTER:
+		rv = vme4l_pinbuf_unregister( fp, (int)arg );
+		break;
+
+	case VME4L_IO_RW_VECTOR:
+	{
+		VME4L_RW_VECTOR vec;
+
+		if( copy_from_user( &vec, (void *)arg, sizeof(vec)) ){
+			rv = -EFAULT;
+			break;
+		}
+
+		rv = vme4l_rw_vector( spc, fp, &vec );
+		break;
+	}
+
+	case VME4L_IO_DMA_POLICY_SET:
+	{
+		VME4L_DMA_POLICY pol;
+
+		if( copy_from_user( &pol, (void *)arg, sizeof(pol)) ){
+			rv = -EFAULT;
+			break;
+		}
+
+		if( pol.pollUs > VME4L_DMA_POLL_MAX_US || pol.timeoutMs == 0 ||
+			pol.timeoutMs > VME4L_DMA_TIMEOUT_MAX_MS ){
+			rv = -EINVAL;
+			break;
+		}
+
+		fp->dmaPolicy = pol;
+		rv = 0;
+		break;
+	}
+
+	case VME4L_IO_DMA_POLICY_GET:
+		rv = copy_to_user( (void *)arg, &fp->dmaPolicy,
+						   sizeof(fp->dmaPolicy)) ? -EFAULT : 0;
+		break;
+
+	case VME4L_IO_RW_PINNED:
+	{
+		VME4L_RW_PINNED blk;
+
+		if( copy_from_user( &blk, (void *)arg, sizeof(blk)) ){
+			rv = -EFAULT;
+			break;
+		}
+
+		rv = vme4l_pinbuf_dma( spc, fp, &blk );
 		break;
 	}
 
@@ -2240,6 +5014,54 @@ static long vme4l_ioctl(
 		rv = vme4l_signal_uninstall( arg, file );
 		break;
 
+	case VME4L_IO_EVENT_INSTALL:
+	{
+		VME4L_EVENT_INSTALL blk;
+
+		if( copy_from_user( &blk, (void *)arg, sizeof(blk)) ){
+			rv = -EFAULT;
+			break;
+		}
+		rv = vme4l_event_install( &blk, file );
+
+		break;
+	}
+
+	case VME4L_IO_EVENT_UNINSTALL:
+		rv = vme4l_event_uninstall( arg, file );
+		break;
+
+	case VME4L_IO_STATS_GET:
+	{
+		VME4L_STATS *stats = kmalloc( sizeof(*stats), GFP_KERNEL );
+
+		if( stats == NULL ){
+			rv = -ENOMEM;
+			break;
+		}
+		vme4l_stats_get( stats );
+		rv = copy_to_user( (void *)arg, stats, statsSize ) ? -EFAULT : 0;
+		kfree( stats );
+		break;
+	}
+
+	case VME4L_IO_MMAP_BASE_SET:
+	{
+		vmeaddr_t base;
+
+		if( copy_from_user( &base, (void *)arg, sizeof(base)) ){
+			rv = -EFAULT;
+			break;
+		}
+		if( base & ~PAGE_MASK ){
+			rv = -EINVAL;
+			break;
+		}
+		fp->mmapBase = base;
+		rv = 0;
+		break;
+	}
+
 
 	case VME4L_IO_SYS_CTRL_FUNCTION_GET:
 		rv = -ENOTTY;
@@ -2405,6 +5227,15 @@ static long vme4l_ioctl(
 		break;
 	}
 
+	case VME4L_IO_MAP_MODE_SET:
+		if( arg & ~VME4L_MAP_WC ){
+			rv = -EINVAL;
+			break;
+		}
+		fp->mapMode = arg;
+		rv = 0;
+		break;
+
 	case VME4L_IO_SLAVE_WINDOW_CTRL:
 	{
 		VME4L_SLAVE_WINDOW_CTRL blk;
@@ -2635,7 +5466,29 @@ int vme4l_register_bridge_driver(
 		return -EBUSY;
 
 	G_bDrv 	  = drv;
+	G_bDrvExt = drv->ext ? drv->ext : &G_noBDrvExt;
 	G_bHandle = drvData;
+
+	/* no DMA is running, so DMA channels can be set up again */
+	G_dmaNumChan = 1;
+	if( G_bDrvExt->dmaChannelsGet )
+		G_dmaNumChan = G_bDrvExt->dmaChannelsGet( G_bHandle );
+	if( G_dmaNumChan < 1 )
+		G_dmaNumChan = 1;
+	if( G_dmaNumChan > VME4L_MAX_DMA_CHANNELS )
+		G_dmaNumChan = VME4L_MAX_DMA_CHANNELS;
+	G_dmaChanBusy = 0;
+	sema_init( &G_dmaChanSem, G_dmaNumChan );
+
+	G_dmaSegMax = PAGE_SIZE;
+	if( G_bDrvExt->dmaSegMaxGet )
+		G_dmaSegMax = G_bDrvExt->dmaSegMaxGet( G_bHandle );
+	if( G_dmaSegMax < PAGE_SIZE )
+		G_dmaSegMax = PAGE_SIZE;
+
+	/* keep IOMMU from merging beyond what the bridge can handle */
+	if( vme4l_dma_dev() )
+		dma_set_max_seg_size( vme4l_dma_dev(), G_dmaSegMax );
 	{
 		char buf[200];
 		G_bDrv->revisionInfo( G_bHandle, buf );
@@ -2651,7 +5504,12 @@ int vme4l_register_bridge_driver(
  */
 void vme4l_unregister_bridge_driver(void)
 {
+	/* unmap idle master windows while the bridge memory still exists */
+	while( vme4l_evict_idle_adrswin() == 0 )
+		;
+
 	G_bDrv    = NULL;
+	G_bDrvExt = NULL;
 	G_bHandle = NULL;
 }
 
@@ -2745,6 +5603,7 @@ int VME_REQUEST_IRQ(
 )
 {
 	VME4L_IRQ_ENTRY *ent;
+	int rv;
 
 	/* no bridge registered? abort! */
 	if( !G_bDrv )
@@ -2763,7 +5622,10 @@ int VME_REQUEST_IRQ(
 
 	/* install a LINUX KERNEL irq */
 	ent->entType				= VME4L_KERNEL_IRQ;
-	return vme4l_irq_install( ent, vme_irq );
+	if( (rv = vme4l_irq_install( ent, vme_irq )) < 0 )
+		kfree( ent );
+
+	return rv;
 
 }
 
@@ -2779,8 +5641,7 @@ int VME_REQUEST_IRQ(
  */
 void VME_FREE_IRQ(unsigned int vme_irq, void *dev_id)
 {
-	VME4L_IRQ_ENTRY *ent;
-	struct list_head *pos, *tmp;
+	VME4L_IRQ_ENTRY *ent, *tmp, *freeLst = NULL;
 	unsigned long ps;
 
 	/* no bridge registered? abort! */
@@ -2792,21 +5653,22 @@ void VME_FREE_IRQ(unsigned int vme_irq, void *dev_id)
 
 	VME4L_LOCK_VECTORS(ps);
 
-	list_for_each_safe( pos, tmp, &G_vectTbl[vme_irq] ){
-		ent = list_entry( pos, VME4L_IRQ_ENTRY, node );
-
+	list_for_each_entry_safe( ent, tmp, &G_vectTbl[vme_irq], node ){
 		if( ent->entType == VME4L_KERNEL_IRQ ){
 			if( ent->u.kernel.dev_id == dev_id ){
-				/* remove entry */
-				list_del( &ent->node );
-
-				VME4L_UNLOCK_VECTORS(ps);
-				kfree( ent );
-				VME4L_LOCK_VECTORS(ps);
+				/* remove entry, free it after grace period */
+				list_del_rcu( &ent->node );
+				if( vme4l_irq_entry_rora( ent ))
+					G_vectRora[vme_irq]--;
+				ent->nextFree = freeLst;
+				freeLst = ent;
 			}
 		}
 	}
 	VME4L_UNLOCK_VECTORS(ps);
+
+	/* handler is not running anymore when we return */
+	vme4l_irq_entries_free( freeLst );
 	return;
 }
 
@@ -2840,8 +5702,13 @@ int vme_ilevel_control( int level, int enable )
  */
 static struct file_operations vme4l_fops = {
     .open           = vme4l_open,
+    .read           = vme4l_read,
+    .poll           = vme4l_poll,
     .unlocked_ioctl = vme4l_ioctl,
     .release        = vme4l_release,
+#ifdef VME4L_HUGE_PFNMAP
+    .get_unmapped_area = thp_get_unmapped_area,	/* PMD aligned mappings */
+#endif
     .mmap           = vme4l_mmap
 };
 
@@ -2923,91 +5790,104 @@ static int vme4l_window_proc_show(struct seq_file *m, void *data)
 
 static int vme4l_interrupts_proc_show(struct seq_file *m, void *data)
 {
-	int tries = 10;
+	VME4L_STATS *irqs;
 	int i;
-	int ret;
 
-	VME4L_IRQ_STAT irqs;
-	seq_printf(m, "Interrupts\n");
-
-	if (!G_bDrv) {
-		printk(KERN_ERR_PFX "%s: G_bDrv not initialized\n",
-		       __func__);
-		return -1;
-	}
-
-	if (!G_bDrv->getIrqStats) {
-		printk(KERN_ERR_PFX "%s: G_bDrv->getIrqStats not initialized\n",
-		       __func__);
-		return -1;
-	}
-
-	while (1) {
-		ret = G_bDrv->getIrqStats(G_bHandle, &irqs, sizeof(irqs));
-		if (!ret) {
-			/* we have a valid and consistent data */
-			break;
-		}
-		tries--;
-		udelay(1000);
-		if (!tries) {
-			printk(KERN_ERR_PFX "%s: Unable to get consistent "
-			       "irq stats for the VME bridge!\n", __func__);
-			return -1;
-		}
-	}
+	if ((irqs = kmalloc(sizeof(*irqs), GFP_KERNEL)) == NULL)
+		return -ENOMEM;
+	vme4l_stats_get(irqs);
 
+	seq_printf(m, "Interrupts\n");
 	seq_printf(m, "------------------------------------------\n");
 	seq_printf(m, "ISR stats:\n");
-	seq_printf(m, "VME interrupts                  %10lld\n", irqs.vme);
-	seq_printf(m, "Bus error interrupts            %10lld\n", irqs.ber);
-	seq_printf(m, "DMA interrupts                  %10lld\n", irqs.dma);
-	seq_printf(m, "MailBox interrupts              %10lld\n", irqs.mbox);
-	seq_printf(m, "Mocation Monitor interrupts     %10lld\n", irqs.mon);
-	seq_printf(m, "Total HW interrupts             %10lld\n", irqs.hw_total);
-	seq_printf(m, "Handled interrupts              %10lld\n", irqs.handled);
-	seq_printf(m, "Not handled interrupts          %10lld\n", irqs.spurious);
-	seq_printf(m, "Handled + spurious              %10lld\n", irqs.handled + irqs.spurious);
+	seq_printf(m, "VME interrupts                  %10llu\n", irqs->vmeIrqs);
+	seq_printf(m, "Bus error interrupts            %10llu\n", irqs->busErrIrqs);
+	seq_printf(m, "DMA interrupts                  %10llu\n", irqs->dmaIrqs);
+	seq_printf(m, "MailBox interrupts              %10llu\n", irqs->mboxIrqs);
+	seq_printf(m, "Location Monitor interrupts     %10llu\n", irqs->locMonIrqs);
+	seq_printf(m, "Total HW interrupts             %10llu\n", irqs->hwIrqs);
+	seq_printf(m, "Handled interrupts              %10llu\n", irqs->handled);
+	seq_printf(m, "Not handled interrupts          %10llu\n", irqs->spurious);
+	seq_printf(m, "Handled + spurious              %10llu\n", irqs->handled + irqs->spurious);
 	/* If this is more than 0, it means that during at least one
 	 * HW interrupt, at least two interrupt sources were handled */
-	seq_printf(m, "(Handled + spurious) - total    %10lld\n", (irqs.handled + irqs.spurious) - irqs.hw_total);
+	seq_printf(m, "(Handled + spurious) - total    %10lld\n", (long long)((irqs->handled + irqs->spurious) - irqs->hwIrqs));
 	seq_printf(m, "------------------------------------------\n");
-	seq_printf(m, "IRQ level unknown               %10lld\n", irqs.levels[VME4L_IRQLEV_UNKNOWN]);
+	seq_printf(m, "IRQ level unknown               %10llu\n", irqs->levels[VME4L_IRQLEV_UNKNOWN]);
 	for (i = 0; i < VME4L_IRQLEV_NUM; i++) {
-		seq_printf(m, "IRQ level %d                     %10lld\n", i + VME4L_IRQLEV_1, irqs.levels[i + VME4L_IRQLEV_1]);
+		seq_printf(m, "IRQ level %d                     %10llu\n", i + VME4L_IRQLEV_1, irqs->levels[i + VME4L_IRQLEV_1]);
 	}
-	seq_printf(m, "IRQ level bus error             %10lld\n", irqs.levels[VME4L_IRQLEV_BUSERR]);
-	seq_printf(m, "IRQ level ACFAIL                %10lld\n", irqs.levels[VME4L_IRQLEV_ACFAIL]);
-	seq_printf(m, "IRQ level SYSFAIL               %10lld\n", irqs.levels[VME4L_IRQLEV_SYSFAIL]);
+	seq_printf(m, "IRQ level bus error             %10llu\n", irqs->levels[VME4L_IRQLEV_BUSERR]);
+	seq_printf(m, "IRQ level ACFAIL                %10llu\n", irqs->levels[VME4L_IRQLEV_ACFAIL]);
+	seq_printf(m, "IRQ level SYSFAIL               %10llu\n", irqs->levels[VME4L_IRQLEV_SYSFAIL]);
 	for (i = 0; i < VME4L_IRQLEV_MBOXWR_NNUM; i++) {
-		seq_printf(m, "IRQ level RX mailbox %d          %10lld\n", i, irqs.levels[VME4L_IRQLEV_MBOXRD(i)]);
-		seq_printf(m, "IRQ level TX mailbox %d          %10lld\n", i, irqs.levels[VME4L_IRQLEV_MBOXWR(i)]);
+		seq_printf(m, "IRQ level RX mailbox %d          %10llu\n", i, irqs->levels[VME4L_IRQLEV_MBOXRD(i)]);
+		seq_printf(m, "IRQ level TX mailbox %d          %10llu\n", i, irqs->levels[VME4L_IRQLEV_MBOXWR(i)]);
 	}
 	for (i = 0; i < VME4L_IRQLEV_LOCMON_NUM; i++) {
-		seq_printf(m, "IRQ level location monitor %2d   %10lld\n", i, irqs.levels[VME4L_IRQLEV_LOCMON(i)]);
+		seq_printf(m, "IRQ level location monitor %2d   %10llu\n", i, irqs->levels[VME4L_IRQLEV_LOCMON(i)]);
+	}
+
+	kfree(irqs);
+	return 0;
+}
+
+static int vme4l_transfers_proc_show(struct seq_file *m, void *data)
+{
+	VME4L_STATS *stats;
+	VME4L_SPACE_STATS *sp;
+	int spc;
+
+	if ((stats = kmalloc(sizeof(*stats), GFP_KERNEL)) == NULL)
+		return -ENOMEM;
+	vme4l_stats_get(stats);
+
+	seq_printf(m, "%-18s %14s %14s %14s %14s %8s %10s %10s %10s %10s\n",
+		   "SPACE", "dma_rd", "dma_wr", "pio_rd", "pio_wr", "berr",
+		   "win_hit", "win_miss", "map_hit", "map_miss");
+
+	for (spc = 0; spc < VME4L_SPACE_TBL_SIZE; spc++) {
+		sp = &stats->spaces[spc];
+		if (!sp->dmaBytes[0] && !sp->dmaBytes[1] && !sp->pioBytes[0] &&
+		    !sp->pioBytes[1] && !sp->busErrors && !sp->winHits &&
+		    !sp->winMisses)
+			continue;
+
+		seq_printf(m, "%2d %-15s %14llu %14llu %14llu %14llu %8llu "
+			   "%10llu %10llu %10llu %10llu\n",
+			   spc, G_spaceTbl[spc].devName,
+			   sp->dmaBytes[0], sp->dmaBytes[1], sp->pioBytes[0],
+			   sp->pioBytes[1], sp->busErrors, sp->winHits,
+			   sp->winMisses, sp->mapHits, sp->mapMisses);
 	}
 
+	kfree(stats);
 	return 0;
 }
 
 static int vme4l_irq_proc_show(struct seq_file *m, void *data)
 {
-	int vector;
-	unsigned long ps;
-	struct list_head *pos_v;
+	int vector, level;
+	unsigned long long hits;
 	VME4L_IRQ_ENTRY *ent;
+	VME4L_STATS *stats;
+
+	if ((stats = kmalloc(sizeof(*stats), GFP_KERNEL)) == NULL)
+		return -ENOMEM;
+	vme4l_stats_get(stats);
 
 	/*--- IRQ vectors ---*/
 	seq_printf(m, "\n");
 	seq_printf(m, "VME VECTORS\n");
-	VME4L_LOCK_VECTORS(ps);
+	rcu_read_lock();
 
 	for(vector = 0; vector < VME4L_NUM_VECTORS; vector++){
-		if (!list_empty(&G_vectTbl[vector])) {
-			seq_printf(m, " Vec %d:\n", vector);
+		hits = stats->vectors[vector];
 
-			list_for_each(pos_v, &G_vectTbl[vector]) {
-				ent = list_entry(pos_v, VME4L_IRQ_ENTRY, node);
+		if (!list_empty(&G_vectTbl[vector]) || hits) {
+			seq_printf(m, " Vec %d: hits=%llu\n", vector, hits);
+
+			list_for_each_entry_rcu(ent, &G_vectTbl[vector], node) {
 				seq_printf(m, "   Lev %d flg=0x%x",
 							ent->level, ent->flags);
 
@@ -3023,15 +5903,87 @@ static int vme4l_irq_proc_show(struct seq_file *m, void *data)
 						    ent->u.kernel.device,
 						    ent->u.kernel.dev_id);
 					break;
+
+				case VME4L_EVENT_IRQ:
+					seq_printf(m, ", event %s file=%p\n",
+						    ent->u.event.efd ? "eventfd" : "queue",
+						    ent->u.event.file);
+					break;
 				}
 			}
 		}
 	}
-	VME4L_UNLOCK_VECTORS(ps);
+	rcu_read_unlock();
+
+	/*--- deferred VME levels ---*/
+	seq_printf(m, "\nIRQ THREAD %s\n", G_irqThreaded ? "on" : "off");
+	for (level = VME4L_IRQLEV_1; level <= VME4L_IRQLEV_7; level++)
+		seq_printf(m, " Lev %d: budget=%d lost=%u\n", level,
+			   irq_budget[level-1], G_irqRing[level].lost);
+
+	kfree(stats);
+	return 0;
+}
+
+static void vme4l_lat_proc_show(struct seq_file *m, const char *name,
+								VME4L_LAT_HIST *hist)
+{
+	unsigned int cnt[VME4L_LAT_BUCKETS], total = 0;
+	int n;
+
+	for (n = 0; n < VME4L_LAT_BUCKETS; n++)
+		total += (cnt[n] = atomic_read(&hist->bucket[n]));
+	if (!total)
+		return;
+
+	seq_printf(m, "%-12s %10u %8u %9u.%03u", name, total,
+		   atomic_read(&hist->over), READ_ONCE(hist->maxNs) / 1000,
+		   READ_ONCE(hist->maxNs) % 1000);
+	for (n = 0; n < VME4L_LAT_BUCKETS; n++)
+		seq_printf(m, " %7u", cnt[n]);
+	seq_printf(m, "\n");
+}
+
+static int vme4l_irq_latency_proc_show(struct seq_file *m, void *data)
+{
+	static const char *stage[VME4L_LAT_STAGES] = { "irq", "dlv", "user" };
+	char name[16];
+	int level, vector, n;
+
+	seq_printf(m, "IRQ LATENCY (collect=%d budget=%u us)\n",
+		   irq_latency, irq_lat_budget_us);
+	seq_printf(m, "irq:  bridge irq entry -> dispatch\n"
+		   "dlv:  dispatch -> handlers called/events posted\n"
+		   "user: bridge irq entry -> event read()\n"
+		   "vec:  bridge irq entry -> handlers called/events posted\n\n");
+
+	seq_printf(m, "%-12s %10s %8s %13s", "", "count", "overbdgt", "max[us]");
+	for (n = 0; n < VME4L_LAT_BUCKETS - 1; n++)
+		seq_printf(m, " <%6u", 1U << n);
+	seq_printf(m, " >=%5u\n", 1U << (VME4L_LAT_BUCKETS - 2));
+
+	for (level = 0; level < VME4L_NUM_LEVELS; level++) {
+		for (n = 0; n < VME4L_LAT_STAGES; n++) {
+			snprintf(name, sizeof(name), "lev %02x %s", level, stage[n]);
+			vme4l_lat_proc_show(m, name, &G_latLev[level][n]);
+		}
+	}
+	for (vector = 0; vector < VME4L_NUM_VECTORS; vector++) {
+		snprintf(name, sizeof(name), "vec %03x", vector);
+		vme4l_lat_proc_show(m, name, &G_latVect[vector]);
+	}
 
 	return 0;
 }
 
+static ssize_t vme4l_irq_latency_proc_write(struct file *file,
+	const char __user *buf, size_t count, loff_t *ppos)
+{
+	/* any write clears the histograms */
+	vme4l_lat_reset();
+	return count;
+}
+
 static int vme4l_irq_levels_enable_proc_show(struct seq_file *m, void *data)
 {
 	int level;
@@ -3119,6 +6071,31 @@ static const struct file_operations vme4l_interrupts_proc_ops = {
 	.release	= single_release,
 };
 
+static int vme4l_irq_latency_proc_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, vme4l_irq_latency_proc_show, NULL);
+}
+
+static const struct file_operations vme4l_irq_latency_proc_ops = {
+	.open		= vme4l_irq_latency_proc_open,
+	.read		= seq_read,
+	.write		= vme4l_irq_latency_proc_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int vme4l_transfers_proc_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, vme4l_transfers_proc_show, NULL);
+}
+
+static const struct file_operations vme4l_transfers_proc_ops = {
+	.open		= vme4l_transfers_proc_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static int vme4l_irq_levels_enable_proc_open(struct inode *inode, struct file *file)
 {
 	return single_open(file, vme4l_irq_levels_enable_proc_show, NULL);
@@ -3153,6 +6130,14 @@ static void vme_bridge_procfs_register(void)
 	if (!entry)
 		printk(KERN_WARNING "vme4l: Failed to create proc interrupts node\n");
 
+	entry = proc_create("transfers", S_IFREG | S_IRUGO, vme4l_root, &vme4l_transfers_proc_ops);
+	if (!entry)
+		printk(KERN_WARNING "vme4l: Failed to create proc transfers node\n");
+
+	entry = proc_create("irq_latency", S_IFREG | S_IRUGO | S_IWUSR, vme4l_root, &vme4l_irq_latency_proc_ops);
+	if (!entry)
+		printk(KERN_WARNING "vme4l: Failed to create proc irq_latency node\n");
+
 	entry = proc_create("irq_levels_enable", S_IFREG | S_IRUGO, vme4l_root, &vme4l_irq_levels_enable_proc_ops);
 	if (!entry)
 		printk(KERN_WARNING "vme4l: Failed to create proc irq node\n");
@@ -3166,6 +6151,8 @@ static void vme_bridge_procfs_unregister(void)
 {
 	remove_proc_entry("supported_bitstreams", vme4l_root);
 	remove_proc_entry("irq_levels_enable", vme4l_root);
+	remove_proc_entry("irq_latency", vme4l_root);
+	remove_proc_entry("transfers", vme4l_root);
 	remove_proc_entry("interrupts", vme4l_root);
 	remove_proc_entry("irq", vme4l_root);
 	remove_proc_entry("windows", vme4l_root);
@@ -3196,6 +6183,18 @@ static void vme4l_cleanup(void)
 	}
 	unregister_chrdev(major, "vme4l");
 
+	kfree( G_adrsWinPool );
+	G_adrsWinPool = NULL;
+	kfree( G_ioremapCache );
+	G_ioremapCache = NULL;
+
+	if( G_asyncWq ){
+		destroy_workqueue( G_asyncWq );
+		G_asyncWq = NULL;
+	}
+
+	free_percpu( G_stats );
+	G_stats = NULL;
 }
 
 VME4L_BRIDGE_HANDLE* vme_bridge_get_handle(void)
@@ -3242,7 +6241,25 @@ static int __init vme4l_init_module(void)
 #ifdef CONFIG_SMP
 	spin_lock_init( &G_lockFlags );
 #endif
-	init_waitqueue_head( &G_dmaWq );
+	{
+		int ch;
+		for( ch=0; ch<VME4L_MAX_DMA_CHANNELS; ch++ )
+			init_waitqueue_head( &G_dmaChan[ch].wq );
+	}
+	sema_init( &G_dmaChanSem, 1 );
+
+	/* one async worker per DMA channel */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,36)
+	G_asyncWq = alloc_workqueue( "vme4l_async", WQ_UNBOUND,
+								 VME4L_MAX_DMA_CHANNELS );
+#else
+	G_asyncWq = create_singlethread_workqueue( "vme4l_async" );
+#endif
+	if( G_asyncWq == NULL )
+	{
+		printk(KERN_ERR_PFX "%s: Unable to create workqueue\n", __func__);
+		goto CLEANUP;
+	}
 
 	VME4LDBG("vme4l: using major %d\n", major);
   	{
@@ -3252,22 +6269,41 @@ static int __init vme4l_init_module(void)
 		for( minor=0; minor<VME4L_SPACE_TBL_SIZE; minor++, ent++ ){
 			/* init list headers */
 			INIT_LIST_HEAD( &ent->lstAdrsWins );
-
+			G_adrsWinTree[minor] = VME4L_IT_ROOT_INIT;
 		}
 	}
 
+	/* allocate pools, at least one entry each */
+	if( max_adrs_wins == 0 )
+		max_adrs_wins = 1;
+	if( ioremap_cache_size == 0 )
+		ioremap_cache_size = 1;
+
+	G_adrsWinPool = kcalloc( max_adrs_wins, sizeof(*G_adrsWinPool),
+							 GFP_KERNEL );
+	G_ioremapCache = kcalloc( ioremap_cache_size, sizeof(*G_ioremapCache),
+							  GFP_KERNEL );
+	if( G_adrsWinPool == NULL || G_ioremapCache == NULL )
+	{
+		printk(KERN_ERR_PFX "%s: Unable to allocate window pools\n",
+		       __func__);
+		goto CLEANUP;
+	}
+
 	/* init all address windows as unused */
 	INIT_LIST_HEAD( &G_freeAdrsWins );
+	INIT_LIST_HEAD( &G_lstIdleAdrsWins );
 	{
 		int i;
 		VME4L_ADRSWIN *win = G_adrsWinPool;
-		memset( G_adrsWinPool, 0, sizeof(G_adrsWinPool));
 
-		for( i=0; i<VME4L_MAX_ADRS_WINS; i++, win++ ){
+		for( i=0; i<max_adrs_wins; i++, win++ ){
 			list_add_tail( &win->node, &G_freeAdrsWins );
+			INIT_LIST_HEAD( &win->idleNode );
 
 			/* no cached ioremap regions */
 			INIT_LIST_HEAD( &win->lstIoremap );
+			win->regTree = VME4L_IT_ROOT_INIT;
 		}
 	}
 
@@ -3276,9 +6312,8 @@ static int __init vme4l_init_module(void)
 	{
 		int i;
 		VME4L_IOREMAP_REGION *reg = G_ioremapCache;
-		memset( G_ioremapCache, 0, sizeof(G_ioremapCache));
 
-		for( i=0; i<VME4L_MAX_IOREMAP_CACHE; i++, reg++ )
+		for( i=0; i<ioremap_cache_size; i++, reg++ )
 			list_add_tail( &reg->cacheNode, &G_lstIoremapCache );
 	}
 
@@ -3289,6 +6324,22 @@ static int __init vme4l_init_module(void)
 			INIT_LIST_HEAD( &G_vectTbl[i] );
 	}
 
+	/* statistics, counters are summed up as uint64_t array */
+	BUILD_BUG_ON( VME4L_SPACE_TBL_SIZE > VME4L_STATS_SPACES );
+	BUILD_BUG_ON( sizeof(VME4L_STATS) % sizeof(uint64_t) );
+	if( (G_stats = alloc_percpu( VME4L_PCPU_STATS )) == NULL )
+	{
+		printk(KERN_ERR_PFX "%s: Unable to allocate statistics\n", __func__);
+		goto CLEANUP;
+	}
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3,13,0)
+	{
+		int cpu;
+		for_each_possible_cpu( cpu )
+			u64_stats_init( &per_cpu_ptr( G_stats, cpu )->sync );
+	}
+#endif
+
 	/* create proc interface */
 	vme_bridge_procfs_register();
 
@@ -3317,6 +6368,14 @@ EXPORT_SYMBOL(vme4l_rw);
 EXPORT_SYMBOL(vme4l_register_bridge_driver);
 EXPORT_SYMBOL(vme4l_unregister_bridge_driver);
 EXPORT_SYMBOL(vme4l_irq);
+EXPORT_SYMBOL(vme4l_irq_entry);
+EXPORT_SYMBOL(vme4l_irq_done);
+EXPORT_SYMBOL(vme4l_irq_none);
+EXPORT_SYMBOL(vme4l_irq_thread);
+EXPORT_SYMBOL(vme4l_request_irq);
+EXPORT_SYMBOL(vme4l_free_irq);
+EXPORT_SYMBOL(vme4l_request_soft_irq);
+EXPORT_SYMBOL(vme4l_free_soft_irq);
 
 EXPORT_SYMBOL(VME_REQUEST_IRQ);
 EXPORT_SYMBOL(VME_FREE_IRQ);
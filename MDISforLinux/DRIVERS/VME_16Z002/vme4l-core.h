@@ -61,6 +61,8 @@
 #include <linux/mm.h>
 #include <linux/pci.h>
 #include <linux/seq_file.h>
+#include <linux/workqueue.h>
+#include <linux/ktime.h>
 #if LINUX_VERSION_CODE < KERNEL_VERSION(4,12,0)
 #include <asm/uaccess.h>        /* put_user */
 #else
@@ -84,10 +86,14 @@
 /* VME4L_ADRSWIN.flags */
 /*#define VME4L_AW_POSTED_WR	0x01*/
 #define VME4L_AW_HW_SWAP1	0x02
+#define VME4L_AW_WC			0x04	/* core only: mapped write-combining */
 
 /* DMA finished pseude irq level */
 #define VME4L_IRQLEV_DMAFINISHED	0x80
 
+/** max. interrupt sources a bridge handles per hardware interrupt */
+#define VME4L_IRQ_BUDGET			16
+
 #ifndef COMPILE_VME_BRIDGE_DRIVER
 typedef void *VME4L_BRIDGE_HANDLE;
 #endif
@@ -130,20 +136,152 @@ typedef struct {
 	uint32_t dmaLength;
 } VME4L_SCATTER_ELEM;
 
-typedef struct vme4l_irq_stat {
-	unsigned sequence;	/* If we need consistency, this is it. LSB bit
-				 * informs whether this struct is locked already */
-/* use signed, so it is likely that someone will notice unelikely the overflow */
-	int64_t vme;
-	int64_t ber;
-	int64_t dma;
-	int64_t mbox;
-	int64_t mon;
-	int64_t hw_total;
-	int64_t handled;
-	int64_t spurious;
-	int64_t levels[VME4L_NUM_LEVELS];
-} VME4L_IRQ_STAT;
+/** Optional low level VME bridge operations
+ *
+ * Operations added after the layout of VME4L_BRIDGE_DRV was fixed.
+ * Referenced by VME4L_BRIDGE_DRV.ext, all members can be NULL.
+ */
+typedef struct VME4L_BRIDGE_DRV_EXT {
+
+	/***********************************************************************/
+    /** Prepare next DMA chain while the current DMA is running
+	 *
+	 * (this function is optional and can be NULL)
+	 *
+	 * Same as dmaSetup, but writes the descriptors into the currently
+	 * unused descriptor area (double buffering) and must not touch the
+	 * DMA controller registers. It is called while the DMA started by
+	 * dmaStart or dmaStartNext is still running.
+	 *
+	 * If dmaSetupNext and dmaStartNext are present, the core pre-builds
+	 * the next chain of long scatter lists and starts it from the
+	 * DMA finished interrupt, avoiding the gap between chains.
+	 *
+	 * \sa dmaSetup
+	 */
+	int (*dmaSetupNext)(
+		VME4L_BRIDGE_HANDLE *h,
+		int ch,
+		VME4L_SPACE spc,
+		VME4L_SCATTER_ELEM *sgList,
+		int sgNelems,
+		int direction,
+		int swapMode,
+		vmeaddr_t *vmeAddr,
+		int flags);
+
+	/***********************************************************************/
+    /** Start DMA chain prepared by dmaSetupNext
+	 *
+	 * (this function is optional and can be NULL)
+	 *
+	 * Makes the descriptor area filled by dmaSetupNext the active one
+	 * and starts the DMA. Called with interrupts disabled, usually from
+	 * vme4l_irq() for the DMA finished interrupt, so it must not take
+	 * locks held by the bridge's interrupt handler while calling
+	 * vme4l_irq(). Must return -EIO if the previous chain failed.
+	 *
+	 * \param h				brigde private handle
+	 * \param ch			DMA channel
+	 * \return 0 on success or negative error number
+	 */
+	int (*dmaStartNext)(
+		VME4L_BRIDGE_HANDLE *h,
+		int ch);
+
+	/***********************************************************************/
+    /** Get number of independent DMA channels
+	 *
+	 * (this function is optional and can be NULL, then 1 channel is used)
+	 *
+	 * The core runs up to this many DMA transfers concurrently. The
+	 * bridge driver must report the DMA finished interrupt of channel
+	 * \a ch as vme4l_irq( VME4L_IRQLEV_DMAFINISHED, ch, ... ).
+	 *
+	 * \param h				brigde private handle
+	 * \return number of DMA channels (>=1)
+	 */
+	int (*dmaChannelsGet)(
+		VME4L_BRIDGE_HANDLE *h);
+
+	/***********************************************************************/
+    /** Get max. number of bytes of one DMA scatter element
+	 *
+	 * (this function is optional and can be NULL, then scatter elements
+	 * never cross a page boundary)
+	 *
+	 * The core merges physically contiguous pages into one scatter
+	 * element up to this length. The value should be a multiple of
+	 * PAGE_SIZE.
+	 *
+	 * \param h				brigde private handle
+	 * \return max. bytes per scatter element passed to dmaSetup
+	 */
+	uint32_t (*dmaSegMaxGet)(
+		VME4L_BRIDGE_HANDLE *h);
+
+	/***********************************************************************/
+    /** Read block from master window
+	 *
+	 * (this function is optional and can be NULL, then readPioXX is used)
+	 *
+	 * Reads \a size bytes with \a accWidth wide accesses into a kernel
+	 * buffer. Unlike readPioXX, bus errors need to be checked only once
+	 * for the whole block. Called with blocks of up to 256 bytes.
+	 *
+	 * \param h				brigde private handle
+	 * \param vaddr			virtual address of first VME location
+	 * \param dataP		   	(OUT) kernel buffer for data read
+	 * \param size			number of bytes (multiple of \a accWidth)
+	 * \param accWidth		access width (1, 2 or 4)
+	 * \param flags			not yet used
+	 * \param bDrvData		the pointer returned by requestAddrWindow()
+	 *
+	 * \return 0 on success, or negative error number:\n
+	 * - -EIO on bus error
+	 */
+	int (*readPioBlock)(
+		VME4L_BRIDGE_HANDLE *h,
+		void *vaddr,
+		void *dataP,
+		size_t size,
+		int accWidth,
+		int flags,
+		void *bDrvData);
+
+	/***********************************************************************/
+    /** Write block to master window
+	 *
+	 * (this function is optional and can be NULL, then writePioXX is used)
+	 *
+	 * \sa readPioBlock
+	 */
+	int (*writePioBlock)(
+		VME4L_BRIDGE_HANDLE *h,
+		void *vaddr,
+		void *dataP,
+		size_t size,
+		int accWidth,
+		int flags,
+		void *bDrvData);
+
+	/***********************************************************************/
+    /** Get device used to map zero-copy DMA buffers
+	 *
+	 * (this function is optional and can be NULL, then the device
+	 * returned by pciDevGet is used)
+	 *
+	 * For bridges that are not PCI devices. The device must have a
+	 * DMA mask set, scatter lists passed to dmaSetup are mapped with
+	 * dma_map_sg() for it.
+	 *
+	 * \param h				brigde private handle
+	 * \return device, or NULL if zero-copy DMA is not possible
+	 */
+	struct device * (*dmaDevGet)(
+		VME4L_BRIDGE_HANDLE *h);
+
+} VME4L_BRIDGE_DRV_EXT;
 
 /** Low level VME bridge interface */
 
@@ -166,12 +304,12 @@ typedef struct VME4L_BRIDGE_DRV {
 	void (*getSupportedBitstreams)(struct seq_file *m);
 
 	/***********************************************************************/
-	/** Get interrupts' stats
+	/** Unused, was getIrqStats
 	 *
-	 * Please note that these stats may be inconsistent! Make sure
-	 * irqs->sequence is even and getIrqStats returned 0.
+	 * Interrupt statistics are now kept by vme4l-core. The member is
+	 * kept so that the layout of this struct remains unchanged.
 	 */
-	int (*getIrqStats)(VME4L_BRIDGE_HANDLE *h, VME4L_IRQ_STAT *irqs, size_t stats_size);
+	void (*getIrqStatsUnused)(void);
 
 	/***********************************************************************/
     /** Request VME master address window
@@ -357,6 +495,7 @@ typedef struct VME4L_BRIDGE_DRV {
 	 * (this function is optional and can be NULL)
 	 *
 	 * \param h				brigde private handle
+	 * \param ch			DMA channel (0..dmaChannelsGet-1)
 	 * \param spc			VME4L space number for this DMA transfer
 	 * \param sgList		list with \a sgElems scatter elements
 	 * \param sgNelems		number of valid elements in \a sgList
@@ -370,6 +509,7 @@ typedef struct VME4L_BRIDGE_DRV {
 	 */
 	int (*dmaSetup)(
 		VME4L_BRIDGE_HANDLE *h,
+		int ch,
 		VME4L_SPACE spc,
 		VME4L_SCATTER_ELEM *sgList,
 		int sgNelems,
@@ -431,30 +571,37 @@ typedef struct VME4L_BRIDGE_DRV {
     /** Start DMA with the scatter list or bounce buffer.
 	 *
 	 * DMA must have been initialized by dmaSetup or dmaBounceSetup
+	 * (bounce buffer DMA always uses channel 0)
 	 *
 	 * \param h				brigde private handle
+	 * \param ch			DMA channel
 	 * \return 0 on success or negative error number
 	 */
 	int (*dmaStart)(
-		VME4L_BRIDGE_HANDLE *h);
+		VME4L_BRIDGE_HANDLE *h,
+		int ch);
 
 	/***********************************************************************/
     /** Stop DMA
 	 *
 	 * \param h				brigde private handle
+	 * \param ch			DMA channel
 	 * \return 0 on success or negative error number
 	 */
 	int (*dmaStop)(
-		VME4L_BRIDGE_HANDLE *h);
+		VME4L_BRIDGE_HANDLE *h,
+		int ch);
 
 	/***********************************************************************/
     /** Get DMA status (after DMA was started with dmaStart)
 	 *
 	 * \param h				brigde private handle
+	 * \param ch			DMA channel
 	 * \return 0=DMA finished ok, <0=finished with error >0 DMA running
 	 */
 	int (*dmaStatus)(
-		VME4L_BRIDGE_HANDLE *h);
+		VME4L_BRIDGE_HANDLE *h,
+		int ch);
 
 	/**********************************************************************/
     /** Generate a VMEbus interrupt
@@ -605,7 +752,7 @@ typedef struct VME4L_BRIDGE_DRV {
 	 * \param physAddrP	\IN	 address of previous mapping
 	 *					\OUT receives the CPU physical address of
 	 *						 the window. Either the dedicated RAM address
-	 *						 or phys address of pci_alloc_consistent.
+	 *						 or phys address of dma_alloc_coherent.
 	 * \param bDrvDataP	\OUT bridge driver may store some window related
 	 *						pointer here.
      *
@@ -660,8 +807,18 @@ typedef struct VME4L_BRIDGE_DRV {
         struct pci_dev * (*pciDevGet)(
 		VME4L_BRIDGE_HANDLE *h);
 
+	/***********************************************************************/
+    /** Optional operations added later, see VME4L_BRIDGE_DRV_EXT
+	 *
+	 * (can be NULL, then none of them is used)
+	 *
+	 * Takes the place of the first reserved words, so the layout of this
+	 * struct remains unchanged.
+	 */
+	const struct VME4L_BRIDGE_DRV_EXT *ext;
+
 	/* leave space for future expansion */
-	uint32_t reserved[5];
+	uint32_t reserved[5 - sizeof(void *) / sizeof(uint32_t)];
 
 } VME4L_BRIDGE_DRV;
 
@@ -685,7 +842,16 @@ int vme4l_register_bridge_driver( VME4L_BRIDGE_DRV *drv,
 								  VME4L_BRIDGE_HANDLE *drvData );
 void vme4l_unregister_bridge_driver(void);
 
+void vme4l_irq_entry( void );
 void vme4l_irq( int level, int vector, struct pt_regs *regs);
+irqreturn_t vme4l_irq_done( void );
+irqreturn_t vme4l_irq_none( void );
+irqreturn_t vme4l_irq_thread( int irq, void *dev_id );
+int vme4l_request_irq( unsigned int irq, irq_handler_t handler,
+					   unsigned long flags, const char *name, void *dev );
+void vme4l_free_irq( unsigned int irq, void *dev );
+int vme4l_request_soft_irq( void );
+void vme4l_free_soft_irq( void );
 
 VME4L_SPACE_ENT* vme4l_get_space_ent(unsigned int idx);
 
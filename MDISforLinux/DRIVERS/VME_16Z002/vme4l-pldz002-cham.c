@@ -66,6 +66,9 @@
 #define BOUNCE_SRAM_A21SIZE	0x100000    /* 1MB SRAM  */
 #define BOUNCE_SRAM_A15SIZE	0x40000
 #define PLDZ002_MAX_UNITS	8
+
+/** max. bytes per DMA buffer descriptor */
+#define PLDZ002_DMABD_MAX_LEN	(256*1024)
 #define BOUNCE_SRAM_SIZE 	BOUNCE_SRAM_A21SIZE
 
 #define PLDZ002_VAR_VMEA32      8  /* Variant of that PLDZ002 core that represents A32 space.
@@ -220,7 +223,6 @@ struct vme4l_bridge_handle {
 	uint32_t dmaError;
 	spinlock_t lockState;		/**< spin lock for VME bridge registers and handle state */
 	int refCounter;		/**< number of registered clients */
-	VME4L_IRQ_STAT irqs;
 };
 
 
@@ -282,22 +284,6 @@ void GetSupportedBitstreams(struct seq_file *m)
 	}
 }
 
-int GetIrqStats(VME4L_BRIDGE_HANDLE *h, VME4L_IRQ_STAT *irqs, size_t stats_size)
-{
-	unsigned seq1;
-	unsigned seq2;
-	
-	seq1 = h->irqs.sequence;
-	memcpy(irqs, &h->irqs, stats_size);
-	seq2 = h->irqs.sequence;
-
-	if ((seq1 != seq2) || (h->irqs.sequence & 1)) {
-		/* Inconsistent data */
-		return -1;
-	}
-	return 0;
-}
-
 /***********************************************************************/
 /** Get system IRQ no.
  */
@@ -627,6 +613,7 @@ static inline uint32_t DmaSwapMode( int swapMode )
  */
 static int DmaSetup(
 	VME4L_BRIDGE_HANDLE *h,
+	int ch,
 	VME4L_SPACE spc,
 	VME4L_SCATTER_ELEM *sgList,
 	int sgNelems,
@@ -683,7 +670,7 @@ static int DmaSetup(
 
 		/*--- check alignment/size ---*/
 		if( (*vmeAddr & (alignVme-1)) || (sgList->dmaAddress & (alignVme-1)) ||
-			(sgList->dmaLength > 256*1024) || (sgList->dmaLength & (alignVme-1))){
+			(sgList->dmaLength > PLDZ002_DMABD_MAX_LEN) || (sgList->dmaLength & (alignVme-1))){
 			printk(KERN_ERR_PFX "%s: DMA setup bad alignment/len "
 			       "%08llx %08llx %x\n", __func__, *vmeAddr,
 			       (uint64_t)sgList->dmaAddress, sgList->dmaLength );
@@ -835,7 +822,7 @@ static int DmaBounceSetup(
 /** Start DMA with the scatter list setup by dmaSetup
  *
  */
-static int DmaStart( VME4L_BRIDGE_HANDLE *h )
+static int DmaStart( VME4L_BRIDGE_HANDLE *h, int ch )
 {
 	uint8_t dmastat;
 	int rv = 0;
@@ -872,7 +859,7 @@ CLEANUP:
 /***********************************************************************/
 /** Stop DMA
  */
-static int DmaStop(	VME4L_BRIDGE_HANDLE *h )
+static int DmaStop(	VME4L_BRIDGE_HANDLE *h, int ch )
 {
 	unsigned long ps;
 
@@ -889,7 +876,7 @@ static int DmaStop(	VME4L_BRIDGE_HANDLE *h )
  *
  * \return 0=DMA finished ok, <0=finished with error >0 DMA running
  */
-static int DmaStatus( VME4L_BRIDGE_HANDLE *h )
+static int DmaStatus( VME4L_BRIDGE_HANDLE *h, int ch )
 {
 	uint8_t status;
 	int rv = 0;
@@ -1161,6 +1148,14 @@ static struct pci_dev * PciDevGet( VME4L_BRIDGE_HANDLE *h )
        return h->chu->pdev;
 }
 
+/**********************************************************************/
+/** Get max. number of bytes of one DMA scatter element
+ */
+static uint32_t DmaSegMaxGet( VME4L_BRIDGE_HANDLE *h )
+{
+	return PLDZ002_DMABD_MAX_LEN;
+}
+
 
 /**********************************************************************/
 /** Get VMEbus address modifier
@@ -1666,10 +1661,12 @@ int LocMonRegWriteFs2(
 }
 
 
+/* optional ops, set up depending on feature level */
+static VME4L_BRIDGE_DRV_EXT G_bridgeDrvExt;
+
 static VME4L_BRIDGE_DRV G_bridgeDrv = {
 	.revisionInfo		= RevisionInfo,
 	.getSupportedBitstreams = GetSupportedBitstreams,
-	.getIrqStats		= GetIrqStats,
 	.requestAddrWindow 	= RequestAddrWindow,
 	.releaseAddrWindow 	= ReleaseAddrWindow,
 	.irqLevelCtrl		= IrqLevelCtrl,
@@ -1815,10 +1812,6 @@ static int PldZ002_ProcessPendingVmeInterrupts(VME4L_BRIDGE_HANDLE *h,
 		if(mstr & PLDZ002_MSTR_BERR) {
 			/* clear bus error */
 			VME4LERR(PFX "%s: bus error during vme interrupt?\n", __func__);
-			if (mstr & PLDZ002_MSTR_IBERREN) {
-				/* irq enabled count it */
-				h->irqs.ber++;
-			}
 			StoreAndClearBuserror(h);
 			*vecP = VME4L_IRQVEC_SPUR;
 		}
@@ -1956,29 +1949,21 @@ static irqreturn_t PldZ002Irq(int irq, void *dev_id )
 	VME4L_BRIDGE_HANDLE *h 	= (VME4L_BRIDGE_HANDLE *)dev_id;
 	int handled=1;
 	int something_handled = 0;
+	int pass;
+
+	vme4l_irq_entry();
+
 	/* VME4LDBG */
 	PLDZ002_LOCK_STATE();
 
-	/* lock for irq stat */
-	if (h->irqs.sequence & 1) {
-		/* This should never happen */
-		printk(KERN_ERR_PFX "%s: irq stats already locked "
-		       "sequence number %\n", __func__, h->irqs.sequence);
-		/* make sure it gets to the unlocked value */
-		h->irqs.sequence++;
-	}
-	h->irqs.sequence++;
-
-	h->irqs.hw_total++;
-	while (handled) {
+	/* rescan all sources until none is pending, within budget */
+	for (pass = 0; handled && pass < VME4L_IRQ_BUDGET; pass++) {
 		handled = 0;
 
 		/* 2. get pending VME interrupts, perform IACK */
 		if (0 < PldZ002_ProcessPendingVmeInterrupts( h, &vector, &level )){
 			handled = 1;
 			something_handled++;
-			h->irqs.vme++;
-			h->irqs.levels[level]++;
 			VME4LDBG("PldZ002Irq: ProcessPendingVmeInterrupts vector=%d level=%d\n", vector, level);
 
 			vme4l_irq( level, vector, regs );
@@ -1988,8 +1973,6 @@ static irqreturn_t PldZ002Irq(int irq, void *dev_id )
 		if (0 < PldZ002_CheckVmeBusError( h, &vector, &level )){
 			handled = 1;
 			something_handled++;
-			h->irqs.ber++;
-			h->irqs.levels[level]++;
 			VME4LDBG("PldZ002Irq: CheckVmeBusError vector=%d level=%d\n", vector, level);
 
 			vme4l_irq( level, vector, regs );
@@ -2000,8 +1983,6 @@ static irqreturn_t PldZ002Irq(int irq, void *dev_id )
 		if (0 < PldZ002_CheckDmaVmeInterrupts(h, &vector, &level)){
 			handled = 1;
 			something_handled++;
-			h->irqs.dma++;
-			h->irqs.levels[level]++;
 			VME4LDBG("PldZ002Irq: PldZ002_CheckDmaVmeInterrupts vector=%d level=%d\n", vector, level);
 
 			vme4l_irq( level, vector, regs );
@@ -2010,8 +1991,6 @@ static irqreturn_t PldZ002Irq(int irq, void *dev_id )
 		if (0 < PldZ002_CheckMailboxInterrupts(h, &vector, &level)){
 			handled = 1;
 			something_handled++;
-			h->irqs.mbox++;
-			h->irqs.levels[level]++;
 			VME4LDBG("PldZ002Irq: PldZ002_CheckMailboxInterrupts vector=%d level=%d\n", vector, level);
 
 			vme4l_irq( level, vector, regs );
@@ -2020,42 +1999,18 @@ static irqreturn_t PldZ002Irq(int irq, void *dev_id )
 		if (0 < PldZ002_CheckLocationMonitorInterrupts(h, &vector, &level)){
 			handled = 1;
 			something_handled++;
-			h->irqs.mon++;
-			h->irqs.levels[level]++;
 			VME4LDBG("PldZ002Irq: PldZ002_CheckLocationMonitorInterrupts vector=%d level=%d\n", vector, level);
 
 			vme4l_irq( level, vector, regs );
 		}
 	}
-	h->irqs.handled += something_handled;
-
 
-	if (!something_handled) {
+	if (!something_handled)
 		VME4LDBG("%s: unhandled int!\n", __func__);
-		h->irqs.spurious++;
-	} else {
-		VME4LDBG("%s: irq_dma %d, irq_mailbox %d, irq_monitor %d, "
-		         "irq_vme %d, irq_bus_error %d\n",
-			 __func__, h->irqs.dma, h->irqs.mbox, h->irqs.mon,
-			 h->irqs.vme, h->irqs.ber);
-	}
-	VME4LDBG("%s: handled_total %d, ints_total %d, something_handled %d "
-		 "delta %d\n",
-		 __func__, h->irqs.handled, h->irqs.hw_total,
-		 something_handled, h->irqs.handled - h->irqs.hw_total);
-
-	if (!(h->irqs.sequence & 1)) {
-		/* This should never happen */
-		printk(KERN_ERR_PFX "%s: irq stats already unlocked "
-		       "sequence number %\n", __func__, h->irqs.sequence);
-		/* make sure it gets to the locked value */
-		h->irqs.sequence++;
-	}
-	h->irqs.sequence++;
 
 	PLDZ002_UNLOCK_STATE();
 
-	return something_handled ? IRQ_HANDLED : IRQ_NONE;
+	return something_handled ? vme4l_irq_done() : vme4l_irq_none();
 }
 
 
@@ -2310,7 +2265,7 @@ static int vme4l_probe( CHAMELEONV2_UNIT_T *chu )
 		goto CLEANUP;
 	} else {
 		/*normal linux kernel mode: PldZ002Irq is a standard linux IRQ handler */
-		if( (rv = request_irq( chu->pdev->irq, PldZ002Irq,
+		if( (rv = vme4l_request_irq( chu->pdev->irq, PldZ002Irq,
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,20)
 						IRQF_SHARED,
 #else
@@ -2344,6 +2299,8 @@ static int vme4l_probe( CHAMELEONV2_UNIT_T *chu )
 	else {
 		VME4LDBG("G_bridgeDrv: using DmaSetup (direct RAM->VME transfer)\n");
 		G_bridgeDrv.dmaSetup 		= DmaSetup;
+		G_bridgeDrvExt.dmaSegMaxGet	= DmaSegMaxGet;
+		G_bridgeDrv.ext				= &G_bridgeDrvExt;
 		pci_set_master( h->chu->pdev );	/* enable bus mastering */
 	}
 
@@ -2366,7 +2323,7 @@ static int vme4l_probe( CHAMELEONV2_UNIT_T *chu )
 
 	if( irqReq ){
 
-		free_irq( chu->pdev->irq, h );
+		vme4l_free_irq( chu->pdev->irq, h );
 		pci_disable_msi(chu->pdev);
 	}
 
@@ -2410,7 +2367,7 @@ static int vme4l_remove( CHAMELEONV2_UNIT_T *chu )
 		FreeRegSpace( &h->iack 		);
 		FreeRegSpace( &h->bounce 	);
 
-		free_irq( chu->pdev->irq, h 	);
+		vme4l_free_irq( chu->pdev->irq, h 	);
 		pci_disable_msi(chu->pdev);
 	}
 
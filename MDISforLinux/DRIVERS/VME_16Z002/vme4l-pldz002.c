@@ -505,6 +505,7 @@ static inline uint32_t DmaSwapMode( int swapMode )
  */
 static int DmaSetup(
 	VME4L_BRIDGE_HANDLE *h,
+	int ch,
 	VME4L_SPACE spc,
 	VME4L_SCATTER_ELEM *sgList,
 	int sgNelems,
@@ -689,7 +690,7 @@ static int DmaBounceSetup(
 /** Start DMA with the scatter list setup by dmaSetup
  *
  */
-static int DmaStart( VME4L_BRIDGE_HANDLE *h )
+static int DmaStart( VME4L_BRIDGE_HANDLE *h, int ch )
 {
 	if( VME_REG_READ8( PLDZ002_DMASTA ) & PLDZ002_DMASTA_EN ){
 		VME4LDBG("*** pldz002: dmaStart: DMA busy! %02x\n",
@@ -705,7 +706,7 @@ static int DmaStart( VME4L_BRIDGE_HANDLE *h )
 /***********************************************************************/
 /** Stop DMA
  */
-static int DmaStop(	VME4L_BRIDGE_HANDLE *h )
+static int DmaStop(	VME4L_BRIDGE_HANDLE *h, int ch )
 {
 	VME_REG_WRITE8( PLDZ002_DMASTA, PLDZ002_DMASTA_IRQ | PLDZ002_DMASTA_ERR );
 
@@ -718,7 +719,7 @@ static int DmaStop(	VME4L_BRIDGE_HANDLE *h )
  *
  * \return 0=DMA finished ok, <0=finished with error >0 DMA running
  */
-static int DmaStatus( VME4L_BRIDGE_HANDLE *h )
+static int DmaStatus( VME4L_BRIDGE_HANDLE *h, int ch )
 {
 	uint8_t status = VME_REG_READ8( PLDZ002_DMASTA );
 
@@ -1754,39 +1755,35 @@ static irqreturn_t PldZ002Irq(int irq, void *dev_id, struct pt_regs *regs)
 	int vector=0, level=VME4L_IRQLEV_UNKNOWN;
 	VME4L_BRIDGE_HANDLE *h 	= (VME4L_BRIDGE_HANDLE *)dev_id;
 
-	int handled=1;
+	int handled=0;
+
+	vme4l_irq_entry();
 
 	/* VME4LDBG */
 	PLDZ002_LOCK_STATE();
 
-	/* 1. check for bus errors */
-	if (PldZ002_CheckVmeBusError( h, &vector, &level ))
-		goto DONE;
-
-	/* 2. get pending VME interrupts, perform IACK */
-	if (PldZ002_ProcessPendingVmeInterrupts( h, &vector, &level ))
-		goto DONE;
-	
-	/* 3. check the other IRQ causes (DMA/Mailbox/location monitor) */
-	if (PldZ002_CheckMiscVmeInterrupts(h, &vector, &level))
-		goto DONE;
-
-	/* no interrupt source -> exit */
-	handled=0;
+	/* handle all pending sources in priority order, within budget */
+	while( handled < VME4L_IRQ_BUDGET ){
+		/* 1. check for bus errors
+		   2. get pending VME interrupts, perform IACK
+		   3. check the other IRQ causes (DMA/Mailbox/location monitor) */
+		if( !PldZ002_CheckVmeBusError( h, &vector, &level ) &&
+			!PldZ002_ProcessPendingVmeInterrupts( h, &vector, &level ) &&
+			!PldZ002_CheckMiscVmeInterrupts( h, &vector, &level ))
+			break;	/* no (more) interrupt sources */
 
-	VME4LDBG("PldZ002Irq: unhandled irq! vec=%d lev=%d\n", vector, level );
-	goto EXIT;
-	
- DONE:
-	VME4LDBG("PldZ002Irq: vector=%d level=%d\n", vector, level );
+		VME4LDBG("PldZ002Irq: vector=%d level=%d\n", vector, level );
+		handled++;
 
-	vme4l_irq( level, vector, NULL );
+		vme4l_irq( level, vector, NULL );
+	}
 
+	if( !handled )
+		VME4LDBG("PldZ002Irq: unhandled irq! vec=%d lev=%d\n", vector, level );
 
- EXIT:	
 	PLDZ002_UNLOCK_STATE();
 
-	return handled ? IRQ_HANDLED : IRQ_NONE;
+	return handled ? IRQ_HANDLED : vme4l_irq_none();
 
 }
 
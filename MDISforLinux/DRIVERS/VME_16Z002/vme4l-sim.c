@@ -0,0 +1,1261 @@
+/*********************  P r o g r a m  -  M o d u l e ***********************/
+/*!
+ *        \file  vme4l-sim.c
+ *
+ *        \brief VME bridge simulator for VME4L
+ *
+ * Software VME bridge without hardware, to benchmark and regression test
+ * vme4l-core on any machine:
+ *
+ * - A16, A24 and A32 spaces are backed by RAM, starting at VME address 0.
+ *   Master windows and slave windows of a space share the same RAM, so
+ *   data written through a master window can be read back through the
+ *   slave window and vice versa. Accesses beyond the RAM fail like
+ *   accesses to VME addresses without a slave.
+ * - two DMA channels, each run by a kernel thread that copies the scatter
+ *   list and completes after \a dma_latency_us plus the transfer time at
+ *   \a dma_mbps.
+ * - interrupts are delivered from a hrtimer (hard irq context) after
+ *   \a irq_latency_us. VME interrupts can be raised every
+ *   \a irq_period_us and by VME4L_IrqGenerate() (loop back). With the
+ *   core's irq_threaded parameter set, levels 1..7 are dispatched from
+ *   a work item running vme4l_irq_thread().
+ * - every \a berr_every master access or DMA fails with a bus error.
+ *
+ * Scatter lists are mapped for a platform device without IOMMU, so DMA
+ * addresses are CPU physical addresses.
+ *
+ *     Switches: -
+ */
+/*
+ *---------------------------------------------------------------------------
+ * Copyright (c) 2003-2019, MEN Mikro Elektronik GmbH
+ ******************************************************************************/
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <linux/version.h>
+#include <linux/module.h>
+#include <linux/kernel.h> /* printk() */
+#include <linux/platform_device.h>
+#include <linux/kthread.h>
+#include <linux/hrtimer.h>
+#include <linux/highmem.h>
+#include <linux/wait.h>
+#include <linux/math64.h>
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+#define PFX "vme4l_sim: "
+#define KERN_ERR_PFX KERN_ERR "!!!" PFX
+
+#define SIM_RAM_A16			0
+#define SIM_RAM_A24			1
+#define SIM_RAM_A32			2
+#define SIM_RAM_NUM			3	/**< number of RAM backed spaces */
+
+#define SIM_DMA_CHANNELS	2	/**< No. of DMA channels */
+#define SIM_DMA_DESC_AREAS	2	/**< scatter lists per channel (dmaSetupNext) */
+#define SIM_DMA_ELEMS		256	/**< max. scatter elements per DMA chain */
+#define SIM_DMA_SEG_MAX		0x100000 /**< max. bytes per scatter element */
+
+#define SIM_INTERRUPTER_ID	1	/**< only one interrupter */
+
+/* VME4L_SIM_DMA.state */
+#define SIM_DMA_IDLE		0
+#define SIM_DMA_RUNNING		1
+#define SIM_DMA_ERROR		2
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(2,6,37)
+# define SIM_KMAP(pg)		kmap_atomic( (pg), KM_USER0 )
+# define SIM_KUNMAP(va)		kunmap_atomic( (va), KM_USER0 )
+#else
+# define SIM_KMAP(pg)		kmap_atomic( pg )
+# define SIM_KUNMAP(va)		kunmap_atomic( va )
+#endif
+
+#ifndef READ_ONCE
+# define READ_ONCE(x)		ACCESS_ONCE(x)
+#endif
+
+/* raw accessors, simulated VME memory has CPU byte order */
+#define SIM_RAW_READ8		__raw_readb
+#define SIM_RAW_READ16		__raw_readw
+#define SIM_RAW_READ32		__raw_readl
+#define SIM_RAW_WRITE8		__raw_writeb
+#define SIM_RAW_WRITE16		__raw_writew
+#define SIM_RAW_WRITE32		__raw_writel
+
+/*-----------------------------+
+|  TYPEDEFS					   |
++------------------------------*/
+/* defined below, core header needs the handle type */
+typedef struct VME4L_SIM_BH VME4L_BRIDGE_HANDLE;
+
+#define COMPILE_VME_BRIDGE_DRIVER
+#include "vme4l-core.h"
+
+/** RAM that backs a VME space */
+typedef struct {
+	const char		*name;			/**< space name for printouts */
+	size_t			size;			/**< backed size from VME address 0 */
+	void			*vaddr;			/**< kernel virtual address of RAM */
+	int				order;			/**< page order of allocation */
+} VME4L_SIM_RAM;
+
+/** one scatter list of a DMA channel */
+typedef struct {
+	VME4L_SIM_RAM		*ram;		/**< VME space of transfer */
+	vmeaddr_t			vmeAddr;	/**< VME start address */
+	int					direction;	/**< 0=read from VME 1=write to VME */
+	int					nElems;		/**< valid elements in sgList */
+	VME4L_SCATTER_ELEM	sgList[SIM_DMA_ELEMS];
+} VME4L_SIM_DMA_DESC;
+
+/** DMA channel */
+typedef struct {
+	int					ch;			/**< channel number */
+	int					state;		/**< SIM_DMA_xxx */
+	int					descIdx;	/**< desc used by dmaSetup/dmaStart */
+	VME4L_SIM_DMA_DESC	desc[SIM_DMA_DESC_AREAS];
+	struct task_struct	*thread;	/**< DMA engine */
+	wait_queue_head_t	wq;			/**< wakes DMA engine */
+} VME4L_SIM_DMA;
+
+/**	bridge drivers private data	*/
+struct VME4L_SIM_BH {
+	struct platform_device	*pdev;	/**< device for DMA mapping */
+	VME4L_SIM_RAM		ram[SIM_RAM_NUM];
+	VME4L_SIM_DMA		dma[SIM_DMA_CHANNELS];
+
+	uint32_t			levEnbl;	/**< enabled levels (bit per level) */
+	uint32_t			levPend;	/**< pending VME levels 1..7 */
+	int					levVector[VME4L_IRQLEV_7+1]; /**< vector of pending
+										   level */
+	uint32_t			dmaPend;	/**< DMA finished (bit per channel) */
+	int					berrPend;	/**< bus error interrupt pending */
+	int					genLevel;	/**< level raised by irqGenerate,
+										 0 when acknowledged */
+	vmeaddr_t			berrAddr;	/**< VME address of last bus error */
+	int					berrAttr;	/**< last bus error valid */
+	atomic_t			berrCount;	/**< master accesses for berr_every */
+	int					shutdown;	/**< no more interrupts */
+
+	struct hrtimer		irqTimer;	/**< delivers pending interrupts */
+	struct hrtimer		genTimer;	/**< periodic VME interrupt */
+	struct work_struct	irqThreadWork; /**< runs vme4l_irq_thread() */
+
+	spinlock_t			lockState;	/**< spin lock for handle state */
+	int refCounter;		/**< number of registered clients */
+};
+
+/*--------------------------------------+
+|   GLOBALS                             |
++--------------------------------------*/
+static VME4L_BRIDGE_HANDLE G_simBh;
+
+static int debug = DEBUG_DEFAULT;  /**< enable debug printouts */
+
+module_param(debug, int, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(debug, "Enable debugging printouts (default " \
+			M_INT_TO_STR(DEBUG_DEFAULT) ")");
+
+static unsigned long a24_size = 0x100000;
+module_param(a24_size, ulong, S_IRUGO);
+MODULE_PARM_DESC(a24_size, "RAM backing A24 space in bytes (default 1MB)");
+
+static unsigned long a32_size = 0x400000;
+module_param(a32_size, ulong, S_IRUGO);
+MODULE_PARM_DESC(a32_size, "RAM backing A32 space in bytes (default 4MB, "
+				 "must be allocatable as contiguous pages)");
+
+static unsigned int dma_mbps = 0;
+module_param(dma_mbps, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(dma_mbps, "Simulated DMA bandwidth in MB/s (0=unlimited)");
+
+static unsigned int dma_latency_us = 0;
+module_param(dma_latency_us, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(dma_latency_us, "Simulated DMA setup time per chain in us");
+
+static unsigned int irq_latency_us = 0;
+module_param(irq_latency_us, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(irq_latency_us, "Delay between interrupt request and "
+				 "interrupt handler in us");
+
+static unsigned int irq_period_us = 0;
+module_param(irq_period_us, uint, S_IRUGO);
+MODULE_PARM_DESC(irq_period_us, "Raise a VME interrupt every irq_period_us "
+				 "(0=off)");
+
+static int irq_level = VME4L_IRQLEV_1;
+module_param(irq_level, int, S_IRUGO);
+MODULE_PARM_DESC(irq_level, "VME level of periodic interrupt (default 1)");
+
+static int irq_vector = 0x10;
+module_param(irq_vector, int, S_IRUGO);
+MODULE_PARM_DESC(irq_vector, "VME vector of periodic interrupt "
+				 "(default 0x10)");
+
+static unsigned int berr_every = 0;
+module_param(berr_every, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(berr_every, "Fail every n-th master access or DMA with "
+				 "a bus error (0=never)");
+
+#define	SIM_LOCK_STATE_IRQ(ps)		spin_lock_irqsave( &h->lockState, ps )
+#define	SIM_UNLOCK_STATE_IRQ(ps)	spin_unlock_irqrestore( &h->lockState, ps )
+
+/***********************************************************************/
+/** Get RAM that backs a VME4L master space
+ *
+ * \param h			bridge handle
+ * \param spc		VME4L space number
+ * \return RAM, or NULL if space is not simulated
+ */
+static VME4L_SIM_RAM *Sim_SpaceRam( VME4L_BRIDGE_HANDLE *h, VME4L_SPACE spc )
+{
+	switch( spc ){
+	case VME4L_SPC_A16_D16:
+	case VME4L_SPC_A16_D32:
+		return &h->ram[SIM_RAM_A16];
+	case VME4L_SPC_A24_D16:
+	case VME4L_SPC_A24_D16_BLT:
+	case VME4L_SPC_A24_D32:
+	case VME4L_SPC_A24_D32_BLT:
+	case VME4L_SPC_A24_D64_BLT:
+		return &h->ram[SIM_RAM_A24];
+	case VME4L_SPC_A32_D32:
+	case VME4L_SPC_A32_D32_BLT:
+	case VME4L_SPC_A32_D64_BLT:
+		return &h->ram[SIM_RAM_A32];
+	default:
+		return NULL;
+	}
+}
+
+/***********************************************************************/
+/** Raise interrupt delivery
+ *
+ * Arms the irq timer unless it is already armed. Pending interrupt
+ * sources must have been latched before.
+ *
+ * \param h			bridge handle
+ */
+static void Sim_IrqRaise( VME4L_BRIDGE_HANDLE *h )
+{
+	if( h->shutdown || hrtimer_is_queued( &h->irqTimer ) )
+		return;
+
+	hrtimer_start( &h->irqTimer,
+				   ns_to_ktime( (uint64_t)irq_latency_us * NSEC_PER_USEC ),
+				   HRTIMER_MODE_REL );
+}
+
+/***********************************************************************/
+/** Check if next master access shall fail with a bus error
+ *
+ * \param h			bridge handle
+ * \return true if bus error
+ */
+static int Sim_BusErrorDue( VME4L_BRIDGE_HANDLE *h )
+{
+	unsigned int every = berr_every;
+
+	return every && (atomic_inc_return( &h->berrCount ) % every) == 0;
+}
+
+/***********************************************************************/
+/** Record a bus error and raise the bus error interrupt
+ *
+ * \param h			bridge handle
+ * \param vmeAddr	failing VME address (0 if unknown)
+ */
+static void Sim_BusError( VME4L_BRIDGE_HANDLE *h, vmeaddr_t vmeAddr )
+{
+	unsigned long ps;
+
+	SIM_LOCK_STATE_IRQ( ps );
+	h->berrAddr = vmeAddr;
+	h->berrAttr = 1;
+	h->berrPend = 1;
+	Sim_IrqRaise( h );
+	SIM_UNLOCK_STATE_IRQ( ps );
+}
+
+/***********************************************************************/
+/** Latch a VME interrupt
+ *
+ * Like a ROAK interrupter, a level can hold one interrupt only. Must be
+ * called with the state lock held.
+ *
+ * \param h			bridge handle
+ * \param level		VME level 1..7
+ * \param vector	VME vector
+ * \return 0 on success, -EBUSY if level is already pending
+ */
+static int Sim_VmeIrqLatch( VME4L_BRIDGE_HANDLE *h, int level, int vector )
+{
+	if( h->levPend & (1 << level) )
+		return -EBUSY;
+
+	h->levPend |= 1 << level;
+	h->levVector[level] = vector;
+	if( h->levEnbl & (1 << level) )
+		Sim_IrqRaise( h );
+	return 0;
+}
+
+/***********************************************************************/
+/** Get next interrupt source (interrupt acknowledge)
+ *
+ * DMA finished is served first, then bus errors, then the highest
+ * enabled VME level.
+ *
+ * \param h			bridge handle
+ * \param levelP	(OUT) VME4L irq level
+ * \param vectorP	(OUT) vector
+ * \return true if an interrupt was pending
+ */
+static int Sim_IrqAck( VME4L_BRIDGE_HANDLE *h, int *levelP, int *vectorP )
+{
+	uint32_t pend;
+	int level, ch;
+	int rv = 1;
+
+	spin_lock( &h->lockState );
+
+	pend = h->levPend & h->levEnbl;
+
+	if( h->dmaPend ){
+		ch = ffs( h->dmaPend ) - 1;
+		h->dmaPend &= ~(1 << ch);
+		*levelP = VME4L_IRQLEV_DMAFINISHED;
+		*vectorP = ch;
+	}
+	else if( h->berrPend && (h->levEnbl & (1 << VME4L_IRQLEV_BUSERR)) ){
+		h->berrPend = 0;
+		*levelP = VME4L_IRQLEV_BUSERR;
+		*vectorP = VME4L_IRQVEC_BUSERR;
+	}
+	else if( pend ){
+		level = fls( pend ) - 1;
+		h->levPend &= ~(1 << level);
+		if( h->genLevel == level )
+			h->genLevel = 0;
+		*levelP = level;
+		*vectorP = h->levVector[level];
+	}
+	else
+		rv = 0;
+
+	spin_unlock( &h->lockState );
+	return rv;
+}
+
+/***********************************************************************/
+/** Simulated bridge interrupt (hrtimer, hard irq context)
+ *
+ * Serves up to VME4L_IRQ_BUDGET sources, fires again immediately if
+ * more are pending.
+ */
+static enum hrtimer_restart Sim_IrqHandler( struct hrtimer *timer )
+{
+	VME4L_BRIDGE_HANDLE *h = container_of( timer, VME4L_BRIDGE_HANDLE,
+										   irqTimer );
+	int level, vector, pass;
+	int handled = 0;
+
+	vme4l_irq_entry();
+
+	for( pass = 0; pass < VME4L_IRQ_BUDGET; pass++ ){
+		if( h->shutdown || !Sim_IrqAck( h, &level, &vector ) )
+			break;
+
+		VME4LDBG( "vme4l_sim: irq level=%d vector=%d\n", level, vector );
+		vme4l_irq( level, vector, NULL );
+		handled++;
+	}
+
+	if( !handled )
+		vme4l_irq_none();
+	else if( vme4l_irq_done() == IRQ_WAKE_THREAD )
+		schedule_work( &h->irqThreadWork );
+
+	/* budget exhausted, come back for the rest */
+	if( pass == VME4L_IRQ_BUDGET && !h->shutdown ){
+		hrtimer_set_expires( timer, ktime_get() );
+		return HRTIMER_RESTART;
+	}
+	return HRTIMER_NORESTART;
+}
+
+/***********************************************************************/
+/** Bottom half of simulated interrupt
+ */
+static void Sim_IrqThreadWork( struct work_struct *work )
+{
+	VME4L_BRIDGE_HANDLE *h = container_of( work, VME4L_BRIDGE_HANDLE,
+										   irqThreadWork );
+
+	vme4l_irq_thread( 0, h );
+}
+
+/***********************************************************************/
+/** Periodic VME interrupt (irq_period_us)
+ */
+static enum hrtimer_restart Sim_GenTimer( struct hrtimer *timer )
+{
+	VME4L_BRIDGE_HANDLE *h = container_of( timer, VME4L_BRIDGE_HANDLE,
+										   genTimer );
+
+	spin_lock( &h->lockState );
+	Sim_VmeIrqLatch( h, irq_level, irq_vector );
+	spin_unlock( &h->lockState );
+
+	hrtimer_forward_now( timer,
+						 ns_to_ktime( (uint64_t)irq_period_us * NSEC_PER_USEC ));
+	return HRTIMER_RESTART;
+}
+
+/***********************************************************************/
+/** Copy one DMA chain between RAM and scatter list
+ *
+ * \param d			scatter list
+ * \param bytesP	(OUT) number of bytes copied
+ * \return 0 on success, -EIO on bus error
+ */
+static int Sim_DmaCopy( VME4L_SIM_DMA_DESC *d, size_t *bytesP )
+{
+	vmeaddr_t vmeAddr = d->vmeAddr;
+	size_t len, n;
+	uint64_t pa;
+	char *va;
+	int i;
+
+	*bytesP = 0;
+
+	for( i=0; i<d->nElems; i++ ){
+		pa  = d->sgList[i].dmaAddress;
+		len = d->sgList[i].dmaLength;
+
+		if( vmeAddr + len > d->ram->size ){
+			Sim_BusError( &G_simBh,
+						  vmeAddr < d->ram->size ? d->ram->size : vmeAddr );
+			return -EIO;
+		}
+
+		/* scatter element may span several (high mem) pages */
+		while( len ){
+			n = min_t( size_t, len, PAGE_SIZE - (pa & ~PAGE_MASK) );
+			va = SIM_KMAP( pfn_to_page( pa >> PAGE_SHIFT ) );
+
+			if( d->direction )
+				memcpy( (char *)d->ram->vaddr + vmeAddr,
+						va + (pa & ~PAGE_MASK), n );
+			else
+				memcpy( va + (pa & ~PAGE_MASK),
+						(char *)d->ram->vaddr + vmeAddr, n );
+
+			SIM_KUNMAP( va );
+			pa 		+= n;
+			vmeAddr += n;
+			len 	-= n;
+			*bytesP += n;
+		}
+	}
+	return 0;
+}
+
+/***********************************************************************/
+/** DMA engine of one channel
+ *
+ * Performs the transfer started by dmaStart, waits until the simulated
+ * transfer time is over and raises the DMA finished interrupt.
+ */
+static int Sim_DmaThread( void *arg )
+{
+	VME4L_SIM_DMA *dma = arg;
+	VME4L_BRIDGE_HANDLE *h = &G_simBh;
+	unsigned long ps;
+	ktime_t due;
+	size_t bytes;
+	uint64_t ns;
+	int rv;
+
+	while( !kthread_should_stop() ){
+		wait_event_interruptible( dma->wq,
+								  dma->state == SIM_DMA_RUNNING ||
+								  kthread_should_stop() );
+		if( dma->state != SIM_DMA_RUNNING )
+			continue;
+
+		due = ktime_get();
+
+		if( Sim_BusErrorDue( h ) ){
+			Sim_BusError( h, dma->desc[dma->descIdx].vmeAddr );
+			rv = -EIO;
+			bytes = 0;
+		}
+		else
+			rv = Sim_DmaCopy( &dma->desc[dma->descIdx], &bytes );
+
+		/* simulated transfer time */
+		ns = (uint64_t)dma_latency_us * NSEC_PER_USEC;
+		if( dma_mbps )
+			ns += div_u64( (uint64_t)bytes * 1000, dma_mbps );
+		due = ktime_add_ns( due, ns );
+
+		if( ktime_to_ns( ktime_sub( due, ktime_get() )) > 0 ){
+			set_current_state( TASK_UNINTERRUPTIBLE );
+			schedule_hrtimeout( &due, HRTIMER_MODE_ABS );
+		}
+
+		SIM_LOCK_STATE_IRQ( ps );
+		/* don't report a DMA that was stopped meanwhile */
+		if( dma->state == SIM_DMA_RUNNING ){
+			dma->state = rv ? SIM_DMA_ERROR : SIM_DMA_IDLE;
+			h->dmaPend |= 1 << dma->ch;
+			Sim_IrqRaise( h );
+		}
+		SIM_UNLOCK_STATE_IRQ( ps );
+	}
+	return 0;
+}
+
+/***********************************************************************/
+/** Write scatter list into DMA descriptor area
+ *
+ * \sa dmaSetup
+ */
+static int Sim_DmaDescWrite(
+	VME4L_BRIDGE_HANDLE *h,
+	int ch,
+	int idx,
+	VME4L_SPACE spc,
+	VME4L_SCATTER_ELEM *sgList,
+	int sgNelems,
+	int direction,
+	vmeaddr_t *vmeAddr)
+{
+	VME4L_SIM_DMA_DESC *d = &h->dma[ch].desc[idx];
+	int i;
+
+	if( (d->ram = Sim_SpaceRam( h, spc )) == NULL )
+		return -EINVAL;
+
+	if( sgNelems > SIM_DMA_ELEMS )
+		sgNelems = SIM_DMA_ELEMS;
+
+	d->vmeAddr 	 = *vmeAddr;
+	d->direction = direction;
+	d->nElems 	 = sgNelems;
+
+	for( i=0; i<sgNelems; i++ ){
+		d->sgList[i] = sgList[i];
+		*vmeAddr += sgList[i].dmaLength;
+	}
+	return sgNelems;
+}
+
+/***********************************************************************/
+/** Setup DMA scatter list
+ *
+ * \sa dmaSetup
+ */
+static int Sim_DmaSetup(
+	VME4L_BRIDGE_HANDLE *h,
+	int ch,
+	VME4L_SPACE spc,
+	VME4L_SCATTER_ELEM *sgList,
+	int sgNelems,
+	int direction,
+	int swapMode,
+	vmeaddr_t *vmeAddr,
+	int flags)
+{
+	return Sim_DmaDescWrite( h, ch, h->dma[ch].descIdx, spc, sgList,
+							 sgNelems, direction, vmeAddr );
+}
+
+/***********************************************************************/
+/** Setup next DMA scatter list while DMA is running
+ *
+ * \sa dmaSetupNext
+ */
+static int Sim_DmaSetupNext(
+	VME4L_BRIDGE_HANDLE *h,
+	int ch,
+	VME4L_SPACE spc,
+	VME4L_SCATTER_ELEM *sgList,
+	int sgNelems,
+	int direction,
+	int swapMode,
+	vmeaddr_t *vmeAddr,
+	int flags)
+{
+	return Sim_DmaDescWrite( h, ch,
+							 (h->dma[ch].descIdx + 1) % SIM_DMA_DESC_AREAS,
+							 spc, sgList, sgNelems, direction, vmeAddr );
+}
+
+/***********************************************************************/
+/** Start DMA
+ *
+ * \sa dmaStart
+ */
+static int Sim_DmaStart( VME4L_BRIDGE_HANDLE *h, int ch )
+{
+	VME4L_SIM_DMA *dma = &h->dma[ch];
+	unsigned long ps;
+	int rv = 0;
+
+	SIM_LOCK_STATE_IRQ( ps );
+	if( dma->state == SIM_DMA_RUNNING )
+		rv = -EBUSY;
+	else
+		dma->state = SIM_DMA_RUNNING;
+	SIM_UNLOCK_STATE_IRQ( ps );
+
+	if( rv == 0 )
+		wake_up( &dma->wq );
+	return rv;
+}
+
+/***********************************************************************/
+/** Start DMA with scatter list setup by dmaSetupNext
+ *
+ * \sa dmaStartNext
+ */
+static int Sim_DmaStartNext( VME4L_BRIDGE_HANDLE *h, int ch )
+{
+	VME4L_SIM_DMA *dma = &h->dma[ch];
+
+	/* previous chain must have finished ok */
+	if( dma->state == SIM_DMA_ERROR )
+		return -EIO;
+
+	dma->descIdx = (dma->descIdx + 1) % SIM_DMA_DESC_AREAS;
+	return Sim_DmaStart( h, ch );
+}
+
+/***********************************************************************/
+/** Stop DMA
+ *
+ * \sa dmaStop
+ */
+static int Sim_DmaStop( VME4L_BRIDGE_HANDLE *h, int ch )
+{
+	unsigned long ps;
+
+	SIM_LOCK_STATE_IRQ( ps );
+	h->dma[ch].state = SIM_DMA_IDLE;
+	h->dmaPend &= ~(1 << ch);
+	SIM_UNLOCK_STATE_IRQ( ps );
+	return 0;
+}
+
+/***********************************************************************/
+/** Get DMA status
+ *
+ * \sa dmaStatus
+ */
+static int Sim_DmaStatus( VME4L_BRIDGE_HANDLE *h, int ch )
+{
+	switch( READ_ONCE( h->dma[ch].state ) ){
+	case SIM_DMA_RUNNING:	return 1;
+	case SIM_DMA_ERROR:		return -EIO;
+	default:				return 0;
+	}
+}
+
+/***********************************************************************/
+/** Get number of DMA channels
+ *
+ * \sa dmaChannelsGet
+ */
+static int Sim_DmaChannelsGet( VME4L_BRIDGE_HANDLE *h )
+{
+	return SIM_DMA_CHANNELS;
+}
+
+/***********************************************************************/
+/** Get max. number of bytes of one DMA scatter element
+ *
+ * \sa dmaSegMaxGet
+ */
+static uint32_t Sim_DmaSegMaxGet( VME4L_BRIDGE_HANDLE *h )
+{
+	return SIM_DMA_SEG_MAX;
+}
+
+/***********************************************************************/
+/** Get device scatter lists are mapped for
+ *
+ * \sa dmaDevGet
+ */
+static struct device *Sim_DmaDevGet( VME4L_BRIDGE_HANDLE *h )
+{
+	return &h->pdev->dev;
+}
+
+/***********************************************************************/
+/** Request VME master address window
+ *
+ * The window always covers the whole RAM of the space.
+ *
+ * \sa requestAddrWindow
+ */
+static int Sim_RequestAddrWindow(
+	VME4L_BRIDGE_HANDLE *h,
+	VME4L_SPACE spc,
+	vmeaddr_t *vmeAddrP,
+	size_t *sizeP,
+	void **physAddrP,
+	int flags,
+	void **bDrvDataP)
+{
+	VME4L_SIM_RAM *ram = Sim_SpaceRam( h, spc );
+
+	if( ram == NULL )
+		return -EINVAL;
+
+	if( *vmeAddrP + *sizeP > ram->size ){
+		VME4LDBG( "vme4l_sim: %s 0x%llx (0x%llx) not backed by RAM\n",
+				  ram->name, (uint64_t)*vmeAddrP, (uint64_t)*sizeP );
+		return -EINVAL;
+	}
+
+	*vmeAddrP 	= 0;
+	*sizeP 		= ram->size;
+	*physAddrP 	= (void *)(uintptr_t)virt_to_phys( ram->vaddr );
+	*bDrvDataP 	= ram;
+	return 0;
+}
+
+/***********************************************************************/
+/** Release VME master address window
+ *
+ * \sa releaseAddrWindow
+ */
+static int Sim_ReleaseAddrWindow(
+	VME4L_BRIDGE_HANDLE *h,
+	VME4L_SPACE spc,
+	vmeaddr_t vmeAddr,
+	size_t size,
+	int flags,
+	void *bDrvData)
+{
+	return 0;
+}
+
+/***********************************************************************/
+/** Setup VME slave window
+ *
+ * Slave windows alias the RAM of the master space: SLV0 is A16, SLV3 is
+ * A24 and SLV4 is A32 (same assignment as on TSI148).
+ *
+ * \sa slaveWindowCtrl
+ */
+static int Sim_SlaveWindowCtrl(
+	VME4L_BRIDGE_HANDLE *h,
+	VME4L_SPACE spc,
+	vmeaddr_t vmeAddr,
+	size_t size,
+	void **physAddrP,
+	void **bDrvDataP)
+{
+	VME4L_SIM_RAM *ram;
+
+	switch( spc ){
+	case VME4L_SPC_SLV0:	ram = &h->ram[SIM_RAM_A16]; break;
+	case VME4L_SPC_SLV3:	ram = &h->ram[SIM_RAM_A24]; break;
+	case VME4L_SPC_SLV4:	ram = &h->ram[SIM_RAM_A32]; break;
+	default:				return -ENOTTY;
+	}
+
+	if( size == 0 )
+		return 0;
+
+	if( (vmeAddr & ~PAGE_MASK) || vmeAddr + size > ram->size )
+		return -EINVAL;
+
+	*physAddrP = (void *)(uintptr_t)(virt_to_phys( ram->vaddr ) + vmeAddr);
+	*bDrvDataP = ram;
+	return 0;
+}
+
+/***********************************************************************/
+/** Read/write PIO functions
+ *
+ * \sa readPio8, writePio8
+ */
+#define SIM_PIO_XX(size,type) \
+static int Sim_ReadPio##size ( \
+	VME4L_BRIDGE_HANDLE *h,\
+	void *vaddr,\
+	type *dataP,\
+	int flags,\
+	void *bDrvData)\
+{\
+	if( Sim_BusErrorDue( h ) ){\
+		*dataP = (type)~0;\
+		Sim_BusError( h, 0 );\
+		return -EIO;\
+	}\
+	*dataP = SIM_RAW_READ##size( (void __iomem *)vaddr );\
+	return 0;\
+}\
+static int Sim_WritePio##size ( \
+	VME4L_BRIDGE_HANDLE *h,\
+	void *vaddr,\
+	type *dataP,\
+	int flags,\
+	void *bDrvData)\
+{\
+	if( Sim_BusErrorDue( h ) ){\
+		Sim_BusError( h, 0 );\
+		return -EIO;\
+	}\
+	SIM_RAW_WRITE##size( *dataP, (void __iomem *)vaddr );\
+	return 0;\
+}
+
+SIM_PIO_XX(  8, uint8_t  )
+SIM_PIO_XX( 16, uint16_t )
+SIM_PIO_XX( 32, uint32_t )
+
+/***********************************************************************/
+/** Read block from master window
+ *
+ * \sa readPioBlock
+ */
+static int Sim_ReadPioBlock(
+	VME4L_BRIDGE_HANDLE *h,
+	void *vaddr,
+	void *dataP,
+	size_t size,
+	int accWidth,
+	int flags,
+	void *bDrvData)
+{
+	if( Sim_BusErrorDue( h ) ){
+		Sim_BusError( h, 0 );
+		return -EIO;
+	}
+	memcpy_fromio( dataP, (void __iomem *)vaddr, size );
+	return 0;
+}
+
+/***********************************************************************/
+/** Write block to master window
+ *
+ * \sa writePioBlock
+ */
+static int Sim_WritePioBlock(
+	VME4L_BRIDGE_HANDLE *h,
+	void *vaddr,
+	void *dataP,
+	size_t size,
+	int accWidth,
+	int flags,
+	void *bDrvData)
+{
+	if( Sim_BusErrorDue( h ) ){
+		Sim_BusError( h, 0 );
+		return -EIO;
+	}
+	memcpy_toio( (void __iomem *)vaddr, dataP, size );
+	return 0;
+}
+
+/***********************************************************************/
+/** Turn on/off VME irq level or special level
+ *
+ * \sa irqLevelCtrl
+ */
+static int Sim_IrqLevelCtrl(
+	VME4L_BRIDGE_HANDLE *h,
+	int level,
+	int set )
+{
+	unsigned long ps;
+
+	if( level < VME4L_IRQLEV_1 || level > VME4L_IRQLEV_BUSERR )
+		return -EINVAL;
+
+	VME4LDBG( "vme4l_sim: %sable level %d IRQ\n", set ? "en":"dis", level );
+
+	SIM_LOCK_STATE_IRQ( ps );
+	if( set ){
+		h->levEnbl |= 1 << level;
+		if( (h->levPend & (1 << level)) ||
+			(level == VME4L_IRQLEV_BUSERR && h->berrPend) )
+			Sim_IrqRaise( h );
+	}
+	else
+		h->levEnbl &= ~(1 << level);
+	SIM_UNLOCK_STATE_IRQ( ps );
+
+	return 0;
+}
+
+/***********************************************************************/
+/** Generate a VMEbus interrupt
+ *
+ * The interrupt is looped back to the own interrupt handler.
+ *
+ * \sa irqGenerate
+ */
+static int Sim_IrqGenerate(
+	VME4L_BRIDGE_HANDLE *h,
+	int level,
+	int vector)
+{
+	unsigned long ps;
+	int rv;
+
+	if( level < VME4L_IRQLEV_1 || level > VME4L_IRQLEV_7 ||
+		vector < 0 || vector > 0xff )
+		return -EINVAL;
+
+	SIM_LOCK_STATE_IRQ( ps );
+	if( h->genLevel )
+		rv = -EBUSY;
+	else if( (rv = Sim_VmeIrqLatch( h, level, vector )) == 0 ){
+		h->genLevel = level;
+		rv = SIM_INTERRUPTER_ID;
+	}
+	SIM_UNLOCK_STATE_IRQ( ps );
+
+	return rv;
+}
+
+/***********************************************************************/
+/** Check if generated interrupt has been acknowledged
+ *
+ * \sa irqGenAcked
+ */
+static int Sim_IrqGenAcked( VME4L_BRIDGE_HANDLE *h, int id )
+{
+	if( id != SIM_INTERRUPTER_ID )
+		return -EINVAL;
+
+	return READ_ONCE( h->genLevel ) ? 0 : 1;
+}
+
+/***********************************************************************/
+/** Clear pending interrupter
+ *
+ * \sa irqGenClear
+ */
+static int Sim_IrqGenClear( VME4L_BRIDGE_HANDLE *h, int id )
+{
+	unsigned long ps;
+
+	if( id != SIM_INTERRUPTER_ID )
+		return -EINVAL;
+
+	SIM_LOCK_STATE_IRQ( ps );
+	if( h->genLevel ){
+		h->levPend &= ~(1 << h->genLevel);
+		h->genLevel = 0;
+	}
+	SIM_UNLOCK_STATE_IRQ( ps );
+
+	return 0;
+}
+
+/***********************************************************************/
+/** Get information about last VME bus error
+ *
+ * The address of PIO bus errors is not known and reported as 0.
+ *
+ * \sa busErrGet
+ */
+static int Sim_BusErrGet(
+	VME4L_BRIDGE_HANDLE *h,
+	int *attrP,
+	vmeaddr_t *addrP,
+	int clear )
+{
+	unsigned long ps;
+	int rv = 0;
+
+	SIM_LOCK_STATE_IRQ( ps );
+	if( h->berrAttr ){
+		rv = 1;
+		*addrP = h->berrAddr;
+	}
+	if( clear )
+		h->berrAttr = 0;
+	SIM_UNLOCK_STATE_IRQ( ps );
+
+	return rv;
+}
+
+/***********************************************************************/
+/** Simulated bridge is always system controller
+ *
+ * \sa sysCtrlFuncGet
+ */
+static int Sim_SysCtrlFuncGet( VME4L_BRIDGE_HANDLE *h )
+{
+	return 1;
+}
+
+/***********************************************************************/
+/** Get bridge driver info string
+ */
+static void Sim_RevisionInfo( VME4L_BRIDGE_HANDLE *h, char *buf )
+{
+	sprintf( buf, "VME4L bridge simulator, RAM A16=%zuk A24=%zuk A32=%zuk",
+			 h->ram[SIM_RAM_A16].size >> 10, h->ram[SIM_RAM_A24].size >> 10,
+			 h->ram[SIM_RAM_A32].size >> 10 );
+}
+
+static const VME4L_BRIDGE_DRV_EXT G_simDrvExt = {
+	.dmaSetupNext		= Sim_DmaSetupNext,
+	.dmaStartNext		= Sim_DmaStartNext,
+	.dmaChannelsGet		= Sim_DmaChannelsGet,
+	.dmaSegMaxGet		= Sim_DmaSegMaxGet,
+	.dmaDevGet			= Sim_DmaDevGet,
+	.readPioBlock		= Sim_ReadPioBlock,
+	.writePioBlock		= Sim_WritePioBlock,
+};/* G_simDrvExt */
+
+static VME4L_BRIDGE_DRV G_simDrv = {
+	.revisionInfo		= Sim_RevisionInfo,
+	.requestAddrWindow 	= Sim_RequestAddrWindow,
+	.releaseAddrWindow 	= Sim_ReleaseAddrWindow,
+	.irqLevelCtrl		= Sim_IrqLevelCtrl,
+	.readPio8			= Sim_ReadPio8,
+	.readPio16			= Sim_ReadPio16,
+	.readPio32			= Sim_ReadPio32,
+	.writePio8			= Sim_WritePio8,
+	.writePio16			= Sim_WritePio16,
+	.writePio32			= Sim_WritePio32,
+	.dmaSetup			= Sim_DmaSetup,
+	.dmaStart			= Sim_DmaStart,
+	.dmaStop			= Sim_DmaStop,
+	.dmaStatus			= Sim_DmaStatus,
+	.irqGenerate		= Sim_IrqGenerate,
+	.irqGenAcked		= Sim_IrqGenAcked,
+	.irqGenClear		= Sim_IrqGenClear,
+	.sysCtrlFuncGet		= Sim_SysCtrlFuncGet,
+	.busErrGet			= Sim_BusErrGet,
+	.slaveWindowCtrl	= Sim_SlaveWindowCtrl,
+	.ext				= &G_simDrvExt,
+};/* G_simDrv */
+
+/***********************************************************************/
+/** Allocate RAM of a VME space
+ *
+ * Pages are marked reserved, so they can be ioremapped and mmapped like
+ * bridge memory.
+ *
+ * \return 0 on success, or negative error number
+ */
+static int Sim_RamAlloc( VME4L_SIM_RAM *ram, const char *name, size_t size )
+{
+	struct page *page, *pend;
+
+	ram->name  = name;
+	ram->size  = PAGE_ALIGN( size );
+	ram->order = get_order( ram->size );
+	ram->vaddr = (void *)__get_free_pages( GFP_KERNEL | __GFP_ZERO,
+										   ram->order );
+	if( ram->vaddr == NULL ){
+		printk( KERN_ERR_PFX "cannot allocate %zu bytes for %s\n",
+				ram->size, name );
+		return -ENOMEM;
+	}
+
+	pend = virt_to_page( ram->vaddr + (PAGE_SIZE << ram->order) - 1 );
+	for( page = virt_to_page( ram->vaddr ); page <= pend; page++ )
+		SetPageReserved( page );
+
+	return 0;
+}
+
+/***********************************************************************/
+/** Free RAM of a VME space
+ */
+static void Sim_RamFree( VME4L_SIM_RAM *ram )
+{
+	struct page *page, *pend;
+
+	if( ram->vaddr == NULL )
+		return;
+
+	pend = virt_to_page( ram->vaddr + (PAGE_SIZE << ram->order) - 1 );
+	for( page = virt_to_page( ram->vaddr ); page <= pend; page++ )
+		ClearPageReserved( page );
+
+	free_pages( (unsigned long)ram->vaddr, ram->order );
+	ram->vaddr = NULL;
+}
+
+/***********************************************************************/
+/** Stop interrupts and DMA engines
+ */
+static void Sim_Stop( VME4L_BRIDGE_HANDLE *h )
+{
+	unsigned long ps;
+	int i;
+
+	hrtimer_cancel( &h->genTimer );
+
+	SIM_LOCK_STATE_IRQ( ps );
+	h->shutdown = 1;
+	SIM_UNLOCK_STATE_IRQ( ps );
+
+	for( i=0; i<SIM_DMA_CHANNELS; i++ )
+		if( h->dma[i].thread )
+			kthread_stop( h->dma[i].thread );
+
+	hrtimer_cancel( &h->irqTimer );
+	cancel_work_sync( &h->irqThreadWork );
+}
+
+/***********************************************************************/
+/** Free device and RAM
+ */
+static void Sim_Free( VME4L_BRIDGE_HANDLE *h )
+{
+	int i;
+
+	if( h->pdev )
+		platform_device_unregister( h->pdev );
+
+	for( i=0; i<SIM_RAM_NUM; i++ )
+		Sim_RamFree( &h->ram[i] );
+}
+
+/*******************************************************************/
+/** Kernel module initialization function.
+ */
+static int __init sim_init_module( void )
+{
+	VME4L_BRIDGE_HANDLE *h = &G_simBh;
+	VME4L_SIM_DMA *dma;
+	int rv, i;
+
+	memset( h, 0, sizeof(*h) );
+	spin_lock_init( &h->lockState );
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,13,0)
+	hrtimer_setup( &h->irqTimer, Sim_IrqHandler, CLOCK_MONOTONIC,
+				   HRTIMER_MODE_REL );
+	hrtimer_setup( &h->genTimer, Sim_GenTimer, CLOCK_MONOTONIC,
+				   HRTIMER_MODE_REL );
+#else
+	hrtimer_init( &h->irqTimer, CLOCK_MONOTONIC, HRTIMER_MODE_REL );
+	h->irqTimer.function = Sim_IrqHandler;
+	hrtimer_init( &h->genTimer, CLOCK_MONOTONIC, HRTIMER_MODE_REL );
+	h->genTimer.function = Sim_GenTimer;
+#endif
+	INIT_WORK( &h->irqThreadWork, Sim_IrqThreadWork );
+
+	if( (rv = Sim_RamAlloc( &h->ram[SIM_RAM_A16], "A16", 0x10000 )) ||
+		(rv = Sim_RamAlloc( &h->ram[SIM_RAM_A24], "A24",
+							min( a24_size, 0x1000000UL ))) ||
+		(rv = Sim_RamAlloc( &h->ram[SIM_RAM_A32], "A32", a32_size )) )
+		goto CLEANUP;
+
+	/* device to map zero-copy DMA buffers for */
+	h->pdev = platform_device_register_simple( "vme4l-sim", -1, NULL, 0 );
+	if( IS_ERR( h->pdev ) ){
+		rv = PTR_ERR( h->pdev );
+		h->pdev = NULL;
+		goto CLEANUP;
+	}
+	h->pdev->dev.coherent_dma_mask = DMA_BIT_MASK(64);
+	h->pdev->dev.dma_mask = &h->pdev->dev.coherent_dma_mask;
+
+	for( i=0; i<SIM_DMA_CHANNELS; i++ ){
+		dma = &h->dma[i];
+		dma->ch = i;
+		init_waitqueue_head( &dma->wq );
+		dma->thread = kthread_run( Sim_DmaThread, dma, "vme4l-sim-dma%d", i );
+		if( IS_ERR( dma->thread ) ){
+			rv = PTR_ERR( dma->thread );
+			dma->thread = NULL;
+			goto CLEANUP;
+		}
+	}
+
+	if( (rv = vme4l_register_bridge_driver( &G_simDrv, h )) != 0 ){
+		printk( KERN_ERR_PFX "error registering bridge driver\n" );
+		goto CLEANUP;
+	}
+	vme4l_request_soft_irq();
+
+	if( irq_period_us &&
+		irq_level >= VME4L_IRQLEV_1 && irq_level <= VME4L_IRQLEV_7 )
+		hrtimer_start( &h->genTimer,
+					   ns_to_ktime( (uint64_t)irq_period_us * NSEC_PER_USEC ),
+					   HRTIMER_MODE_REL );
+
+	return 0;
+
+CLEANUP:
+	Sim_Stop( h );
+	Sim_Free( h );
+	return rv;
+}/* sim_init_module */
+
+/*******************************************************************/
+/** Kernel module clean-up function.
+ */
+static void __exit sim_cleanup_module( void )
+{
+	/* core unmaps its idle windows of the RAM when unregistering */
+	Sim_Stop( &G_simBh );
+	vme4l_free_soft_irq();
+	vme4l_unregister_bridge_driver();
+	Sim_Free( &G_simBh );
+}/* sim_cleanup_module */
+
+int vme4l_register_client( VME4L_BRIDGE_HANDLE *h )
+{
+	unsigned long ps;
+
+	SIM_LOCK_STATE_IRQ( ps );
+	++h->refCounter;
+	SIM_UNLOCK_STATE_IRQ( ps );
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(vme4l_register_client);
+
+int vme4l_unregister_client( VME4L_BRIDGE_HANDLE *h )
+{
+	unsigned long ps;
+	int rv = 0;
+
+	SIM_LOCK_STATE_IRQ( ps );
+	if( h->refCounter <= 0 )
+		rv = -EINVAL;
+	else
+		--h->refCounter;
+	SIM_UNLOCK_STATE_IRQ( ps );
+
+	return rv;
+}
+EXPORT_SYMBOL_GPL(vme4l_unregister_client);
+
+module_init(sim_init_module);
+module_exit(sim_cleanup_module);
+
+MODULE_DESCRIPTION("VME4L - VME bridge simulator");
+MODULE_LICENSE("GPL");
@@ -0,0 +1,262 @@
+/***********************  I n c l u d e  -  F i l e  ************************/
+/*!
+ *        \file  vme4l-trace.h
+ *
+ *  	 \brief  VME4L tracepoints for transfers, address windows and
+ *				 interrupts.
+ *
+ *				 Events appear under /sys/kernel/debug/tracing/events/vme4l
+ *				 and are usable with perf, trace-cmd or bpftrace. A disabled
+ *				 tracepoint costs a single patched branch.
+ *
+ *				 Included with CREATE_TRACE_POINTS by vme4l-core.c only.
+ *
+ *     Switches: -
+ */
+/*
+ *---------------------------------------------------------------------------
+ * Copyright (c) 2003-2019, MEN Mikro Elektronik GmbH
+ ******************************************************************************/
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM vme4l
+
+#if !defined(_VME4L_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _VME4L_TRACE_H
+
+#include <linux/tracepoint.h>
+
+/** read/write transfer finished (VME4L_IO_RW_BLOCK, read(), write()) */
+TRACE_EVENT(vme4l_rw,
+	TP_PROTO(int spc, int direction, vmeaddr_t vmeAddr, int accWidth,
+			 size_t size, int flags, int dma, int rv),
+	TP_ARGS(spc, direction, vmeAddr, accWidth, size, flags, dma, rv),
+
+	TP_STRUCT__entry(
+		__field(	int,		spc			)
+		__field(	int,		direction	)
+		__field(	u64,		vmeAddr		)
+		__field(	int,		accWidth	)
+		__field(	size_t,		size		)
+		__field(	int,		flags		)
+		__field(	int,		dma			)
+		__field(	int,		rv			)
+	),
+
+	TP_fast_assign(
+		__entry->spc		= spc;
+		__entry->direction	= direction;
+		__entry->vmeAddr	= vmeAddr;
+		__entry->accWidth	= accWidth;
+		__entry->size		= size;
+		__entry->flags		= flags;
+		__entry->dma		= dma;
+		__entry->rv			= rv;
+	),
+
+	TP_printk("spc=%d %s vme=0x%llx acc=%d size=0x%zx flags=0x%x %s rv=%d",
+			  __entry->spc, __entry->direction ? "write" : "read",
+			  (unsigned long long)__entry->vmeAddr, __entry->accWidth,
+			  __entry->size, __entry->flags,
+			  __entry->dma ? "dma" : "pio", __entry->rv)
+);
+
+/** descriptor chain set up by the bridge (dmaSetup/dmaSetupNext) */
+TRACE_EVENT(vme4l_dma_chunk,
+	TP_PROTO(int ch, int spc, int direction, vmeaddr_t vmeAddr,
+			 const VME4L_SCATTER_ELEM *sgList, int sgNelems),
+	TP_ARGS(ch, spc, direction, vmeAddr, sgList, sgNelems),
+
+	TP_STRUCT__entry(
+		__field(	int,		ch			)
+		__field(	int,		spc			)
+		__field(	int,		direction	)
+		__field(	u64,		vmeAddr		)
+		__field(	int,		sgNelems	)
+		__field(	u64,		bytes		)
+	),
+
+	TP_fast_assign(
+		int i;
+
+		__entry->ch			= ch;
+		__entry->spc		= spc;
+		__entry->direction	= direction;
+		__entry->vmeAddr	= vmeAddr;
+		__entry->sgNelems	= sgNelems;
+		__entry->bytes		= 0;
+		for( i=0; i<sgNelems; i++ )
+			__entry->bytes += sgList[i].dmaLength;
+	),
+
+	TP_printk("ch=%d spc=%d %s vme=0x%llx elems=%d bytes=%llu",
+			  __entry->ch, __entry->spc,
+			  __entry->direction ? "write" : "read",
+			  (unsigned long long)__entry->vmeAddr, __entry->sgNelems,
+			  (unsigned long long)__entry->bytes)
+);
+
+/** DMA channel started */
+TRACE_EVENT(vme4l_dma_start,
+	TP_PROTO(int ch),
+	TP_ARGS(ch),
+
+	TP_STRUCT__entry(
+		__field(	int,		ch			)
+	),
+
+	TP_fast_assign(
+		__entry->ch			= ch;
+	),
+
+	TP_printk("ch=%d", __entry->ch)
+);
+
+/** DMA channel finished, \a rv is the bridge status or -ETIME */
+TRACE_EVENT(vme4l_dma_complete,
+	TP_PROTO(int ch, int polled, int rv),
+	TP_ARGS(ch, polled, rv),
+
+	TP_STRUCT__entry(
+		__field(	int,		ch			)
+		__field(	int,		polled		)
+		__field(	int,		rv			)
+	),
+
+	TP_fast_assign(
+		__entry->ch			= ch;
+		__entry->polled		= polled;
+		__entry->rv			= rv;
+	),
+
+	TP_printk("ch=%d %s rv=%d", __entry->ch,
+			  __entry->polled ? "polled" : "irq", __entry->rv)
+);
+
+/** VME->PCI address window requested, \a hit if an existing one was used */
+TRACE_EVENT(vme4l_adrswin,
+	TP_PROTO(int spc, vmeaddr_t vmeAddr, size_t size, int flags, int hit,
+			 int rv),
+	TP_ARGS(spc, vmeAddr, size, flags, hit, rv),
+
+	TP_STRUCT__entry(
+		__field(	int,		spc			)
+		__field(	u64,		vmeAddr		)
+		__field(	size_t,		size		)
+		__field(	int,		flags		)
+		__field(	int,		hit			)
+		__field(	int,		rv			)
+	),
+
+	TP_fast_assign(
+		__entry->spc		= spc;
+		__entry->vmeAddr	= vmeAddr;
+		__entry->size		= size;
+		__entry->flags		= flags;
+		__entry->hit		= hit;
+		__entry->rv			= rv;
+	),
+
+	TP_printk("spc=%d vme=0x%llx size=0x%zx flags=0x%x %s rv=%d",
+			  __entry->spc, (unsigned long long)__entry->vmeAddr,
+			  __entry->size, __entry->flags,
+			  __entry->hit ? "hit" : "miss", __entry->rv)
+);
+
+DECLARE_EVENT_CLASS(vme4l_ioremap_class,
+	TP_PROTO(vmeaddr_t vmeAddr, size_t size, void *vaddr),
+	TP_ARGS(vmeAddr, size, vaddr),
+
+	TP_STRUCT__entry(
+		__field(	u64,		vmeAddr		)
+		__field(	size_t,		size		)
+		__field(	void *,		vaddr		)
+	),
+
+	TP_fast_assign(
+		__entry->vmeAddr	= vmeAddr;
+		__entry->size		= size;
+		__entry->vaddr		= vaddr;
+	),
+
+	TP_printk("vme=0x%llx size=0x%zx vaddr=%p",
+			  (unsigned long long)__entry->vmeAddr, __entry->size,
+			  __entry->vaddr)
+);
+
+/** ioremap region created, \a vaddr is NULL if ioremap failed */
+DEFINE_EVENT(vme4l_ioremap_class, vme4l_ioremap,
+	TP_PROTO(vmeaddr_t vmeAddr, size_t size, void *vaddr),
+	TP_ARGS(vmeAddr, size, vaddr)
+);
+
+/** ioremap region evicted or its window released */
+DEFINE_EVENT(vme4l_ioremap_class, vme4l_iounmap,
+	TP_PROTO(vmeaddr_t vmeAddr, size_t size, void *vaddr),
+	TP_ARGS(vmeAddr, size, vaddr)
+);
+
+/** interrupt reported by the bridge, \a deferred to the irq thread */
+TRACE_EVENT(vme4l_irq,
+	TP_PROTO(int level, int vector, int deferred),
+	TP_ARGS(level, vector, deferred),
+
+	TP_STRUCT__entry(
+		__field(	int,		level		)
+		__field(	int,		vector		)
+		__field(	int,		deferred	)
+	),
+
+	TP_fast_assign(
+		__entry->level		= level;
+		__entry->vector		= vector;
+		__entry->deferred	= deferred;
+	),
+
+	TP_printk("level=%d vector=0x%x%s", __entry->level, __entry->vector,
+			  __entry->deferred ? " deferred" : "")
+);
+
+/** handlers of a vector called, \a latNs since bridge irq entry (0=n/a) */
+TRACE_EVENT(vme4l_irq_dispatch,
+	TP_PROTO(int level, int vector, u64 latNs),
+	TP_ARGS(level, vector, latNs),
+
+	TP_STRUCT__entry(
+		__field(	int,		level		)
+		__field(	int,		vector		)
+		__field(	u64,		latNs		)
+	),
+
+	TP_fast_assign(
+		__entry->level		= level;
+		__entry->vector		= vector;
+		__entry->latNs		= latNs;
+	),
+
+	TP_printk("level=%d vector=0x%x lat=%lluns", __entry->level,
+			  __entry->vector, (unsigned long long)__entry->latNs)
+);
+
+#endif /* _VME4L_TRACE_H */
+
+/* must be outside the multi-read protection */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE vme4l-trace
+#include <trace/define_trace.h>
@@ -50,6 +50,22 @@
 
 #include "vme4l-tsi148.h"
 
+/** No. of independent DMA controllers */
+#define TSI148_DMA_CHANNELS		2
+
+/** No. of DMA linked-list descriptor buffers per channel. Two buffers
+    allow to prepare the next linked-list while the DMA is running */
+#define TSI148_DMA_DESC_AREAS	2
+
+/** max. bytes per DMA descriptor (32-bit DCNT register, page aligned) */
+#define TSI148_DMA_SEG_MAX		0x80000000
+
+/** align kernel memory slave windows for PMD mappings by vme4l-core */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,12,0) && \
+	defined(CONFIG_ARCH_SUPPORTS_PMD_PFNMAP)
+# define TSI148_SLV_PMD_ALIGN
+#endif
+
 /*-----------------------------+
 |  TYPEDEFS					   |
 +------------------------------*/
@@ -94,6 +110,9 @@ typedef	struct _VME4L_RESRC{
 	int				spc;		/**< VME space number */
 	int				memReq	:1;	/**< flag memory has been requested */
 	int				inUse	:1;	/**< flag resource is in use */
+	void *			memVaddr;	/**< allocated memory (if memReq) */
+	dma_addr_t		memPhys;	/**< phys. address of allocated memory */
+	size_t			memSize;	/**< size of allocated memory */
 } VME4L_RESRC;
 
 /**	bridge drivers private data	*/
@@ -105,12 +124,17 @@ typedef	struct {
 	VME4L_RESRC			vmeIn[TSI148_OUTBOUND_NO];
 	uint64_t			berrAddr;		/**< VME Exception Address */
 	uint32_t			berrAttr;		/**< VME Exception Attributes */
-	TSI148_DMA_LL_DESC 	*dmaDescBuf;	/**< virt addr of DMA descriptor
-											 buffer */
+	TSI148_DMA_LL_DESC 	*dmaDescBuf[TSI148_DMA_CHANNELS][TSI148_DMA_DESC_AREAS];
+										/**< virt addr of DMA descriptor
+											 buffers */
+	int					dmaDescIdx[TSI148_DMA_CHANNELS]; /**< DMA descriptor
+											 buffer used by dmaSetup/dmaStart */
 	char				pciRevision;	/**< PCI revision from cfg space */
 
 	spinlock_t			lockState;		/**< spin lock for VME bridge registers	
 											 and handle	state */
+	struct semaphore	slvSem;			/**< serializes slave window setup,
+											 protects vmeIn[] */
 	int refCounter;		/**< number of registered clients */
 } VME4L_BRIDGE_HANDLE;
 
@@ -244,6 +268,10 @@ static VME4L_BRIDGE_HANDLE *vme4l_bh;
 #define	TSI148_CTRL_CLRMASK( _reg, _mask ) \
 		TSI148_CTRL_WRITE( _reg, TSI148_CTRL_READ(_reg) & ~(_mask) )
 
+/** interrupt bit of DMA channel _ch */
+#define TSI148_INTEX_DMA( _ch ) \
+		( (_ch) ? TSI148_INTEX_DMA1 : TSI148_INTEX_DMA0 )
+
 
 /*--------------------------------------+
 |   GLOBALS                             |
@@ -582,7 +610,7 @@ static void Tsi148_InitBridge( void )
 
 /*******************************************************************/
 /** Get the interrupt with the highest priority
- * (since we only handle one interrupt at once)
+ * (sources are handled one by one in priority order)
  *
  * \param vme4l_bh \IN VME4L bridge handle
  * \param istat	   \IN Value of ISTAT
@@ -654,55 +682,25 @@ static inline void Tsi148_ProcessVmeInterrupt(
 }
 
 
-/***************************************************************************/
-/** Central HW dependent VME Interrupt handler, processing acknowledge flags
- *
- * \param irq		\IN PIC irq vector (not VME vector!)
- * \param dev_id	\IN device specific handle
- *
- * \return IRQ_NONE or IRQ_HANDLED
+/*******************************************************************/
+/** Decode one interrupt source
  *
- * \brief		This is the standard Linux kernel IRQ handler for VME
- *				bus devices. From here we dispatch everything to vme4l-core
+ * Performs IACK for VME interrupts and clears the source specific status.
+ * Call with lockState held.
  *
+ * \param vme4l_bh \IN  VME4L bridge handle
+ * \param istat    \IN  single INTS bit (already cleared in INTC)
+ * \param vecP	   \OUT VME4L vector
+ * \param levP	   \OUT VME4L level (unchanged if unknown source)
  */
-#if LINUX_VERSION_CODE < KERNEL_VERSION(2,6,19)
-static irqreturn_t Tsi148_IrqHandler( int irq, void *dev_id, struct pt_regs *regs )
-{
-#else
-static irqreturn_t Tsi148_IrqHandler( int irq, void *dev_id )
+static void Tsi148_DecodeIrq(
+	VME4L_BRIDGE_HANDLE *vme4l_bh,
+	uint32_t istat,
+	int *vecP,
+	int *levP )
 {
-	struct pt_regs *regs = NULL;
-#endif /*LINUX_VERSION_CODE < KERNEL_VERSION(2,6,19)*/
-
-	int vector=0;
-	int level=VME4L_IRQLEV_UNKNOWN;
-	VME4L_BRIDGE_HANDLE *vme4l_bh 	= (VME4L_BRIDGE_HANDLE *)dev_id;
-	uint32_t istat;
-
-	if( vme4l_bh != &G_vme4l_bh ){
-		printk( KERN_ERR "*** vme4l(%s): unexpected handle (0x%p!=0x%p)\n",
-				__FUNCTION__, vme4l_bh, &G_vme4l_bh );
-		return IRQ_NONE;
-	}
-	
-	TSI148_LOCK_STATE();
-	
-	/* read irq status reg */
-	istat = TSI148_CTRL_READ( lcsr.inteo );	/* ignore not enabled interrupts */
-	istat &= TSI148_CTRL_READ( lcsr.ints );
-
-	if( istat == 0 ) {
-		/* not our IRQ */
-		TSI148_UNLOCK_STATE();
-		return IRQ_NONE;
-	}
-
-	/* get IRQ with highest priority */
-	istat = Tsi148_GetIrqWithHighestPrio( vme4l_bh, istat );
-
-	/* clear chosen interrupt */
-	TSI148_CTRL_WRITE( lcsr.intc, istat );
+	int vector = *vecP;
+	int level = *levP;
 
 	/* pending VME interrupt (perform IACK) */
 	if( istat & TSI148_INTEX_IRQX_MASK ) {
@@ -710,9 +708,12 @@ static irqreturn_t Tsi148_IrqHandler( int irq, void *dev_id )
 	}
 	/* other IRQ causes (DMA/Mailbox/location monitor) */
 	else if ( istat & TSI148_INTEX_DMAX_MASK ) {
+		/* DMA channel is passed as vector */
+		vector = (istat & TSI148_INTEX_DMA1) ? 1 : 0;
+
 		/* disable DMA interrupt */
-		TSI148_CTRL_CLRMASK( lcsr.inteo, TSI148_INTEX_DMA0 );
-		TSI148_CTRL_CLRMASK( lcsr.inten, TSI148_INTEX_DMA0 );
+		TSI148_CTRL_CLRMASK( lcsr.inteo, TSI148_INTEX_DMA(vector) );
+		TSI148_CTRL_CLRMASK( lcsr.inten, TSI148_INTEX_DMA(vector) );
 		level = VME4L_IRQLEV_DMAFINISHED;
 	}
 	else if ( istat & TSI148_INTEX_LMX_MASK ) {
@@ -786,21 +787,93 @@ static irqreturn_t Tsi148_IrqHandler( int irq, void *dev_id )
 		}
 	}
 
-	TSI148_UNLOCK_STATE();
+	*vecP = vector;
+	*levP = level;
+}
 
-	VME4LDBG( "vme4l(%s): VME IRQ (level=0x%x vector=0x%x)\n", __FUNCTION__,
-			  level, vector );
 
-	if( level == VME4L_IRQLEV_UNKNOWN ) {
-		/* this should never happen */
-		printk( KERN_ERR "*** vme4l(%s): driver error\n", __FUNCTION__ );
+/***************************************************************************/
+/** Central HW dependent VME Interrupt handler, processing acknowledge flags
+ *
+ * Handles all pending sources, highest priority first, until INTS is
+ * empty or #VME4L_IRQ_BUDGET sources have been handled. Sources left
+ * over keep the (level triggered) PCI interrupt asserted.
+ *
+ * \param irq		\IN PIC irq vector (not VME vector!)
+ * \param dev_id	\IN device specific handle
+ *
+ * \return IRQ_NONE, IRQ_HANDLED or IRQ_WAKE_THREAD
+ *
+ * \brief		This is the standard Linux kernel IRQ handler for VME
+ *				bus devices. From here we dispatch everything to vme4l-core
+ *
+ */
+#if LINUX_VERSION_CODE < KERNEL_VERSION(2,6,19)
+static irqreturn_t Tsi148_IrqHandler( int irq, void *dev_id, struct pt_regs *regs )
+{
+#else
+static irqreturn_t Tsi148_IrqHandler( int irq, void *dev_id )
+{
+	struct pt_regs *regs = NULL;
+#endif /*LINUX_VERSION_CODE < KERNEL_VERSION(2,6,19)*/
+
+	int vector;
+	int level;
+	VME4L_BRIDGE_HANDLE *vme4l_bh 	= (VME4L_BRIDGE_HANDLE *)dev_id;
+	uint32_t istat;
+	int budget;
+	int handled = 0;
+
+	vme4l_irq_entry();
+
+	if( vme4l_bh != &G_vme4l_bh ){
+		printk( KERN_ERR "*** vme4l(%s): unexpected handle (0x%p!=0x%p)\n",
+				__FUNCTION__, vme4l_bh, &G_vme4l_bh );
 		return IRQ_NONE;
 	}
-	
-	/* call core IRQ handler */
-	vme4l_irq( level, vector, regs );
 
-	return IRQ_HANDLED;
+	for( budget = VME4L_IRQ_BUDGET; budget > 0; budget-- ) {
+		vector = 0;
+		level = VME4L_IRQLEV_UNKNOWN;
+
+		TSI148_LOCK_STATE();
+
+		/* read irq status reg */
+		istat = TSI148_CTRL_READ( lcsr.inteo );	/* ignore not enabled interrupts */
+		istat &= TSI148_CTRL_READ( lcsr.ints );
+
+		if( istat == 0 ) {
+			/* nothing (more) pending */
+			TSI148_UNLOCK_STATE();
+			break;
+		}
+
+		/* get IRQ with highest priority */
+		istat = Tsi148_GetIrqWithHighestPrio( vme4l_bh, istat );
+
+		/* clear chosen interrupt */
+		TSI148_CTRL_WRITE( lcsr.intc, istat );
+
+		Tsi148_DecodeIrq( vme4l_bh, istat, &vector, &level );
+
+		TSI148_UNLOCK_STATE();
+
+		VME4LDBG( "vme4l(%s): VME IRQ (level=0x%x vector=0x%x)\n", __FUNCTION__,
+				  level, vector );
+
+		handled++;
+
+		if( level == VME4L_IRQLEV_UNKNOWN ) {
+			/* this should never happen */
+			printk( KERN_ERR "*** vme4l(%s): driver error\n", __FUNCTION__ );
+			continue;
+		}
+
+		/* call core IRQ handler */
+		vme4l_irq( level, vector, regs );
+	}
+
+	return handled ? vme4l_irq_done() : vme4l_irq_none();
 }
 
 
@@ -1082,7 +1155,7 @@ static int Tsi148_InboundWinSet(
  * \param winSize   \IN size of Window
  * \param spc       \IN VME addr space
  *
- * \return TSI148_OK, or negativ error no.
+ * \return TSI148_OK, or negativ error no. (-EBUSY if out of PCI space)
  *
  */
 static int Tsi148_AllocOutbResource(
@@ -1115,6 +1188,8 @@ static int Tsi148_AllocOutbResource(
 
 		printk( KERN_ERR "*** vme4l(%s): failed to allocate PCI memory (size 0x%lx), check BIOS settings\n", __FUNCTION__, (long unsigned int)winSize );
 
+		/* core may free idle windows and retry */
+		rv = -EBUSY;
 		goto CLEANUP;
 	}
 
@@ -1216,7 +1291,7 @@ static int Tsi148_RequestAddrWindow(
 	VME4LDBG( "vme4l(%s): set-up outbound window %d (vmeAddr=0x%lx size=0x%lx)\n", __FUNCTION__, winNo, (long unsigned int)startAddr, (long unsigned int)size);
 
 	/* get PCI memory */
-	if( Tsi148_AllocOutbResource(vme4l_bh, winNo, size, spc) != TSI148_OK ){
+	if( (rv = Tsi148_AllocOutbResource(vme4l_bh, winNo, size, spc)) != TSI148_OK ){
 		goto CLEANUP;
 	}
 
@@ -1377,6 +1452,14 @@ CLEANUP:
 
 /***********************************************************************/
 /** Request VME slave address window in kernel memory.
+ *
+ * May sleep. With CONFIG_DMA_CMA, large windows are taken from the CMA
+ * area (cma= kernel parameter). CMA aligns them only up to
+ * CONFIG_CMA_ALIGNMENT (1MB by default), so on kernels where vme4l-core
+ * maps slave windows with PMDs, a window of at least PMD_SIZE that is not
+ * PMD aligned is allocated again with PMD_SIZE extra bytes and placed at
+ * the first PMD boundary inside. If that fails, the unaligned window is
+ * used and mapped with pages.
  *
  * \param vme4l_bh \IN VME4L bridge handle
  * \param winResP  \OUT allocated window resource
@@ -1391,7 +1474,8 @@ static inline int Tsi148_SlaveWindowAllocKernSpc(
 	size_t size,
 	dma_addr_t *dmaAddrP )
 {
-	winResP->vaddr = pci_alloc_consistent( vme4l_bh->pdev, size, dmaAddrP);
+	winResP->vaddr = dma_alloc_coherent( &vme4l_bh->pdev->dev, size, dmaAddrP,
+										 GFP_KERNEL | __GFP_NOWARN );
 	VME4LDBG( "vme4l(%s): alloced PCI mem virt=0x%p phys=0x%llx (0x%llx)\n",
 			  __FUNCTION__, winResP->vaddr, (uint64_t) *dmaAddrP,
 			  (uint64_t) size );
@@ -1403,10 +1487,38 @@ static inline int Tsi148_SlaveWindowAllocKernSpc(
 	}
 	else {
 		winResP->memReq	= 1;
+		winResP->memVaddr = winResP->vaddr;
+		winResP->memPhys = *dmaAddrP;
+		winResP->memSize = size;
+	}
+
+#ifdef TSI148_SLV_PMD_ALIGN
+	if( size >= PMD_SIZE && !IS_ALIGNED( *dmaAddrP, PMD_SIZE )){
+		size_t memSize = size + PMD_SIZE;
+		dma_addr_t memPhys;
+		void *memVaddr;
+
+		memVaddr = dma_alloc_coherent( &vme4l_bh->pdev->dev, memSize,
+									   &memPhys, GFP_KERNEL | __GFP_NOWARN );
+		if( memVaddr != NULL ){
+			dma_free_coherent( &vme4l_bh->pdev->dev, winResP->memSize,
+							   winResP->memVaddr, winResP->memPhys );
+			winResP->memVaddr = memVaddr;
+			winResP->memPhys = memPhys;
+			winResP->memSize = memSize;
+			*dmaAddrP = ALIGN( memPhys, PMD_SIZE );
+			winResP->vaddr = memVaddr + (*dmaAddrP - memPhys);
+			VME4LDBG( "vme4l(%s): PMD aligned window virt=0x%p "
+					  "phys=0x%llx\n", __FUNCTION__, winResP->vaddr,
+					  (uint64_t) *dmaAddrP );
+		}
 	}
+#endif
 	
-	/* clear region */
+#if LINUX_VERSION_CODE < KERNEL_VERSION(5,0,0)
+	/* clear region (done by dma_alloc_coherent() on newer kernels) */
 	memset( winResP->vaddr, 0, size );
+#endif
 
 #if LINUX_VERSION_CODE < KERNEL_VERSION(2,6,10)
 	/*
@@ -1453,7 +1565,12 @@ static int Tsi148_SlaveWindowCtrl(
 	dma_addr_t dmaAddr = 0;
 	vmeaddr_t vmeMask;
 	unsigned long ps;
+	VME4L_RESRC freeRes;
 	
+	freeRes.memVaddr = NULL;
+
+	/* window memory is allocated/freed without lockState held */
+	down( &vme4l_bh->slvSem );
 	TSI148_LOCK_STATE_IRQ( ps );
 
 	VME4LDBG( "vme4l(%s): spc=%d vmeAddr=0x%lx size=0x%lx\n",  __FUNCTION__, spc, (long unsigned int)vmeAddr, (long unsigned int)size);
@@ -1534,8 +1651,12 @@ static int Tsi148_SlaveWindowCtrl(
 					& VME4L_TSI148_WIN_FLAGS_TYP_MASK ) {
 			
 				case VME4L_TSI148_WIN_FLAGS_KERN:
-					if( Tsi148_SlaveWindowAllocKernSpc( vme4l_bh, winResP,
-						size, &dmaAddr ) != TSI148_OK ) {
+					TSI148_UNLOCK_STATE_IRQ( ps );
+					rv = Tsi148_SlaveWindowAllocKernSpc( vme4l_bh, winResP,
+														 size, &dmaAddr );
+					TSI148_LOCK_STATE_IRQ( ps );
+
+					if( rv != TSI148_OK ) {
 						rv = -ENOSPC;
 						goto CLEANUP;
 					}
@@ -1586,11 +1707,9 @@ static int Tsi148_SlaveWindowCtrl(
 		}
 	}
 	else {
-		/* free window... */
-		if( winResP->memReq ) {
-			pci_free_consistent(vme4l_bh->pdev, winResP->size, winResP->vaddr,
-								winResP->phys);
-		}
+		/* free window... (memory after window has been disabled) */
+		if( winResP->memReq )
+			freeRes = *winResP;
 		winResP->memReq = 0;
 		winResP->inUse = 0;
 		winResP->size = 0;
@@ -1619,6 +1738,11 @@ static int Tsi148_SlaveWindowCtrl(
 CLEANUP:
 	TSI148_UNLOCK_STATE_IRQ( ps );
 
+	if( freeRes.memVaddr )
+		dma_free_coherent( &vme4l_bh->pdev->dev, freeRes.memSize,
+						   freeRes.memVaddr, freeRes.memPhys );
+	up( &vme4l_bh->slvSem );
+
 	return rv;
 }/* Tsi148_SlaveWindowCtrl */
 
@@ -1714,6 +1838,133 @@ TSI148_WRITE_PIO_XX( 16, uint16_t )
 TSI148_WRITE_PIO_XX( 32, uint32_t )
 
 
+/***********************************************************************/
+/** Copy loops for block PIO, unrolled by 4
+ *
+ * \param vaddr		virtual address of first VME location
+ * \param buf		kernel buffer
+ * \param n			number of accesses
+ */
+#define TSI148_PIO_BLOCK_XX(size,type) \
+static inline void Tsi148_ReadBlock##size ( void *vaddr, type *buf, size_t n )\
+{\
+	for( ; n >= 4; n -= 4, buf += 4, vaddr += 4*sizeof(type) ){\
+		buf[0] = TSI148_WIN_READ##size( vaddr );\
+		buf[1] = TSI148_WIN_READ##size( vaddr + sizeof(type) );\
+		buf[2] = TSI148_WIN_READ##size( vaddr + 2*sizeof(type) );\
+		buf[3] = TSI148_WIN_READ##size( vaddr + 3*sizeof(type) );\
+	}\
+	for( ; n > 0; n--, buf++, vaddr += sizeof(type) )\
+		*buf = TSI148_WIN_READ##size( vaddr );\
+}\
+static inline void Tsi148_WriteBlock##size ( void *vaddr, type *buf, size_t n )\
+{\
+	for( ; n >= 4; n -= 4, buf += 4, vaddr += 4*sizeof(type) ){\
+		TSI148_WIN_WRITE##size( vaddr, buf[0] );\
+		TSI148_WIN_WRITE##size( vaddr + sizeof(type), buf[1] );\
+		TSI148_WIN_WRITE##size( vaddr + 2*sizeof(type), buf[2] );\
+		TSI148_WIN_WRITE##size( vaddr + 3*sizeof(type), buf[3] );\
+	}\
+	for( ; n > 0; n--, buf++, vaddr += sizeof(type) )\
+		TSI148_WIN_WRITE##size( vaddr, *buf );\
+}
+
+TSI148_PIO_BLOCK_XX(  8, uint8_t  )
+TSI148_PIO_BLOCK_XX( 16, uint16_t )
+TSI148_PIO_BLOCK_XX( 32, uint32_t )
+
+
+/***********************************************************************/
+/** Read/write block PIO.
+ *
+ * Same bus error handling as the single access PIO functions, but only
+ * one bus error check per block.
+ *
+ * \param direction		0=read from VME 1=write to VME
+ * \sa readPioBlock, writePioBlock
+ *
+ */
+static int Tsi148_PioBlock(
+	VME4L_BRIDGE_HANDLE *vme4l_bh,
+	int direction,
+	void *vaddr,
+	void *dataP,
+	size_t size,
+	int accWidth)
+{
+	unsigned long ps;
+	int rv = 0;
+
+	TSI148_LOCK_STATE_IRQ( ps );
+
+	/* clear bus errors */
+	TSI148_CTRL_WRITE(lcsr.veat, TSI148_VEAT_VESCL);
+
+	switch( accWidth ){
+	case 1:
+		if( direction )
+			Tsi148_WriteBlock8( vaddr, dataP, size );
+		else
+			Tsi148_ReadBlock8( vaddr, dataP, size );
+		break;
+	case 2:
+		if( direction )
+			Tsi148_WriteBlock16( vaddr, dataP, size >> 1 );
+		else
+			Tsi148_ReadBlock16( vaddr, dataP, size >> 1 );
+		break;
+	case 4:
+		if( direction )
+			Tsi148_WriteBlock32( vaddr, dataP, size >> 2 );
+		else
+			Tsi148_ReadBlock32( vaddr, dataP, size >> 2 );
+		break;
+	default:
+		rv = -EINVAL;
+		goto CLEANUP;
+	}
+
+	/* check for bus errors */
+	if( TSI148_CTRL_READ(lcsr.veat) & TSI148_VEAT_VES ) {
+		VME4LDBG( "*** vme4l(%s): VME bus error at 0x%08x_%08x (veat="
+				  "0x%08x)\n", __FUNCTION__, TSI148_CTRL_READ(lcsr.veau),
+				  TSI148_CTRL_READ(lcsr.veal), TSI148_CTRL_READ(lcsr.veat) );
+		TSI148_CTRL_WRITE(lcsr.veat, TSI148_VEAT_VESCL);
+		rv = -EIO;
+	}
+
+CLEANUP:
+	TSI148_UNLOCK_STATE_IRQ( ps );
+	return rv;
+}
+
+/** \sa readPioBlock */
+static int Tsi148_ReadPioBlock(
+	VME4L_BRIDGE_HANDLE *vme4l_bh,
+	void *vaddr,
+	void *dataP,
+	size_t size,
+	int accWidth,
+	int flags,
+	void *bDrvData)
+{
+	return Tsi148_PioBlock( vme4l_bh, 0, vaddr, dataP, size, accWidth );
+}
+
+/** \sa writePioBlock */
+static int Tsi148_WritePioBlock(
+	VME4L_BRIDGE_HANDLE *vme4l_bh,
+	void *vaddr,
+	void *dataP,
+	size_t size,
+	int accWidth,
+	int flags,
+	void *bDrvData)
+{
+	return Tsi148_PioBlock( vme4l_bh, 1, vaddr, dataP, size, accWidth );
+}
+
+
 /**********************************************************************/
 /** Read mailbox value.
  *
@@ -1830,14 +2081,33 @@ static int Tsi148_LocMonRegWrite(
 }
 
 
+/**********************************************************************/
+/** Get PCI device of TSI148 (used by core to map DMA buffers).
+ *
+ * \sa pciDevGet
+ *
+ */
+static struct pci_dev *Tsi148_PciDevGet( VME4L_BRIDGE_HANDLE *h )
+{
+	return h->pdev;
+}
+
+
 /***********************************************************************/
-/** Write DMA controller linked-list descriptors.
+/** Write DMA controller linked-list descriptors into descriptor buffer.
  *
- * \sa dmaSetup
+ * Does not touch the DMA controller registers.
  *
+ * \param ch		DMA channel
+ * \param idx		index of descriptor buffer (0..TSI148_DMA_DESC_AREAS-1)
+ *
+ * \return number of scatter list elements used or negative error number
+ * \sa dmaSetup
  */
-static int Tsi148_DmaSetup(
+static int Tsi148_DmaDescWrite(
 	VME4L_BRIDGE_HANDLE *vme4l_bh,
+	int ch,
+	int idx,
 	VME4L_SPACE spc,
 	VME4L_SCATTER_ELEM *sgList,
 	int sgNelems,
@@ -1868,7 +2138,7 @@ static int Tsi148_DmaSetup(
 	}
 	
 	/* get buffer for DMA linked-list descriptors */
-	if( vme4l_bh->dmaDescBuf == NULL ) {
+	if( vme4l_bh->dmaDescBuf[ch][idx] == NULL ) {
 		if( (bdVirtP = (TSI148_DMA_LL_DESC*) __get_free_pages(GFP_KERNEL,
 			TSI148_DMA_DESC_PAGES)) == NULL ) {
 	
@@ -1877,20 +2147,15 @@ static int Tsi148_DmaSetup(
 			rv = -ENOMEM;
 			goto CLEANUP;
 		}
-		vme4l_bh->dmaDescBuf = bdVirtP;
+		vme4l_bh->dmaDescBuf[ch][idx] = bdVirtP;
 	}
 	else {
-		bdVirtP = vme4l_bh->dmaDescBuf;
+		bdVirtP = vme4l_bh->dmaDescBuf[ch][idx];
 	}
 	endBd = (sgNelems < TSI148_DMA_DESC_MAX) ? sgNelems : TSI148_DMA_DESC_MAX;
 	VME4LDBG( "vme4l(%s): bdVaddr=0x%p endBd=%d\n", __FUNCTION__,
 			  bdVirtP, endBd );
 
-	/* tell TSI148 where to find linked-list (at PCI bus) */
-	tmp64 = virt_to_bus(bdVirtP);
-	TSI148_CTRL_WRITE( lcsr.dmactl[0].dnlau, (uint32_t) (tmp64>>32) );
-	TSI148_CTRL_WRITE( lcsr.dmactl[0].dnlal, (uint32_t) tmp64 );
-
 	/* setup linked-list */
 	for( i=0; i<endBd; i++, sgList++, bdVirtP++ ){
 
@@ -1934,7 +2199,7 @@ static int Tsi148_DmaSetup(
 
 #ifdef DBG
     {
-		uint32_t *p = (uint32_t*) vme4l_bh->dmaDescBuf;
+		uint32_t *p = (uint32_t*) vme4l_bh->dmaDescBuf[ch][idx];
 
 		for(i=0; i<endBd; i++ ){
 			if( i<3 || i>=endBd-3 ) {
@@ -1964,45 +2229,143 @@ static int Tsi148_DmaSetup(
 }
 
 
+/***********************************************************************/
+/** Tell DMA controller where to find linked-list of descriptor buffer.
+ *
+ * \param ch		DMA channel
+ * \param idx		index of descriptor buffer
+ */
+static void Tsi148_DmaDescLoad( VME4L_BRIDGE_HANDLE *vme4l_bh, int ch, int idx )
+{
+	/* address of linked-list at PCI bus */
+	uint64_t tmp64 = virt_to_bus(vme4l_bh->dmaDescBuf[ch][idx]);
+
+	TSI148_CTRL_WRITE( lcsr.dmactl[ch].dnlau, (uint32_t) (tmp64>>32) );
+	TSI148_CTRL_WRITE( lcsr.dmactl[ch].dnlal, (uint32_t) tmp64 );
+}
+
+
+/***********************************************************************/
+/** Write DMA controller linked-list descriptors.
+ *
+ * \sa dmaSetup
+ *
+ */
+static int Tsi148_DmaSetup(
+	VME4L_BRIDGE_HANDLE *vme4l_bh,
+	int ch,
+	VME4L_SPACE spc,
+	VME4L_SCATTER_ELEM *sgList,
+	int sgNelems,
+	int direction,
+	int swapMode,
+	vmeaddr_t *vmeAddr,
+	int flags)
+{
+	int rv;
+
+	rv = Tsi148_DmaDescWrite( vme4l_bh, ch, vme4l_bh->dmaDescIdx[ch], spc,
+							  sgList, sgNelems, direction, swapMode, vmeAddr,
+							  flags );
+	if( rv > 0 )
+		Tsi148_DmaDescLoad( vme4l_bh, ch, vme4l_bh->dmaDescIdx[ch] );
+
+	return rv;
+}
+
+
+/***********************************************************************/
+/** Write next DMA linked-list into the unused descriptor buffer.
+ *
+ * \sa dmaSetupNext
+ *
+ */
+static int Tsi148_DmaSetupNext(
+	VME4L_BRIDGE_HANDLE *vme4l_bh,
+	int ch,
+	VME4L_SPACE spc,
+	VME4L_SCATTER_ELEM *sgList,
+	int sgNelems,
+	int direction,
+	int swapMode,
+	vmeaddr_t *vmeAddr,
+	int flags)
+{
+	return Tsi148_DmaDescWrite( vme4l_bh, ch,
+								(vme4l_bh->dmaDescIdx[ch] + 1)
+								% TSI148_DMA_DESC_AREAS,
+								spc, sgList, sgNelems, direction, swapMode,
+								vmeAddr, flags );
+}
+
+
 /***********************************************************************/
 /** Start DMA with the linked-list setup by dmaSetup.
  *
  * \sa dmaStart
  *
  */
-static int Tsi148_DmaStart( VME4L_BRIDGE_HANDLE *vme4l_bh )
+static int Tsi148_DmaStart( VME4L_BRIDGE_HANDLE *vme4l_bh, int ch )
 {
-	if( TSI148_CTRL_READ( lcsr.dmactl[0].dsta ) & TSI148_DSTA_BSY ){
-		printk( KERN_ERR "*** vme4l(%s): DMA busy\n", __FUNCTION__ );
+	unsigned long ps;
+
+	if( TSI148_CTRL_READ( lcsr.dmactl[ch].dsta ) & TSI148_DSTA_BSY ){
+		printk( KERN_ERR "*** vme4l(%s): DMA %d busy\n", __FUNCTION__, ch );
 		return -EBUSY;
 	}
 	
-	/* enable DMA interrupt */
-	TSI148_CTRL_SETMASK( lcsr.inteo, TSI148_INTEX_DMA0 );
-	TSI148_CTRL_SETMASK( lcsr.inten, TSI148_INTEX_DMA0 );
+	/* enable DMA interrupt (regs shared with other channel) */
+	TSI148_LOCK_STATE_IRQ( ps );
+	TSI148_CTRL_SETMASK( lcsr.inteo, TSI148_INTEX_DMA(ch) );
+	TSI148_CTRL_SETMASK( lcsr.inten, TSI148_INTEX_DMA(ch) );
+	TSI148_UNLOCK_STATE_IRQ( ps );
 	
 	/* start DMA */
-	TSI148_CTRL_WRITE( lcsr.dmactl[0].dctl,
+	TSI148_CTRL_WRITE( lcsr.dmactl[ch].dctl,
 					   TSI148_DCTL_DGO | TSI148_BLT_DCTL );
 	
 	return 0;
 }
 
 
+/***********************************************************************/
+/** Start DMA with the linked-list setup by dmaSetupNext.
+ *
+ * \sa dmaStartNext
+ *
+ */
+static int Tsi148_DmaStartNext( VME4L_BRIDGE_HANDLE *vme4l_bh, int ch )
+{
+	/* previous linked-list must have finished ok */
+	if( TSI148_CTRL_READ( lcsr.dmactl[ch].dsta ) & TSI148_DSTA_ERR )
+		return -EIO;
+
+	vme4l_bh->dmaDescIdx[ch] = (vme4l_bh->dmaDescIdx[ch] + 1)
+		% TSI148_DMA_DESC_AREAS;
+	Tsi148_DmaDescLoad( vme4l_bh, ch, vme4l_bh->dmaDescIdx[ch] );
+
+	return Tsi148_DmaStart( vme4l_bh, ch );
+}
+
+
 /***********************************************************************/
 /** Stop DMA transfer.
  *
  * \sa dmaStop
  *
  */
-static int Tsi148_DmaStop( VME4L_BRIDGE_HANDLE *vme4l_bh )
+static int Tsi148_DmaStop( VME4L_BRIDGE_HANDLE *vme4l_bh, int ch )
 {
+	unsigned long ps;
+
 	/* disable DMA interrupt */
-	TSI148_CTRL_CLRMASK( lcsr.inteo, TSI148_INTEX_DMA0 );
-	TSI148_CTRL_CLRMASK( lcsr.inten, TSI148_INTEX_DMA0 );
+	TSI148_LOCK_STATE_IRQ( ps );
+	TSI148_CTRL_CLRMASK( lcsr.inteo, TSI148_INTEX_DMA(ch) );
+	TSI148_CTRL_CLRMASK( lcsr.inten, TSI148_INTEX_DMA(ch) );
+	TSI148_UNLOCK_STATE_IRQ( ps );
 	
 	/* abort DMA */
-	TSI148_CTRL_WRITE( lcsr.dmactl[0].dctl, TSI148_DCTL_ABT );
+	TSI148_CTRL_WRITE( lcsr.dmactl[ch].dctl, TSI148_DCTL_ABT );
 
 	return 0;
 }
@@ -2014,9 +2377,9 @@ static int Tsi148_DmaStop( VME4L_BRIDGE_HANDLE *vme4l_bh )
  * \sa dmaStatus
  *
  */
-static int Tsi148_DmaStatus( VME4L_BRIDGE_HANDLE *h )
+static int Tsi148_DmaStatus( VME4L_BRIDGE_HANDLE *h, int ch )
 {
-	uint32_t dsta = TSI148_CTRL_READ( lcsr.dmactl[0].dsta );
+	uint32_t dsta = TSI148_CTRL_READ( lcsr.dmactl[ch].dsta );
 
 	VME4LDBG("vme4l(%s): dsta=0x%08x\n", __FUNCTION__, dsta );
 
@@ -2030,6 +2393,30 @@ static int Tsi148_DmaStatus( VME4L_BRIDGE_HANDLE *h )
 }
 
 
+/***********************************************************************/
+/** Get number of DMA controllers.
+ *
+ * \sa dmaChannelsGet
+ *
+ */
+static int Tsi148_DmaChannelsGet( VME4L_BRIDGE_HANDLE *h )
+{
+	return TSI148_DMA_CHANNELS;
+}
+
+
+/***********************************************************************/
+/** Get max. number of bytes of one DMA scatter element.
+ *
+ * \sa dmaSegMaxGet
+ *
+ */
+static uint32_t Tsi148_DmaSegMaxGet( VME4L_BRIDGE_HANDLE *h )
+{
+	return TSI148_DMA_SEG_MAX;
+}
+
+
 /***********************************************************************/
 /** Generate a VMEbus interrupt.
  *
@@ -2372,6 +2759,15 @@ static int Tsi148_IrqLevelCtrl(
  | LINUX specific stuff |
  +----------------------*/
 
+static const VME4L_BRIDGE_DRV_EXT G_tsi148DrvExt = {
+	.dmaSetupNext		= Tsi148_DmaSetupNext,
+	.dmaStartNext		= Tsi148_DmaStartNext,
+	.dmaChannelsGet		= Tsi148_DmaChannelsGet,
+	.dmaSegMaxGet		= Tsi148_DmaSegMaxGet,
+	.readPioBlock		= Tsi148_ReadPioBlock,
+	.writePioBlock		= Tsi148_WritePioBlock,
+};/* G_tsi148DrvExt */
+
 static VME4L_BRIDGE_DRV G_tsi148Drv = {
 	.revisionInfo		= Tsi148_RevisionInfo,
 	.requestAddrWindow 	= Tsi148_RequestAddrWindow,
@@ -2408,7 +2804,8 @@ static VME4L_BRIDGE_DRV G_tsi148Drv = {
 	.mboxWrite          = Tsi148_MboxWrite,
 	.locMonRegRead      = Tsi148_LocMonRegRead,
 	.locMonRegWrite     = Tsi148_LocMonRegWrite,
-	.reserved           = { 0, 0, 0, 0, 0 }
+	.pciDevGet          = Tsi148_PciDevGet,
+	.ext				= &G_tsi148DrvExt,
 };/* G_tsi148Drv */
 
 
@@ -2487,13 +2884,14 @@ static int DEVINIT tsi148_pci_init_one(
 	Tsi148_InitBridge();
 
 	spin_lock_init(&vme4l_bh->lockState);
+	sema_init(&vme4l_bh->slvSem, 1);
 
 	/* Tsi148_IrqHandler is the standard linux IRQ handler */
-	if( (rv = request_irq( pdev->irq,
-						   Tsi148_IrqHandler,
-						   IRQF_SHARED,
-						   "tsi148",
-						   vme4l_bh)) < 0 ) {
+	if( (rv = vme4l_request_irq( pdev->irq,
+								 Tsi148_IrqHandler,
+								 IRQF_SHARED,
+								 "tsi148",
+								 vme4l_bh)) < 0 ) {
 		VME4LDBG( "vme4l(%s): error request_irq !\n", __FUNCTION__);
 		goto CLEANUP;
 	}
@@ -2517,7 +2915,7 @@ CLEANUP:
 		__FUNCTION__);
 
 	if( irqReq ){
-		free_irq( pdev->irq, vme4l_bh );
+		vme4l_free_irq( pdev->irq, vme4l_bh );
 	}
 	
 	Tsi148_FreeRegSpace(&vme4l_bh->regs);
@@ -2542,8 +2940,8 @@ static void DEVEXIT tsi148_pci_remove_one( struct pci_dev *pdev )
 		
 		Tsi148_InboundWinSet( i, VME4L_SPC_SLV0+i, 0, 0, 0 /*disable*/ );
 		if( winResP->memReq ) {
-			pci_free_consistent( vme4l_bh->pdev, winResP->size, winResP->vaddr,
-								 winResP->phys );
+			dma_free_coherent( &vme4l_bh->pdev->dev, winResP->memSize,
+							   winResP->memVaddr, winResP->memPhys );
 		}
 	}
 
@@ -2556,11 +2954,15 @@ static void DEVEXIT tsi148_pci_remove_one( struct pci_dev *pdev )
 	Tsi148_InitBridge();	/* set TSI148 register to defaults */
 
 	/* irq */
-	free_irq( pdev->irq, vme4l_bh );
+	vme4l_free_irq( pdev->irq, vme4l_bh );
 
 	/* pages for DMA desc buffers */
-	if( vme4l_bh->dmaDescBuf ) {
-		free_pages( (unsigned long)vme4l_bh->dmaDescBuf, TSI148_DMA_DESC_PAGES );
+	for( i=0; i<TSI148_DMA_CHANNELS*TSI148_DMA_DESC_AREAS; i++ ) {
+		TSI148_DMA_LL_DESC *descBuf =
+			vme4l_bh->dmaDescBuf[i/TSI148_DMA_DESC_AREAS]
+								[i%TSI148_DMA_DESC_AREAS];
+		if( descBuf )
+			free_pages( (unsigned long)descBuf, TSI148_DMA_DESC_PAGES );
 	}
 
 	/* free allocated memory */
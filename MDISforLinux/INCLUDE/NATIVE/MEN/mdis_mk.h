@@ -49,6 +49,32 @@ typedef struct {
 	} p;
 } MDIS_LINUX_SGSTAT;
 
+/* one entry of M_getstat_multi/M_setstat_multi */
+typedef struct {
+	int32 code;					/* IN: standard status code */
+	int32 chan;					/* IN: channel, -1 for current channel */
+	INT32_OR_64 value;			/* IN/OUT: status value */
+	int32 error;				/* OUT: MDIS error code, 0=ok */
+} MDIS_SGSTAT_ENTRY;
+
+/* structure passed via ioctl MDIS_SGSTAT_BATCH */
+typedef struct {
+	int32 setStat;				/* 0=getstat, 1=setstat */
+	int32 count;				/* number of entries */
+	MDIS_SGSTAT_ENTRY *entries;	/* array of entries */
+} MDIS_LINUX_SGSTAT_BATCH;
+
+/* structure passed via ioctl MDIS_RW_MULTI */
+typedef struct {
+	int32 write;				/* 0=read, 1=write */
+	int32 count;				/* number of values */
+	int32 *values;				/* IN/OUT: values */
+	const int32 *chans;			/* IN: channel of each value, or NULL
+								   for channels from current channel on */
+	int32 error;				/* OUT: MDIS error code that stopped the
+								   transfer, 0=ok */
+} MDIS_LINUX_RW_MULTI;
+
 /*
  * structure passed via ioctls
  * MDIS_OPEN_DEVICE, MDIS_REMOVE_DEVICE,
@@ -91,7 +117,49 @@ typedef struct {
 #define MDIS_REMOVE_DEVICE	_IOW( MDIS_IOC_MAGIC, 7, MDIS_OPEN_DEVICE_DATA )
 #define MDIS_OPEN_BOARD		_IOW( MDIS_IOC_MAGIC, 8, MDIS_OPEN_DEVICE_DATA )
 #define MDIS_REMOVE_BOARD	_IOW( MDIS_IOC_MAGIC, 9, MDIS_OPEN_DEVICE_DATA )
-#define MDIS_IOC_MAXNR		9
+#define MDIS_SGSTAT_BATCH	_IOW( MDIS_IOC_MAGIC, 10, MDIS_LINUX_SGSTAT_BATCH )
+#define MDIS_RW_MULTI		_IOW( MDIS_IOC_MAGIC, 11, MDIS_LINUX_RW_MULTI )
+#define MDIS_IOC_MAXNR		11
+
+/* max. number of entries per MDIS_SGSTAT_BATCH call */
+#define MDIS_SGSTAT_BATCH_MAX	1024
+/* max. number of values per MDIS_RW_MULTI call */
+#define MDIS_RW_MULTI_MAX		4096
+
+/*
+ * Linux specific LL getstat codes, queried by MDIS kernel at device init.
+ * They use the LL common part of the OS special purpose space
+ * (M_OFFS_SPEC, 0x1900..0x19ff), which mdis_api.h leaves free, so they
+ * can't collide with standard or driver specific codes. LL drivers not
+ * supporting a code get the default behaviour.
+ */
+#define M_LINUX_LL_OF		(M_OFFS_STD+M_OFFS_SPEC+M_OFFS_LL)
+
+/* returns MK_LL_BLK_xxx flags */
+#define M_LL_BLK_CAPS		(M_LINUX_LL_OF+0x01)
+
+/* blockRead/blockWrite may get a kernel mapping of the pinned user buffer
+   instead of a copy (buffer is not physically contiguous) */
+#define MK_LL_BLK_ZEROCOPY	0x01
+
+/*
+ * Returns MK_LL_LOCK_xxx flags.
+ *
+ * The call and channel locks always inherit priority. The device
+ * semaphore (devSemHdl) doesn't, so a high priority caller can still
+ * wait for a low priority one inside the LL driver. This is avoided only
+ * for LL drivers reporting MK_LL_LOCK_NODEVSEM. No LL driver in this
+ * package does so yet; a driver has to be checked not to use devSemHdl
+ * before it may report the flag.
+ */
+#define M_LL_LOCK_CAPS		(M_LINUX_LL_OF+0x02)
+
+/* driver never uses devSemHdl: MDIS kernel serializes calls with a
+   priority inheriting lock instead of the device semaphore */
+#define MK_LL_LOCK_NODEVSEM	0x01
+/* driver is reentrant: with LL_LOCK_NONE and MK_LL_LOCK_NODEVSEM,
+   MDIS kernel calls it without any device lock */
+#define MK_LL_LOCK_REENTRANT	0x02
 
 /* table to compress/decompress error numbers on PPC. see mk_module.c */
 typedef struct {
@@ -128,6 +196,14 @@ int32 MDIS_CreateDevice( char *device, int rtMode, int persist );
 int32 MDIS_RemoveDevice( char *device );
 int32 MDIS_OpenBoard( char *device );
 int32 MDIS_RemoveBoard( char *device );
+int32 M_getstat_multi( MDIS_PATH path, MDIS_SGSTAT_ENTRY *entries,
+					   int32 count );
+int32 M_setstat_multi( MDIS_PATH path, MDIS_SGSTAT_ENTRY *entries,
+					   int32 count );
+int32 M_read_multi( MDIS_PATH path, int32 *values, int32 count,
+					const int32 *chans );
+int32 M_write_multi( MDIS_PATH path, const int32 *values, int32 count,
+					 const int32 *chans );
 
 #ifdef __KERNEL__
 extern int mdis_register_ll_driver( char *llName,
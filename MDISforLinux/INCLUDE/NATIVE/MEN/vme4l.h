@@ -153,6 +153,9 @@ typedef enum {
 #define VME4L_RW_USE_SGL_DMA 			0x02
 #define VME4L_RW_KERNEL_SPACE_DMA 		0x04
 #define VME4L_RW_NOVMEINC			0x08
+/** PIO: let bridge copy whole block, bus errors are only detected per
+	block of up to 256 bytes (data of failing block undefined) */
+#define VME4L_RW_PIO_BLOCK			0x10
 
 /*! @} */
 
@@ -202,6 +205,20 @@ typedef enum {
 
 /*! @} */
 
+/**********************************************************************/
+/** \defgroup VME4L_MAPMODE map mode for VME4L_MapModeSet()
+ *  @{
+ */
+/** map uncached (default) */
+#define VME4L_MAP_NOFLAGS			0x00
+
+/** master spaces only: map write-combining. CPU stores may be merged
+ * into bursts and are posted, see VME4L_MapFlush()
+ */
+#define VME4L_MAP_WC				0x01
+
+/*! @} */
+
 /* definitions shared between driver and API lib */
 
 typedef struct {
@@ -213,6 +230,15 @@ typedef struct {
 	int flags;
 } VME4L_RW_BLOCK;
 
+/** max. number of segments for VME4L_IO_RW_VECTOR */
+#define VME4L_RW_VECTOR_MAX		256
+
+/** argument for VME4L_IO_RW_VECTOR */
+typedef struct {
+	VME4L_RW_BLOCK *blkP;	/**< array of segments */
+	int count;				/**< number of segments in \a blkP */
+} VME4L_RW_VECTOR;
+
 typedef struct {
 	int vector;
 	int level;
@@ -220,6 +246,66 @@ typedef struct {
 	int flags;
 } VME4L_SIG_INSTALL2;
 
+/** number of interrupt records queued per file for read() */
+#define VME4L_EVENT_QUEUE_LEN	64
+
+/** argument for VME4L_IO_EVENT_INSTALL */
+typedef struct {
+	int vector;			/**< VME vector or special vector */
+	int level;			/**< VME level or special level */
+	int eventFd;		/**< eventfd to signal or -1 to queue VME4L_EVENT
+							 records for read()/poll() on the file */
+	int flags;			/**< see \ref VME4L_IRQFLAGS */
+} VME4L_EVENT_INSTALL;
+
+/** interrupt record, returned by read() on a VME4L file */
+typedef struct {
+	int32_t vector;		/**< VME vector or special vector */
+	int32_t level;		/**< VME level or special level */
+	uint32_t lost;		/**< records dropped before this one (queue full) */
+	uint32_t reserved;
+	uint64_t timeNs;	/**< time of interrupt (CLOCK_MONOTONIC, ns) */
+} VME4L_EVENT;
+
+/** version of VME4L_STATS layout */
+#define VME4L_STATS_VERSION		1
+/** number of spaces in VME4L_STATS.spaces */
+#define VME4L_STATS_SPACES		32
+
+/** per space counters in VME4L_STATS */
+typedef struct {
+	uint64_t dmaBytes[2];	/**< bytes transferred by DMA (0=read 1=write) */
+	uint64_t pioBytes[2];	/**< bytes transferred by PIO (0=read 1=write) */
+	uint64_t busErrors;		/**< transfers failed with bus error */
+	uint64_t winHits;		/**< requests served by a mapped window */
+	uint64_t winMisses;		/**< requests that set up a new window */
+	uint64_t mapHits;		/**< PIO accesses using a cached ioremap */
+	uint64_t mapMisses;		/**< PIO accesses that needed a new ioremap */
+} VME4L_SPACE_STATS;
+
+/** argument for VME4L_IO_STATS_GET
+ *
+ * All counters are 64 bit and count since the driver was loaded. The
+ * layout only grows at the end, \em version is increased then. The
+ * driver fills in as much as the caller's structure can hold. Callers
+ * built with a newer layout get only the first \em size bytes filled.
+ */
+typedef struct {
+	uint32_t version;		/**< VME4L_STATS_VERSION */
+	uint32_t size;			/**< sizeof(VME4L_STATS) of the driver */
+	uint64_t hwIrqs;		/**< bridge interrupts */
+	uint64_t handled;		/**< interrupt sources handled */
+	uint64_t spurious;		/**< bridge interrupts without pending source */
+	uint64_t vmeIrqs;		/**< VME interrupts (level 1..7) */
+	uint64_t busErrIrqs;	/**< bus error interrupts */
+	uint64_t dmaIrqs;		/**< DMA finished interrupts */
+	uint64_t mboxIrqs;		/**< mailbox interrupts */
+	uint64_t locMonIrqs;	/**< location monitor interrupts */
+	uint64_t levels[VME4L_NUM_LEVELS];	/**< interrupts per level */
+	uint64_t vectors[VME4L_NUM_VECTORS]; /**< dispatched per vector */
+	VME4L_SPACE_STATS spaces[VME4L_STATS_SPACES]; /**< per VME4L_SPACE */
+} VME4L_STATS;
+
 typedef struct {
 	int attr;
 	vmeaddr_t 	addr;
@@ -248,6 +334,102 @@ typedef struct {
 	uint32_t val;
 } VME4L_MBOX_RW;				/* used also for VME4L_IO_LOCMON_REG_RW */
 
+/**********************************************************************/
+/** \defgroup VME4L_ASYNC asynchronous DMA submission rings
+ *
+ * Submission/completion ring pair shared between vme4l-core and user
+ * space. The rings are set up with VME4L_IO_ASYNC_SETUP and mmap'ed
+ * from the same file descriptor (offset 0). They live until the file
+ * descriptor is closed. Once set up, mmap() on this file descriptor
+ * maps the rings, so use a separate descriptor for VME4L_Map().
+ *
+ * The producer of a ring only advances the tail, the consumer only
+ * advances the head. All indices are free running, the slot used is
+ * (index & (entries-1)).
+ *  @{
+ */
+/** max. number of entries per ring */
+#define VME4L_ASYNC_MAX_ENTRIES		4096
+
+/** submission queue entry (written by user) */
+typedef struct {
+	uint64_t userData;	/**< passed back unchanged in completion entry */
+	vmeaddr_t vmeAddr;	/**< VME start address */
+	int direction;		/**< 0 for read, 1 for write */
+	int flags;			/**< see \ref VME4L_RWFLAGS */
+	size_t size;		/**< number of bytes to transfer */
+	void *dataP;		/**< user buffer */
+} VME4L_ASYNC_SQE;
+
+/** completion queue entry (written by driver) */
+typedef struct {
+	uint64_t userData;	/**< VME4L_ASYNC_SQE.userData of request */
+	int result;			/**< bytes transferred or negative error number */
+	int reserved;
+} VME4L_ASYNC_CQE;
+
+/** ring header at start of mmap'ed area */
+typedef struct {
+	volatile uint32_t sqHead;	/**< next SQE consumed by driver */
+	volatile uint32_t sqTail;	/**< next SQE filled by user */
+	volatile uint32_t cqHead;	/**< next CQE consumed by user */
+	volatile uint32_t cqTail;	/**< next CQE filled by driver */
+	uint32_t entries;			/**< number of entries in each ring */
+	uint32_t sqOff;				/**< offset of SQE array in mmap'ed area */
+	uint32_t cqOff;				/**< offset of CQE array in mmap'ed area */
+	uint32_t reserved;
+} VME4L_ASYNC_RING_HDR;
+
+/** argument for VME4L_IO_ASYNC_SETUP */
+typedef struct {
+	uint32_t entries;	/**< \IN requested entries (power of 2) */
+	uint32_t mapSize;	/**< \OUT size of area to mmap */
+} VME4L_ASYNC_SETUP;
+/*! @} */
+
+/**********************************************************************/
+/** \defgroup VME4L_PINBUF registered DMA buffers
+ *
+ * A user buffer registered with VME4L_IO_PINBUF_REGISTER stays locked
+ * and DMA mapped until it is unregistered or the file descriptor is
+ * closed. VME4L_IO_RW_PINNED transfers reference it by handle and
+ * offset, so the buffer is not pinned and mapped again per transfer.
+ *  @{
+ */
+/** max. number of registered buffers per file descriptor */
+#define VME4L_PINBUF_MAX			16
+
+/** argument for VME4L_IO_PINBUF_REGISTER */
+typedef struct {
+	void *dataP;		/**< \IN start of user buffer */
+	size_t size;		/**< \IN size of user buffer */
+	int handle;			/**< \OUT handle of registered buffer */
+} VME4L_PINBUF_REG;
+
+/** argument for VME4L_IO_RW_PINNED */
+typedef struct {
+	vmeaddr_t vmeAddr;	/**< VME start address */
+	int direction;		/**< 0 for read, 1 for write */
+	int handle;			/**< handle from VME4L_IO_PINBUF_REGISTER */
+	size_t offset;		/**< offset within registered buffer */
+	size_t size;		/**< number of bytes to transfer */
+	int flags;			/**< see \ref VME4L_RWFLAGS */
+} VME4L_RW_PINNED;
+/*! @} */
+
+/** max. DMA busy-poll time (us) for VME4L_IO_DMA_POLICY_SET */
+#define VME4L_DMA_POLL_MAX_US		1000
+
+/** max. DMA timeout (ms) for VME4L_IO_DMA_POLICY_SET */
+#define VME4L_DMA_TIMEOUT_MAX_MS	60000
+
+/** DMA completion policy (VME4L_IO_DMA_POLICY_SET/GET) */
+typedef struct {
+	uint32_t pollUs;	/**< busy-poll DMA status this long before sleeping
+							 on the DMA interrupt (0=don't poll) */
+	uint32_t timeoutMs;	/**< DMA timeout (ms) */
+} VME4L_DMA_POLICY;
+
 
 #define VME4L_IO_RW_BLOCK			_IOW( VME4L_IOC_MAGIC, 10, VME4L_RW_BLOCK )
 #define VME4L_IO_SIG_INSTALL2 		_IOW( VME4L_IOC_MAGIC, 11, VME4L_SIG_INSTALL2 )
@@ -280,7 +462,21 @@ typedef struct {
 #define VME4L_IO_REQUESTER_LVL_GET 	 	_IO( VME4L_IOC_MAGIC, 35 )
 #define VME4L_IO_CRCSR_BAR_SET			_IO( VME4L_IOC_MAGIC, 36 )
 #define VME4L_IO_CRCSR_BAR_GET			_IO( VME4L_IOC_MAGIC, 37 )
-#define VME4L_IOC_MAXNR 	         37
+#define VME4L_IO_ASYNC_SETUP			_IOWR( VME4L_IOC_MAGIC, 38, VME4L_ASYNC_SETUP )
+#define VME4L_IO_ASYNC_SUBMIT			_IO( VME4L_IOC_MAGIC, 39 )
+#define VME4L_IO_ASYNC_WAIT				_IO( VME4L_IOC_MAGIC, 40 )
+#define VME4L_IO_PINBUF_REGISTER		_IOWR( VME4L_IOC_MAGIC, 41, VME4L_PINBUF_REG )
+#define VME4L_IO_PINBUF_UNREGISTER		_IO( VME4L_IOC_MAGIC, 42 )
+#define VME4L_IO_RW_PINNED				_IOW( VME4L_IOC_MAGIC, 43, VME4L_RW_PINNED )
+#define VME4L_IO_DMA_POLICY_SET			_IOW( VME4L_IOC_MAGIC, 44, VME4L_DMA_POLICY )
+#define VME4L_IO_DMA_POLICY_GET			_IOR( VME4L_IOC_MAGIC, 45, VME4L_DMA_POLICY )
+#define VME4L_IO_RW_VECTOR				_IOW( VME4L_IOC_MAGIC, 46, VME4L_RW_VECTOR )
+#define VME4L_IO_EVENT_INSTALL			_IOW( VME4L_IOC_MAGIC, 47, VME4L_EVENT_INSTALL )
+#define VME4L_IO_EVENT_UNINSTALL		_IO( VME4L_IOC_MAGIC, 48 )
+#define VME4L_IO_STATS_GET				_IOR( VME4L_IOC_MAGIC, 49, VME4L_STATS )
+#define VME4L_IO_MMAP_BASE_SET			_IOW( VME4L_IOC_MAGIC, 50, vmeaddr_t )
+#define VME4L_IO_MAP_MODE_SET			_IO( VME4L_IOC_MAGIC, 51 )
+#define VME4L_IOC_MAXNR 	         51
 
 #  ifdef __cplusplus
        }
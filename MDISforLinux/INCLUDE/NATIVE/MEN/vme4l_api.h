@@ -46,6 +46,10 @@ int VME4L_RevisionInfo(int spaceFd, char *buf);
 
 int VME4L_SwapModeSet( int spaceFd, int swapMode);
 
+int VME4L_MapModeSet( int spaceFd, int mapMode);
+
+void VME4L_MapFlush( void );
+
 int VME4L_Read(
 	int spaceFd,
 	vmeaddr_t vmeAddr,
@@ -60,6 +64,7 @@ int VME4L_Write(
 	size_t size,
 	void *dataP,
 	int flags );
+int VME4L_RwVector( int spaceFd, VME4L_RW_BLOCK *blkP, int count );
 int VME4L_Map(
 	int spaceFd,
 	vmeaddr_t vmeAddr,
@@ -71,6 +76,9 @@ int VME4L_UnMap(
 	size_t size);
 int VME4L_SigInstall( int fd, int vector, int level, int signal, int flags );
 int VME4L_SigUnInstall( int fd, int vector );
+int VME4L_EventInstall( int fd, int vector, int level, int eventFd, int flags );
+int VME4L_EventUnInstall( int fd, int vector );
+int VME4L_EventRead( int fd, VME4L_EVENT *evP, int maxEv );
 int VME4L_IrqEnable( int fd, int level );
 int VME4L_IrqDisable( int fd, int level );
 int VME4L_SysCtrlFunctionGet( int fd );
@@ -109,6 +117,45 @@ int VME4L_MboxWrite( int fd, int mbox, uint32_t val);
 int VME4L_LocMonRegRead( int fd, int reg, uint32_t *rvP);
 int VME4L_LocMonRegWrite( int fd, int reg, uint32_t val);
 
+int VME4L_DmaPolicySet( int spaceFd, uint32_t pollUs, uint32_t timeoutMs );
+int VME4L_DmaPolicyGet( int spaceFd, uint32_t *pollUsP, uint32_t *timeoutMsP );
+
+int VME4L_StatsGet( int fd, VME4L_STATS *stats );
+
+int VME4L_PinBufRegister( int spaceFd, void *dataP, size_t size );
+int VME4L_PinBufUnregister( int spaceFd, int handle );
+int VME4L_ReadPinned(
+	int spaceFd,
+	vmeaddr_t vmeAddr,
+	int handle,
+	size_t offset,
+	size_t size,
+	int flags );
+int VME4L_WritePinned(
+	int spaceFd,
+	vmeaddr_t vmeAddr,
+	int handle,
+	size_t offset,
+	size_t size,
+	int flags );
+
+VME4L_ASYNC_RING_HDR *VME4L_AsyncSetup( int spaceFd, uint32_t entries );
+int VME4L_AsyncRelease( VME4L_ASYNC_RING_HDR *ring );
+int VME4L_AsyncQueue(
+	VME4L_ASYNC_RING_HDR *ring,
+	vmeaddr_t vmeAddr,
+	int direction,
+	size_t size,
+	void *dataP,
+	int flags,
+	uint64_t userData);
+int VME4L_AsyncSubmit( int spaceFd, unsigned int count );
+int VME4L_AsyncWait( int spaceFd, unsigned int minComplete );
+int VME4L_AsyncReap(
+	VME4L_ASYNC_RING_HDR *ring,
+	VME4L_ASYNC_CQE *cqeP,
+	int maxCqe);
+
 #  ifdef __cplusplus
        }
 #  endif
@@ -54,6 +54,10 @@
  - MDIS_CreateDevice(), MDIS_RemoveDevice(), MDIS_OpenBoard(),
    MDIS_RemoveBoard()
 
+ M_getstat_multi() and M_setstat_multi() perform several standard
+ status calls with a single system call and device lock.
+ M_read_multi() and M_write_multi() do the same for several channels.
+
 */
 /*! \page dummy
  \menimages
@@ -452,6 +456,138 @@ int32 M_setstat(MDIS_PATH path, int32 code, INT32_OR_64 data)
 	return rv;
 }
 
+/**********************************************************************/
+/** Read 32-bit integer values from several channels
+ *
+ * Reads \a count values in one system call, locking the device only
+ * once. With \a chans, value \a i is read from channel \a chans[i].
+ * Without, channels are read from the current channel on, wrapping at
+ * the last channel. Unlike M_read(), this is also done in #M_IO_EXEC
+ * mode; in #M_IO_EXEC_INC mode the current channel is then moved behind
+ * the last channel read.
+ *
+ * Reading stops at the first error. If values have been read before,
+ * their number is returned and errno is set to the error code, so
+ * a return value below \a count shows the error in errno.
+ *
+ * \param path		device path number
+ * \param values	buffer for \a count values
+ * \param count		number of values (max. #MDIS_RW_MULTI_MAX)
+ * \param chans		channel list with \a count entries, or NULL
+ *
+ * \return number of values read (errno set if less than \a count)
+ *         or -1 on error (errno set)
+ * \sa M_write_multi, M_read
+ */
+int32 M_read_multi(MDIS_PATH path, int32 *values, int32 count,
+				   const int32 *chans)
+{
+	MDIS_LINUX_RW_MULTI rw;
+	int32 rv;
+
+	rw.write = 0;
+	rw.count = count;
+	rw.values = values;
+	rw.chans = chans;
+	rw.error = 0;
+	if( (rv = ioctl( path, MDIS_RW_MULTI, &rw )) < 0 )
+		errno = DECOMPRESS_ERRNO(errno);
+	else if( rw.error )
+		errno = rw.error;
+
+	return rv;
+}
+
+/**********************************************************************/
+/** Write 32-bit integer values to several channels
+ *
+ * Like M_read_multi(), but writes \a values.
+ *
+ * \param path		device path number
+ * \param values	\a count values to write
+ * \param count		number of values (max. #MDIS_RW_MULTI_MAX)
+ * \param chans		channel list with \a count entries, or NULL
+ *
+ * \return number of values written (errno set if less than \a count)
+ *         or -1 on error (errno set)
+ * \sa M_read_multi, M_write
+ */
+int32 M_write_multi(MDIS_PATH path, const int32 *values, int32 count,
+					const int32 *chans)
+{
+	MDIS_LINUX_RW_MULTI rw;
+	int32 rv;
+
+	rw.write = 1;
+	rw.count = count;
+	rw.values = (int32 *)values;
+	rw.chans = chans;
+	rw.error = 0;
+	if( (rv = ioctl( path, MDIS_RW_MULTI, &rw )) < 0 )
+		errno = DECOMPRESS_ERRNO(errno);
+	else if( rw.error )
+		errno = rw.error;
+
+	return rv;
+}
+
+/**********************************************************************/
+/** Get several standard status codes from device
+ *
+ * Executes the getstats of \a entries in order, locking the device only
+ * once for consecutive low level driver codes. For each entry, \a chan
+ * selects the channel (-1 for the path's current channel), \a value
+ * is passed to and returned from the driver and \a error receives the
+ * entry's MDIS error code. Block codes are not supported.
+ *
+ * \param path		device path number
+ * \param entries	array of entries
+ * \param count		number of entries (max. #MDIS_SGSTAT_BATCH_MAX)
+ *
+ * \return number of failed entries or -1 on error (errno set)
+ * \sa M_setstat_multi, M_getstat
+ */
+int32 M_getstat_multi(MDIS_PATH path, MDIS_SGSTAT_ENTRY *entries, int32 count)
+{
+	MDIS_LINUX_SGSTAT_BATCH batch;
+	int32 rv;
+
+	batch.setStat = 0;
+	batch.count = count;
+	batch.entries = entries;
+	if( (rv = ioctl( path, MDIS_SGSTAT_BATCH, &batch )) < 0 )
+		errno = DECOMPRESS_ERRNO(errno);
+
+	return rv;
+}
+
+/**********************************************************************/
+/** Set several standard status codes of device
+ *
+ * Like M_getstat_multi(), but executes setstats. \a value of each
+ * entry is the value to set.
+ *
+ * \param path		device path number
+ * \param entries	array of entries
+ * \param count		number of entries (max. #MDIS_SGSTAT_BATCH_MAX)
+ *
+ * \return number of failed entries or -1 on error (errno set)
+ * \sa M_getstat_multi, M_setstat
+ */
+int32 M_setstat_multi(MDIS_PATH path, MDIS_SGSTAT_ENTRY *entries, int32 count)
+{
+	MDIS_LINUX_SGSTAT_BATCH batch;
+	int32 rv;
+
+	batch.setStat = 1;
+	batch.count = count;
+	batch.entries = entries;
+	if( (rv = ioctl( path, MDIS_SGSTAT_BATCH, &batch )) < 0 )
+		errno = DECOMPRESS_ERRNO(errno);
+
+	return rv;
+}
+
 /**********************************************************************/
 /** Read data block from device
  *	
@@ -195,7 +195,7 @@ int32 MDIS_RemoveSysirq(MK_DEV *dev)
 
 /********************************* MDIS_TermLockMode *************************
  *
- *  Description: Delete locking semaphores
+ *  Description: Delete process locks
  *			
  *---------------------------------------------------------------------------
  *  Input......: dev			device structure
@@ -206,25 +206,27 @@ void MDIS_TermLockMode( MK_DEV *dev )
 {
 	int32 n;
 
+	if( dev->noDevSem && !dev->noDevLock )
+		MK_PROCLOCK_EXIT( &dev->lockDev );
+
 	switch(dev->lockMode) {
 	case LL_LOCK_NONE:
 		break;
 
 	case LL_LOCK_CALL:
-		if( dev->semRead ) 		OSS_SemRemove( dev->osh, &dev->semRead );
-		if( dev->semWrite ) 	OSS_SemRemove( dev->osh, &dev->semWrite );
-		if( dev->semBlkRead ) 	OSS_SemRemove( dev->osh, &dev->semBlkRead );
-		if( dev->semBlkWrite ) 	OSS_SemRemove( dev->osh, &dev->semBlkWrite );
-		if( dev->semSetStat ) 	OSS_SemRemove( dev->osh, &dev->semSetStat );
-		if( dev->semGetStat ) 	OSS_SemRemove( dev->osh, &dev->semGetStat );
+		MK_PROCLOCK_EXIT( &dev->lockRead );
+		MK_PROCLOCK_EXIT( &dev->lockWrite );
+		MK_PROCLOCK_EXIT( &dev->lockBlkRead );
+		MK_PROCLOCK_EXIT( &dev->lockBlkWrite );
+		MK_PROCLOCK_EXIT( &dev->lockSetStat );
+		MK_PROCLOCK_EXIT( &dev->lockGetStat );
 		break;
 	case LL_LOCK_CHAN:
-		if( dev->semChanP ){
-			for( n=0; n<dev->devNrChan; n++ ){
-				if( dev->semChanP[n] )
-					OSS_SemRemove( dev->osh, &dev->semChanP[n]);
-			}
-			OSS_MemFree( dev->osh, dev->semChanP, dev->semChanAlloc );
+		if( dev->lockChanP ){
+			for( n=0; n<dev->devNrChan; n++ )
+				MK_PROCLOCK_EXIT( &dev->lockChanP[n] );
+			OSS_MemFree( dev->osh, dev->lockChanP, dev->lockChanAlloc );
+			dev->lockChanP = NULL;
 		}
 		break;
 	}
@@ -38,10 +38,12 @@ MAK_INP3=close$(INP_SUFFIX)
 MAK_INP4=mk_calls$(INP_SUFFIX)
 MAK_INP5=ident$(INP_SUFFIX)
 MAK_INP6=mk_nonmdis$(INP_SUFFIX)
+MAK_INP7=mk_bufpool$(INP_SUFFIX)
 
 MAK_INP=$(MAK_INP1) \
         $(MAK_INP2) \
         $(MAK_INP3) \
         $(MAK_INP4) \
         $(MAK_INP5) \
-        $(MAK_INP6)
+        $(MAK_INP6) \
+        $(MAK_INP7)
@@ -0,0 +1,420 @@
+/*********************  P r o g r a m  -  M o d u l e ***********************
+ *
+ *         Name: mk_bufpool.c
+ *      Project: MDIS4LINUX
+ *
+ *       Author: kp
+ *
+ *  Description: MDIS kernel user buffer pool
+ *
+ *				 Buffers for M_getblock/M_setblock and block get/setstats
+ *				 are taken from size classes of PAGE_SIZE << n. Small
+ *				 classes keep a magazine of free buffers per CPU, so the
+ *				 common case needs no shared lock. Magazine misses and all
+ *				 larger classes use the spin lock protected free list of
+ *				 the class. Requests above the largest class are vmalloc'ed.
+ *
+ *				 Magazines count against the free buffers kept per class
+ *				 (mk_pool_keep or mk_pool_bufs): the magazine depth is
+ *				 mk_pool_mag, but at most the kept buffers divided by the
+ *				 number of CPUs, and the free list keeps the rest. With
+ *				 many CPUs, raise mk_pool_keep to get magazines at all.
+ *
+ *     Required: -
+ *     Switches: DBG
+ *
+ *---------------------------------------------------------------------------
+ * Copyright (c) 2000-2019, MEN Mikro Elektronik GmbH
+ ******************************************************************************/
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/percpu.h>
+#include <linux/spinlock.h>
+#include <linux/mm.h>
+#include "mk_intern.h"
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+#define MK_POOL_CLASSES		11	/* PAGE_SIZE .. PAGE_SIZE<<10 (4MB) */
+#define MK_POOL_MAG_CLASSES	5	/* classes with per-CPU magazines (64K) */
+#define MK_POOL_MAG_SIZE	8	/* max. buffers per magazine */
+
+#ifndef PAGE_ALLOC_COSTLY_ORDER
+# define PAGE_ALLOC_COSTLY_ORDER 3	/* < 2.6.23 */
+#endif
+
+/*--------------------------------------+
+|   TYPDEFS                             |
++--------------------------------------*/
+
+/* per-CPU part of a size class */
+typedef struct {
+	void *buf[MK_POOL_MAG_SIZE];	/* free buffers */
+	int cnt;						/* number of buffers in buf[] */
+	unsigned long hits;				/* requests served from pool */
+	unsigned long misses;			/* requests allocated from system */
+} MK_POOL_MAG;
+
+/* size class */
+typedef struct {
+	u_int32 size;				/* buffer size */
+	int order;					/* page order of size */
+	int magSize;				/* magazine depth, 0=no magazines */
+	MK_POOL_MAG *pcpu;			/* per-CPU magazines (alloc_percpu) */
+	spinlock_t lock;			/* protects freeList, nFree */
+	void *freeList;				/* free buffers, linked by first word */
+	int nFree;					/* number of buffers in freeList */
+	int maxFree;				/* max. buffers kept in freeList, without
+								   the magazines */
+	atomic_t nTotal;			/* buffers allocated from system */
+} MK_POOL_CLASS;
+
+/*--------------------------------------+
+|   GLOBALS                             |
++--------------------------------------*/
+static MK_POOL_CLASS G_pool[MK_POOL_CLASSES];
+static atomic_t G_poolOversize;	/* requests above largest class */
+
+/*--- Module parameters ---*/
+static int mk_pool_bufs[MK_POOL_CLASSES];	/* buffers to preallocate */
+static int mk_pool_keep = 8;	/* free buffers kept per class */
+static int mk_pool_mag = MK_POOL_MAG_SIZE;	/* max. magazine depth */
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(2,6,14)
+MODULE_PARM( mk_pool_bufs, "1-" __MODULE_STRING(MK_POOL_CLASSES) "i" );
+MODULE_PARM_DESC(mk_pool_bufs, "number of user buffers to preallocate per "
+				 "size class (PAGE_SIZE<<n)");
+MODULE_PARM( mk_pool_keep, "i" );
+MODULE_PARM_DESC(mk_pool_keep, "max. number of free user buffers kept per "
+				 "size class");
+MODULE_PARM( mk_pool_mag, "i" );
+MODULE_PARM_DESC(mk_pool_mag, "max. free user buffers per CPU and size class "
+				 "up to 64K (0.." __MODULE_STRING(MK_POOL_MAG_SIZE) ", counted "
+				 "in mk_pool_keep)");
+#else
+module_param_array( mk_pool_bufs, int, NULL, 0444 );
+MODULE_PARM_DESC(mk_pool_bufs, "number of user buffers to preallocate per "
+				 "size class (PAGE_SIZE<<n)");
+module_param( mk_pool_keep, int, 0444 );
+MODULE_PARM_DESC(mk_pool_keep, "max. number of free user buffers kept per "
+				 "size class");
+module_param( mk_pool_mag, int, 0444 );
+MODULE_PARM_DESC(mk_pool_mag, "max. free user buffers per CPU and size class "
+				 "up to 64K (0.." __MODULE_STRING(MK_POOL_MAG_SIZE) ", counted "
+				 "in mk_pool_keep)");
+#endif
+
+/*--------------------------------------+
+|   PROTOTYPES                          |
++--------------------------------------*/
+static void *PoolAlloc( MK_POOL_CLASS *pc );
+static void PoolFree( MK_POOL_CLASS *pc, void *buf );
+
+/******************************** PoolAlloc *********************************
+ *
+ *  Description:  Allocate a buffer of size class from system
+ *
+ *  Tries physically contiguous pages first, larger classes fall back
+ *  to vmalloc when memory is fragmented. Costly orders don't retry or
+ *  compact hard, vmalloc is cheaper than stalling in reclaim.
+ *---------------------------------------------------------------------------
+ *  Input......:  pc			size class
+ *  Output.....:  returns		buffer or NULL if no memory
+ *  Globals....:  -
+ ****************************************************************************/
+static void *PoolAlloc( MK_POOL_CLASS *pc )
+{
+	gfp_t gfp = GFP_KERNEL | __GFP_NOWARN;
+	void *buf;
+
+	if( pc->order > PAGE_ALLOC_COSTLY_ORDER )
+		gfp |= __GFP_NORETRY;
+
+	buf = (void *)__get_free_pages( gfp, pc->order );
+	if( buf == NULL && pc->order > 0 )
+		buf = vmalloc( pc->size );
+
+	if( buf != NULL )
+		atomic_inc( &pc->nTotal );
+	return buf;
+}
+
+/******************************** PoolFree **********************************
+ *
+ *  Description:  Return buffer from PoolAlloc to system
+ *---------------------------------------------------------------------------
+ *  Input......:  pc			size class
+ *				  buf			buffer
+ *  Output.....:  -
+ *  Globals....:  -
+ ****************************************************************************/
+static void PoolFree( MK_POOL_CLASS *pc, void *buf )
+{
+	if( is_vmalloc_addr( buf ))
+		vfree( buf );
+	else
+		free_pages( (unsigned long)buf, pc->order );
+
+	atomic_dec( &pc->nTotal );
+}
+
+/******************************** MDIS_GetUsrBuf ****************************
+ *
+ *  Description:  Allocate a buffer for copying user space to kernel space
+ *
+ *  The buffer is taken from the CPU's magazine or the free list of the
+ *  smallest fitting size class. If both are empty, a new buffer is
+ *  allocated. Requests above the largest class are vmalloc'ed.
+ *---------------------------------------------------------------------------
+ *  Input......:  size			size of requested buffer in bytes
+ *  Output.....:  returns		ptr to buffer or NULL if no memory
+ *				  *bufIdP		a buffer ID that has to be passed to
+ *								MDIS_RelUsrBuf
+ *  Globals....:  G_pool
+ ****************************************************************************/
+void *MDIS_GetUsrBuf( u_int32 size, void **bufIdP )
+{
+	MK_POOL_CLASS *pc;
+	MK_POOL_MAG *mag;
+	void *buf = NULL;
+	int c;
+
+	for( c=0; c<MK_POOL_CLASSES && size > G_pool[c].size; c++ )
+		;
+
+	if( c == MK_POOL_CLASSES ){
+		atomic_inc( &G_poolOversize );
+		*bufIdP = (void *)-1;
+		return vmalloc( size );
+	}
+
+	pc = &G_pool[c];
+	*bufIdP = (void *)pc;
+
+	mag = per_cpu_ptr( pc->pcpu, get_cpu() );
+	if( mag->cnt > 0 )
+		buf = mag->buf[--mag->cnt];
+	else {
+		spin_lock( &pc->lock );
+		if( (buf = pc->freeList) != NULL ){
+			pc->freeList = *(void **)buf;
+			pc->nFree--;
+		}
+		spin_unlock( &pc->lock );
+	}
+
+	if( buf != NULL )
+		mag->hits++;
+	else
+		mag->misses++;
+	put_cpu();
+
+	if( buf == NULL )
+		buf = PoolAlloc( pc );
+
+	return buf;
+}
+
+/******************************** MDIS_RelUsrBuf ****************************
+ *
+ *  Description:  Return buffer allocated by MDIS_GetUsrBuf
+ *
+ *  The buffer goes to the CPU's magazine, or to the free list of its
+ *  size class. If the free list is full, it is returned to the system.
+ *---------------------------------------------------------------------------
+ *  Input......:  data			ptr to buffer to be returned
+ *				  bufId			Id that was returned by MDIS_GetUsrBuf
+ *  Output.....:  -
+ *  Globals....:  -
+ ****************************************************************************/
+void MDIS_RelUsrBuf( void *data, void *bufId )
+{
+	MK_POOL_CLASS *pc = (MK_POOL_CLASS *)bufId;
+	MK_POOL_MAG *mag;
+
+	if( bufId == (void *)-1 ){
+		vfree( data );
+		return;
+	}
+
+	mag = per_cpu_ptr( pc->pcpu, get_cpu() );
+	if( mag->cnt < pc->magSize ){
+		mag->buf[mag->cnt++] = data;
+		data = NULL;
+	}
+	else {
+		spin_lock( &pc->lock );
+		if( pc->nFree < pc->maxFree ){
+			*(void **)data = pc->freeList;
+			pc->freeList = data;
+			pc->nFree++;
+			data = NULL;
+		}
+		spin_unlock( &pc->lock );
+	}
+	put_cpu();
+
+	if( data != NULL )
+		PoolFree( pc, data );
+}
+
+/******************************** MDIS_PoolShow *****************************
+ *
+ *  Description:  Print user buffer pool statistics for /proc/mdis
+ *---------------------------------------------------------------------------
+ *  Input......:  buf			buffer, must hold 1000 chars
+ *  Output.....:  returns		number of chars written
+ *  Globals....:  G_pool
+ ****************************************************************************/
+int MDIS_PoolShow( char *buf )
+{
+	MK_POOL_CLASS *pc;
+	MK_POOL_MAG *mag;
+	unsigned long hits, misses;
+	int c, cpu, nFree, len = 0;
+
+	len += sprintf( buf+len, "User API Buffers:\n"
+					"  %8s %6s %6s %10s %10s\n",
+					"size", "total", "free", "hits", "misses" );
+
+	for( c=0; c<MK_POOL_CLASSES; c++ ){
+		pc = &G_pool[c];
+		hits = misses = 0;
+		nFree = pc->nFree;
+
+		for_each_possible_cpu( cpu ){
+			mag = per_cpu_ptr( pc->pcpu, cpu );
+			hits	+= mag->hits;
+			misses	+= mag->misses;
+			nFree	+= mag->cnt;
+		}
+
+		len += sprintf( buf+len, "  %8u %6d %6d %10lu %10lu\n",
+						pc->size, atomic_read( &pc->nTotal ), nFree,
+						hits, misses );
+	}
+	len += sprintf( buf+len, "  larger (vmalloc'ed): %d\n",
+					atomic_read( &G_poolOversize ));
+	return len;
+}
+
+/******************************** MDIS_PoolInit *****************************
+ *
+ *  Description:  Init user buffer pool, preallocate buffers
+ *---------------------------------------------------------------------------
+ *  Input......:  nbufs			number of buffers to preallocate in the
+ *								smallest class (in addition to mk_pool_bufs)
+ *  Output.....:  returns		0=ok, or negative error number
+ *  Globals....:  G_pool, mk_pool_bufs, mk_pool_keep, mk_pool_mag
+ ****************************************************************************/
+int MDIS_PoolInit( int nbufs )
+{
+	MK_POOL_CLASS *pc;
+	void *buf;
+	int c, n, prealloc, keep, magSize;
+
+	atomic_set( &G_poolOversize, 0 );
+
+	if( mk_pool_mag < 0 )
+		mk_pool_mag = 0;
+	if( mk_pool_mag > MK_POOL_MAG_SIZE )
+		mk_pool_mag = MK_POOL_MAG_SIZE;
+
+	for( c=0; c<MK_POOL_CLASSES; c++ ){
+		pc = &G_pool[c];
+		prealloc = mk_pool_bufs[c] + (c == 0 ? nbufs : 0);
+
+		keep = prealloc > mk_pool_keep ? prealloc : mk_pool_keep;
+
+		/* magazines count against the buffers kept */
+		magSize = 0;
+		if( c < MK_POOL_MAG_CLASSES )
+			magSize = min( mk_pool_mag, keep / (int)num_possible_cpus() );
+
+		pc->size	= PAGE_SIZE << c;
+		pc->order	= c;
+		pc->magSize	= magSize;
+		pc->freeList = NULL;
+		pc->nFree	= 0;
+		pc->maxFree	= keep - magSize * (int)num_possible_cpus();
+		spin_lock_init( &pc->lock );
+		atomic_set( &pc->nTotal, 0 );
+
+		if( (pc->pcpu = alloc_percpu( MK_POOL_MAG )) == NULL )
+			goto CLEANUP;
+
+		for( n=0; n<prealloc; n++ ){
+			if( (buf = PoolAlloc( pc )) == NULL ){
+				printk( KERN_INFO "Could not allocate user buffer %d of "
+						"%u bytes\n", n, pc->size );
+				goto CLEANUP;
+			}
+			*(void **)buf = pc->freeList;
+			pc->freeList = buf;
+			pc->nFree++;
+		}
+	}
+	return 0;
+
+ CLEANUP:
+	MDIS_PoolExit();
+	return -ENOMEM;
+}
+
+/******************************** MDIS_PoolExit *****************************
+ *
+ *  Description:  Free all buffers of user buffer pool
+ *---------------------------------------------------------------------------
+ *  Input......:  -
+ *  Output.....:  -
+ *  Globals....:  G_pool
+ ****************************************************************************/
+void MDIS_PoolExit( void )
+{
+	MK_POOL_CLASS *pc;
+	MK_POOL_MAG *mag;
+	void *buf;
+	int c, cpu;
+
+	for( c=0; c<MK_POOL_CLASSES; c++ ){
+		pc = &G_pool[c];
+
+		if( pc->pcpu == NULL )
+			continue;
+
+		for_each_possible_cpu( cpu ){
+			mag = per_cpu_ptr( pc->pcpu, cpu );
+			while( mag->cnt > 0 )
+				PoolFree( pc, mag->buf[--mag->cnt] );
+		}
+
+		while( (buf = pc->freeList) != NULL ){
+			pc->freeList = *(void **)buf;
+			PoolFree( pc, buf );
+		}
+		pc->nFree = 0;
+
+		if( atomic_read( &pc->nTotal ) != 0 )
+			printk( KERN_ERR "*** MEN MDIS Kernel: %d user bufs of %u bytes "
+					"not free'd\n", atomic_read( &pc->nTotal ), pc->size );
+
+		free_percpu( pc->pcpu );
+		pc->pcpu = NULL;
+	}
+}
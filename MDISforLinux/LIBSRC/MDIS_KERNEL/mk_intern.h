@@ -40,6 +40,12 @@
 #include <linux/fcntl.h>        /* O_ACCMODE */
 #include <linux/kmod.h>
 #include <linux/interrupt.h>
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,16)
+#include <linux/mutex.h>
+#endif
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,18)
+#include <linux/rtmutex.h>
+#endif
 
 #include <asm/fixmap.h>     /* fix_to_virt() */
 #if LINUX_VERSION_CODE < KERNEL_VERSION(4,10,0)
@@ -85,6 +91,36 @@
 
 #define MK_DRV_PREFIX	"men_ll_"
 
+/*
+ * process locks (LL_LOCK_CALL/LL_LOCK_CHAN) and device lock of LL drivers
+ * without devSemHdl. Use rt_mutex if available, so a high priority caller
+ * boosts a low priority lock holder.
+ * MK_PROCLOCK_TAKE returns non-zero if interrupted by a signal.
+ */
+#if defined(CONFIG_RT_MUTEXES) && LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,18)
+typedef struct rt_mutex MK_PROCLOCK;
+# define MK_PROCLOCK_INIT(l)		rt_mutex_init(l)
+# define MK_PROCLOCK_EXIT(l)		do {} while(0)
+# if LINUX_VERSION_CODE >= KERNEL_VERSION(3,16,0)
+#  define MK_PROCLOCK_TAKE(l)		rt_mutex_lock_interruptible(l)
+# else
+#  define MK_PROCLOCK_TAKE(l)		rt_mutex_lock_interruptible(l,0)
+# endif
+# define MK_PROCLOCK_RELEASE(l)	rt_mutex_unlock(l)
+#elif LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,16)
+typedef struct mutex MK_PROCLOCK;
+# define MK_PROCLOCK_INIT(l)		mutex_init(l)
+# define MK_PROCLOCK_EXIT(l)		mutex_destroy(l)
+# define MK_PROCLOCK_TAKE(l)		mutex_lock_interruptible(l)
+# define MK_PROCLOCK_RELEASE(l)	mutex_unlock(l)
+#else
+typedef struct semaphore MK_PROCLOCK;
+# define MK_PROCLOCK_INIT(l)		sema_init(l,1)
+# define MK_PROCLOCK_EXIT(l)		do {} while(0)
+# define MK_PROCLOCK_TAKE(l)		down_interruptible(l)
+# define MK_PROCLOCK_RELEASE(l)	up(l)
+#endif
+
 /* SPACE.flags */
 #define MK_MAPPED		0x1
 #define MK_REQUESTED	0x2
@@ -139,15 +175,19 @@ typedef struct {
 	OSS_HANDLE		*osh;			/* device's OSS handle */
 
 	u_int32			lockMode;		/* device locking mode  */
+	u_int32			lockCaps;		/* MK_LL_LOCK_xxx from M_LL_LOCK_CAPS */
+	int				noDevSem;		/* lock lockDev instead of semDev */
+	int				noDevLock;		/* no device lock at all (reentrant LL) */
 	OSS_SEM_HANDLE *semDev;			/* device semaphore */
-	OSS_SEM_HANDLE *semRead;		/* read semaphore (call locking) */
-	OSS_SEM_HANDLE *semWrite;		/* write semaphore (call locking) */
-	OSS_SEM_HANDLE *semBlkRead;		/* blockread semaphore (call locking) */
-	OSS_SEM_HANDLE *semBlkWrite;	/* blockwrite semaphore (call locking) */
-	OSS_SEM_HANDLE *semSetStat;		/* setstat semaphore (call locking) */
-	OSS_SEM_HANDLE *semGetStat;		/* getstat semaphore (call locking) */
-	OSS_SEM_HANDLE **semChanP;		/* chan semaphore array (chan locking) */
-	u_int32			semChanAlloc;	/* size allocated for semChanP */
+	MK_PROCLOCK		lockDev;		/* device lock if noDevSem */
+	MK_PROCLOCK		lockRead;		/* read lock (call locking) */
+	MK_PROCLOCK		lockWrite;		/* write lock (call locking) */
+	MK_PROCLOCK		lockBlkRead;	/* blockread lock (call locking) */
+	MK_PROCLOCK		lockBlkWrite;	/* blockwrite lock (call locking) */
+	MK_PROCLOCK		lockSetStat;	/* setstat lock (call locking) */
+	MK_PROCLOCK		lockGetStat;	/* getstat lock (call locking) */
+	MK_PROCLOCK		*lockChanP;		/* chan lock array (chan locking) */
+	u_int32			lockChanAlloc;	/* size allocated for lockChanP */
 	/* device params */
 	u_int32			devSlot;		/* device slot number on board */
 	u_int32			subDevOffset; 	/* subdevice address offset 0 */
@@ -190,6 +230,7 @@ typedef struct {
 	MK_DRV			*drv;			/* driver structure */
 	LL_ENTRY		llJumpTbl;		/* ll driver's jump table */
 	LL_HANDLE		*ll;			/* ll driver's handle */
+	u_int32			blkCaps;		/* MK_LL_BLK_xxx from M_LL_BLK_CAPS */
 	int			initialized; 	/* flags device sucessfuly initialized */
 	int			exceptionOccurred; /* number of exception interrupts */
 } MK_DEV;
@@ -237,13 +278,20 @@ irqreturn_t MDIS_IrqHandler( int irq, void *dev_id, struct pt_regs *regs );
 
 #define MDIS_IRQFUNC MDIS_IrqHandler
 
-int32 MDIS_DevLock( MK_PATH *mkPath, OSS_SEM_HANDLE *callSem );
-void MDIS_DevUnLock( MK_PATH *mkPath, OSS_SEM_HANDLE *callSem );
+int32 MDIS_DevLock( MK_PATH *mkPath, MK_PROCLOCK *callLock );
+void MDIS_DevUnLock( MK_PATH *mkPath, MK_PROCLOCK *callLock );
 int32 MDIS_LlGetStat(MK_PATH *mkPath, int32 code, INT32_OR_64 *valueP);
 int32 MDIS_BbGetStat(MK_PATH *mkPath, int32 code, INT32_OR_64 *valueP);
 int32 MDIS_LlSetStat(MK_PATH *mkPath, int32 code, void *value);
 int32 MDIS_BbSetStat(MK_PATH *mkPath, int32 code, void *value);
 
+/* mk_bufpool.c */
+void *MDIS_GetUsrBuf( u_int32 size, void **bufIdP );
+void MDIS_RelUsrBuf( void *data, void *bufId );
+int MDIS_PoolInit( int nbufs );
+void MDIS_PoolExit( void );
+int MDIS_PoolShow( char *buf );
+
 /* open.c */
 int32 MDIS_InitialOpen(
 	char *devName,
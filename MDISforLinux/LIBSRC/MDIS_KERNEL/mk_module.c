@@ -41,19 +41,19 @@
 #include <linux/cdev.h>
 #include <linux/moduleparam.h>
 #include <linux/uaccess.h>
+#include <linux/mm.h>
+#include <linux/highmem.h>
 
 /*--------------------------------------+
 |   DEFINES                             |
 +--------------------------------------*/
 
-#define PROC_BUF_LEN   2028  /* local buffer for new proc read fops read function */
+#define PROC_BUF_LEN   4096  /* local buffer for new proc read fops read function */
 
-/*
- * the maximum size of a M_getblock/M_setblock or block Get/Setstat call
- * that will fit into the statically allocated users buffers. Larger requests
- * will be kmalloc'ed or vmalloc'ed
- */
-#define MK_USRBUF_SIZE (PAGE_SIZE-sizeof(OSS_DL_NODE))
+/* pin_user_pages() for zero-copy block i/o */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,6,0)
+# define MK_PIN_USER_PAGES
+#endif
 
 /* Sanity check: ElinOS allows devfs still
  * to be selected in the elk even for kernels 2.6.x where its gone
@@ -66,7 +66,15 @@
 |   TYPDEFS                             |
 +--------------------------------------*/
 
-/* none */
+/* buffer passed to LL driver's blockRead/blockWrite */
+typedef struct {
+	void *data;				/* buffer for LL driver */
+	void *bufId;			/* MDIS_GetUsrBuf id of bounce buffer */
+	struct page **pages;	/* pinned user pages (zero-copy) or NULL */
+	void *pagesId;			/* MDIS_GetUsrBuf id of pages array */
+	int nPages;				/* number of pinned pages */
+	void *vaddr;			/* kernel mapping of pages */
+} MK_BLKBUF;
 
 /*--------------------------------------+
 |   EXTERNALS                           |
@@ -79,7 +87,8 @@
 +--------------------------------------*/
 
 /*--- Module parameters ---*/
-static int mk_nbufs 	= 	16;		/* number of static users buffers to allocate*/
+static int mk_nbufs 	= 	16;		/* number of page sized users buffers to allocate*/
+static int mk_zcmin		=	32768;	/* min. size for zero-copy block i/o */
 int mk_dbglevel 	=	OSS_DBG_DEFAULT;/* debug level */
 
 static dev_t first;  		/* Global variable for the first device number */
@@ -92,11 +101,17 @@ MODULE_PARM( mk_nbufs, "i" );
 MODULE_PARM_DESC(mk_nbufs, "number of static users buffers to allocate");
 MODULE_PARM( mk_dbglevel, "i" );
 MODULE_PARM_DESC(mk_dbglevel, "MDIS kernel debug level");
+MODULE_PARM( mk_zcmin, "i" );
+MODULE_PARM_DESC(mk_zcmin, "min. M_getblock/M_setblock size for zero-copy "
+				 "(0=off)");
 #else
 module_param( mk_nbufs, int, 0664 );
 MODULE_PARM_DESC(mk_nbufs, "number of static users buffers to allocate");
 module_param( mk_dbglevel, int, 0664 );
 MODULE_PARM_DESC(mk_dbglevel, "MDIS kernel debug level");
+module_param( mk_zcmin, int, 0664 );
+MODULE_PARM_DESC(mk_zcmin, "min. M_getblock/M_setblock size for zero-copy "
+				 "(0=off)");
 #endif
 
 OSS_HANDLE	*G_osh;			/* MK's OSS handle */
@@ -105,7 +120,6 @@ OSS_SEM_HANDLE  *G_mkLockSem; 		/* global MK sempahore */
 OSS_SEM_HANDLE  *G_mkIoctlSem; 		/* MK ioctl sempahore */
 OSS_DL_LIST	G_drvList;		/* list of reg. LL drivers */
 OSS_DL_LIST	G_devList;		/* list of devices */
-OSS_DL_LIST	G_freeUsrBufList;	/* list of free user buffers */
 
 #ifdef CONFIG_DEVFS_FS
 # if LINUX_VERSION_CODE < KERNEL_VERSION(2,6,0)
@@ -121,11 +135,15 @@ static int MDIS_OpenDevice( int ioctlCode,
 							unsigned long usrMop, MK_PATH **mkPathP );
 static int MDIS_GetStat( MK_PATH *mkPath, unsigned long arg );
 static int MDIS_SetStat( MK_PATH *mkPath, unsigned long arg );
+static int MDIS_SgStatBatch( MK_PATH *mkPath, unsigned long arg );
 
 static int MDIS_Read( MK_PATH *mkPath, unsigned long arg );
 static int MDIS_Write( MK_PATH *mkPath, unsigned long arg );
-static void *MDIS_GetUsrBuf( u_int32 size, void **bufIdP );
-static void MDIS_RelUsrBuf( void *data, void *bufId );
+static int MDIS_RwMulti( MK_PATH *mkPath, unsigned long arg );
+static int MDIS_GetBlkBuf( MK_DEV *dev, const char *buf, size_t count,
+						   int toUser, MK_BLKBUF *bb );
+static void MDIS_RelBlkBuf( MK_BLKBUF *bb, int dirty );
+static void MDIS_SyncBlkBuf( MK_BLKBUF *bb, int before, int toUser );
 
 #if defined(PPC)
 static int CompressErrno(int mdisErr);
@@ -251,6 +269,10 @@ int mk_ioctl (
 		ret = MDIS_SetStat( mkPath, arg );
 		break;
 
+	case MDIS_SGSTAT_BATCH:
+		ret = MDIS_SgStatBatch( mkPath, arg );
+		break;
+
 	case MDIS_READ:
 		ret = MDIS_Read( mkPath, arg );
 		break;
@@ -259,6 +281,10 @@ int mk_ioctl (
 		ret = MDIS_Write( mkPath, arg );
 		break;
 
+	case MDIS_RW_MULTI:
+		ret = MDIS_RwMulti( mkPath, arg );
+		break;
+
 	case MDIS_OPEN_DEVICE:
 	case MDIS_CREATE_DEVICE:
 		/*
@@ -379,8 +405,7 @@ static ssize_t mk_read (
 	size_t count,
 	loff_t *pos)
 {
-	void *data = NULL;
-	void *bufId = NULL;
+	MK_BLKBUF bb;
 	int32 error;
 	MK_DEV *dev;
 	MK_PATH *mkPath;
@@ -394,24 +419,27 @@ static ssize_t mk_read (
 
 	DBGWRT_1((DBH,"MDIS_ReadBlock %s max %d\n", dev->devName, count ));
 
-	/*--- allocate buffer for LL driver ---*/
-	if( (data = MDIS_GetUsrBuf( count, &bufId )) == NULL )
+	/*--- get buffer for LL driver (user pages or bounce buffer) ---*/
+	if( MDIS_GetBlkBuf( dev, buf, count, TRUE, &bb ) != 0 )
 		return -ENOMEM;
 
-	if( (error = MDIS_DevLock( mkPath, dev->semBlkRead )) == 0 ) {
+	if( (error = MDIS_DevLock( mkPath, &dev->lockBlkRead )) == 0 ) {
 
 		/*--- call LL driver's blockRead ---*/
-		error = dev->llJumpTbl.blockRead( dev->ll, mkPath->chan, data,
+		MDIS_SyncBlkBuf( &bb, TRUE, TRUE );
+		error = dev->llJumpTbl.blockRead( dev->ll, mkPath->chan, bb.data,
 						  count, &readCount);
+		MDIS_SyncBlkBuf( &bb, FALSE, TRUE );
 
-		MDIS_DevUnLock( mkPath, dev->semBlkRead );
+		MDIS_DevUnLock( mkPath, &dev->lockBlkRead );
 	}
 
-	if( error == 0 ){
-		if( __copy_to_user( buf, data, readCount ))
+	if( error == 0 && bb.pages == NULL ){
+		if( __copy_to_user( buf, bb.data, readCount ))
 			error = EFAULT;
 	}
-	MDIS_RelUsrBuf( data, bufId );
+	/* LL driver may have written to the user pages even on error */
+	MDIS_RelBlkBuf( &bb, TRUE );
 
 	error = COMPRESS_ERRNO(error);		/* make errno for PPC < 515  */
 	DBGWRT_1((DBH,"MDIS_ReadBlock ex %s error 0x%x %d bytes read\n",
@@ -438,8 +466,7 @@ static ssize_t mk_write (
 	size_t count,
 	loff_t *pos)
 {
-	void *data = NULL;
-	void *bufId = NULL;
+	MK_BLKBUF bb;
 	int32 error;
 	MK_DEV *dev;
 	MK_PATH *mkPath;
@@ -453,25 +480,26 @@ static ssize_t mk_write (
 
 	DBGWRT_1((DBH,"MDIS_WriteBlock %s max %d\n", dev->devName, count ));
 
-	/*--- allocate buffer for LL driver ---*/
-	if( (data = MDIS_GetUsrBuf( count, &bufId )) == NULL )
+	/*--- get buffer for LL driver (user pages or bounce buffer) ---*/
+	if( MDIS_GetBlkBuf( dev, buf, count, FALSE, &bb ) != 0 )
 		return -ENOMEM;
 
-	if( copy_from_user( data, buf, count ) == 0 ){
+	if( bb.pages || copy_from_user( bb.data, buf, count ) == 0 ){
 
-		if( (error = MDIS_DevLock( mkPath, dev->semBlkWrite )) == 0 ) {
+		if( (error = MDIS_DevLock( mkPath, &dev->lockBlkWrite )) == 0 ) {
 
 			/*--- call LL driver's blockWrite ---*/
-			error = dev->llJumpTbl.blockWrite( dev->ll, mkPath->chan, data,
+			MDIS_SyncBlkBuf( &bb, TRUE, FALSE );
+			error = dev->llJumpTbl.blockWrite( dev->ll, mkPath->chan, bb.data,
 											   count, &writeCount);
 
-			MDIS_DevUnLock( mkPath, dev->semBlkWrite );
+			MDIS_DevUnLock( mkPath, &dev->lockBlkWrite );
 		}
 	}
 	else
 		error = EFAULT;
 
-	MDIS_RelUsrBuf( data, bufId );
+	MDIS_RelBlkBuf( &bb, FALSE );
 
 	error = COMPRESS_ERRNO(error);		/* make errno for PPC < 515  */
 	DBGWRT_1((DBH,"MDIS_WriteBlock ex %s error 0x%x %d bytes written\n",
@@ -481,66 +509,143 @@ static ssize_t mk_write (
 }
 
 
-/****************************** MDIS_GetUsrBuf *******************************
+/****************************** MDIS_GetBlkBuf *******************************
  *
- *  Description:  Allocate a buffer for copying user space to kernel space
+ *  Description:  Get buffer for LL driver's blockRead/blockWrite
  *
- *  If the requested size is <= (PAGE_SIZE-4) a statically allocated buffer
- *  from the MK buffer pool will be used.
- *  Otherwise is the buffer is smaller 130000 bytes, the buffer is kmalloc'ed.
- *  Bigger buffers are vmalloc'ed (slower, but unlimited in size)
+ *  If the LL driver reports MK_LL_BLK_ZEROCOPY and the request has at
+ *  least mk_zcmin bytes, the user pages are pinned and mapped into
+ *  kernel space, so no copy is needed. Otherwise (or if the user buffer
+ *  can't be pinned) a bounce buffer from MDIS_GetUsrBuf is used.
  *---------------------------------------------------------------------------
- *  Input......:  size			size of requested buffer in bytes
- *  Output.....:  returns		ptr to buffer or NULL if no memory
- *				  *bufIdP		a buffer ID that has to be passed to
- *								MDIS_RelUsrBuf
- *  Globals....:  -
+ *  Input......:  dev			device structure
+ *				  buf			user buffer
+ *				  count			size of user buffer
+ *				  toUser		TRUE if LL driver writes to buffer
+ *  Output.....:  returns		0=ok, or negative error number
+ *				  *bb			buffer (bb->pages is NULL for bounce buffer)
+ *  Globals....:  mk_zcmin
  ****************************************************************************/
-static void *MDIS_GetUsrBuf( u_int32 size, void **bufIdP )
+static int MDIS_GetBlkBuf(
+	MK_DEV *dev,
+	const char *buf,
+	size_t count,
+	int toUser,
+	MK_BLKBUF *bb)
 {
-	void *buf = NULL;
-	OSS_DL_NODE *node;
+	unsigned long uaddr = (unsigned long)buf;
+	int nPages;
+
+	memset( bb, 0, sizeof(*bb) );
 
-	*bufIdP = NULL;
+	if( (dev->blkCaps & MK_LL_BLK_ZEROCOPY) && mk_zcmin > 0 &&
+		count >= (size_t)mk_zcmin ){
 
-	if( size <= MK_USRBUF_SIZE ){
-		if( (node = OSS_DL_RemHead( &G_freeUsrBufList )) != NULL ){
-			buf = (void *)(node+1);
-			*bufIdP = (void *)node;
+		nPages = ((uaddr & ~PAGE_MASK) + count + ~PAGE_MASK) >> PAGE_SHIFT;
+
+		bb->pages = MDIS_GetUsrBuf( nPages * sizeof(struct page *),
+									&bb->pagesId );
+		if( bb->pages != NULL ){
+#ifdef MK_PIN_USER_PAGES
+			bb->nPages = pin_user_pages_fast( uaddr, nPages,
+											  toUser ? FOLL_WRITE : 0,
+											  bb->pages );
+#else
+			bb->nPages = get_user_pages_fast( uaddr, nPages, toUser,
+											  bb->pages );
+#endif
+			if( bb->nPages == nPages )
+				bb->vaddr = vmap( bb->pages, nPages, VM_MAP, PAGE_KERNEL );
+
+			if( bb->vaddr ){
+				bb->data = (char *)bb->vaddr + (uaddr & ~PAGE_MASK);
+				return 0;
+			}
+
+			/* e.g. I/O memory, use bounce buffer */
+			DBGWRT_2((DBH," MDIS_GetBlkBuf: can't pin %d pages\n", nPages));
+			MDIS_RelBlkBuf( bb, FALSE );
 		}
-		if( buf == NULL )
-			buf = kmalloc( size, GFP_KERNEL );
 	}
-	else if( size <= 130000 ){
-		buf = kmalloc( size, GFP_KERNEL );
-	}
-	else {
-		buf = vmalloc( size );
-		*bufIdP = (void *)-1;
-	}
-	return buf;
+
+	if( (bb->data = MDIS_GetUsrBuf( count, &bb->bufId )) == NULL )
+		return -ENOMEM;
+
+	return 0;
 }
 
-/****************************** MDIS_RelUsrBuf *******************************
+/****************************** MDIS_RelBlkBuf *******************************
  *
- *  Description:  Return buffer allocated by MDIS_GetUsrBuf
+ *  Description:  Return buffer from MDIS_GetBlkBuf
  *---------------------------------------------------------------------------
- *  Input......:  data			ptr to buffer to be returned
- *				  bufId			Id that was returned by MDIS_GetUsrBuf
+ *  Input......:  bb			buffer
+ *				  dirty			TRUE if LL driver has written to user pages
  *  Output.....:  -
  *  Globals....:  -
  ****************************************************************************/
-static void MDIS_RelUsrBuf( void *data, void *bufId )
+static void MDIS_RelBlkBuf( MK_BLKBUF *bb, int dirty )
 {
-	if( bufId == (void *)-1)
-		vfree( data );
-	else if (bufId)		
-		OSS_DL_AddTail( &G_freeUsrBufList, (OSS_DL_NODE *)bufId );
-	else
-		kfree( data );
+#ifndef MK_PIN_USER_PAGES
+	int i;
+#endif
+
+	if( bb->pages ){
+		if( bb->vaddr )
+			vunmap( bb->vaddr );
+
+#ifdef MK_PIN_USER_PAGES
+		if( bb->nPages > 0 )
+			unpin_user_pages_dirty_lock( bb->pages, bb->nPages, dirty );
+#else
+		for( i=0; i<bb->nPages; i++ ){
+			if( dirty )
+				set_page_dirty_lock( bb->pages[i] );
+			put_page( bb->pages[i] );
+		}
+#endif
+		MDIS_RelUsrBuf( bb->pages, bb->pagesId );
+	}
+	else if( bb->data )
+		MDIS_RelUsrBuf( bb->data, bb->bufId );
+
+	memset( bb, 0, sizeof(*bb) );
 }
 
 
+/****************************** MDIS_SyncBlkBuf ******************************
+ *
+ *  Description:  Keep kernel alias of pinned user pages coherent
+ *
+ *  On CPUs with virtually indexed caches, the vmap of MDIS_GetBlkBuf
+ *  aliases the user mapping. Before the LL call, lines of the alias are
+ *  written back, so none is evicted over data the LL driver transfers
+ *  (e.g. by DMA). After blockRead, data the LL driver wrote through the
+ *  alias is written back and stale alias lines are dropped. Nothing to
+ *  do for bounce buffers.
+ *---------------------------------------------------------------------------
+ *  Input......:  bb			buffer
+ *				  before		TRUE before, FALSE after LL call
+ *				  toUser		TRUE if LL driver writes to buffer
+ *  Output.....:  -
+ *  Globals....:  -
+ ****************************************************************************/
+static void MDIS_SyncBlkBuf( MK_BLKBUF *bb, int before, int toUser )
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,34)
+	int size = bb->nPages << PAGE_SHIFT;
+
+	if( bb->vaddr == NULL )
+		return;
+
+	if( before )
+		flush_kernel_vmap_range( bb->vaddr, size );
+	else if( toUser ){
+		flush_kernel_vmap_range( bb->vaddr, size );
+		invalidate_kernel_vmap_range( bb->vaddr, size );
+	}
+#endif
+}
+
 /****************************** MDIS_GetStat *********************************
  *
  *  Description:  Perform MDIS getstat call (API call M_getstat)
@@ -779,55 +884,193 @@ static int MDIS_SetStat( MK_PATH *mkPath, unsigned long arg )
 	return -error;
 }
 
+/****************************** MDIS_SgStatBatch *****************************
+ *
+ *  Description:  Perform several standard get- or setstats in one call
+ *				  (API calls M_getstat_multi/M_setstat_multi)
+ *
+ *  The device is locked once for a sequence of LL codes. In channel
+ *  locking mode, the lock is retaken when the channel changes. BB and MK
+ *  codes are executed unlocked, like in MDIS_GetStat/MDIS_SetStat.
+ *  Block codes are not supported and fail with ERR_MK_UNK_CODE.
+ *---------------------------------------------------------------------------
+ *  Input......:  mkPath		MDIS kernel path structure
+ *				  arg			user space ptr to MDIS_LINUX_SGSTAT_BATCH
+ *  Output.....:  returns		number of failed entries,
+ *								or negative error number
+ *  Globals....:  -
+ ****************************************************************************/
+static int MDIS_SgStatBatch( MK_PATH *mkPath, unsigned long arg )
+{
+	MK_DEV *dev = mkPath->dev;
+	MDIS_LINUX_SGSTAT_BATCH batch;
+	MDIS_SGSTAT_ENTRY *ent, *e;
+	MK_PATH lockPath = *mkPath;
+	MK_PROCLOCK *callLock;
+	void *bufId;
+	size_t size;
+	int32 chan, isLl;
+	int i, locked = 0, nErr = 0;
+
+	if( copy_from_user ((void *)&batch, (void *)arg, sizeof(batch)) )
+		return -EFAULT;
+
+	DBGWRT_1((DBH,"MDIS_SgStatBatch %s %s count=%ld\n", dev->devName,
+			  batch.setStat ? "set" : "get", batch.count ));
+
+	if( batch.count <= 0 || batch.count > MDIS_SGSTAT_BATCH_MAX )
+		return -EINVAL;
+
+	size = batch.count * sizeof(*ent);
+	if( (ent = MDIS_GetUsrBuf( size, &bufId )) == NULL )
+		return -ENOMEM;
+
+	if( copy_from_user( ent, batch.entries, size )){
+		nErr = -EFAULT;
+		goto CLEANUP;
+	}
+
+	callLock = batch.setStat ? &dev->lockSetStat : &dev->lockGetStat;
+
+	for( i=0, e=ent; i<batch.count; i++, e++ ){
+		chan = e->chan < 0 ? mkPath->chan : e->chan;
+		isLl = (e->code & 0x0f00) == M_OFFS_LL ||
+			(e->code & 0x0f00) == M_OFFS_DEV;
+
+		/* drop lock if not needed or held for another channel */
+		if( locked && (!isLl || (dev->lockMode == LL_LOCK_CHAN &&
+								 lockPath.chan != chan))){
+			MDIS_DevUnLock( &lockPath, callLock );
+			locked = 0;
+		}
+
+		if( (e->code & M_OFFS_BLK) || !(e->code & M_OFFS_STD) ){
+			e->error = ERR_MK_UNK_CODE;
+			goto next;
+		}
+		if( chan >= dev->devNrChan ){
+			e->error = ERR_MK_ILL_PARAM;
+			goto next;
+		}
+
+		lockPath.chan = chan;
+		if( isLl && !locked ){
+			if( (e->error = MDIS_DevLock( &lockPath, callLock )))
+				goto next;
+			locked = 1;
+		}
+
+		switch( e->code & 0x0f00 ){
+		case M_OFFS_LL:
+		case M_OFFS_DEV:
+			if( batch.setStat )
+				e->error = dev->llJumpTbl.setStat( dev->ll, e->code, chan,
+									(U_INT32_OR_64)e->value );
+			else
+				e->error = dev->llJumpTbl.getStat( dev->ll, e->code, chan,
+												   &e->value );
+			break;
+		case M_OFFS_BB:
+		case M_OFFS_BRD:
+			if( batch.setStat )
+				e->error = MDIS_BbSetStat( &lockPath, e->code,
+										   (void *)(U_INT32_OR_64)e->value );
+			else
+				e->error = MDIS_BbGetStat( &lockPath, e->code, &e->value );
+			break;
+		case M_OFFS_MK:
+			/* on the real path, M_MK_CH_CURRENT may change it */
+			if( batch.setStat )
+				e->error = MDIS_MkSetStat( mkPath, e->code,
+										   (void *)(U_INT32_OR_64)e->value );
+			else
+				e->error = MDIS_MkGetStat( mkPath, e->code, &e->value );
+			break;
+		default:
+			e->error = ERR_MK_UNK_CODE;
+		}
+	  next:
+		if( e->error )
+			nErr++;
+	}
+
+	if( locked )
+		MDIS_DevUnLock( &lockPath, callLock );
+
+	if( copy_to_user( batch.entries, ent, size ))
+		nErr = -EFAULT;
+
+ CLEANUP:
+	MDIS_RelUsrBuf( ent, bufId );
+
+	DBGWRT_1((DBH, "MDIS_SgStatBatch: %s exit rv=%d\n", dev->devName,
+			  nErr ));
+	return nErr;
+}
+
 /******************************** MDIS_DevLock ********************************
  *
  *  Description: Lock the device
  *
  *
- *	If Lockmode is CHAN, locks the channel's sempahore
- *	If Lockmode is CALL, locks the semaphore pointed to by callSem
- *	Finally, locks the device semaphore			
+ *	If Lockmode is CHAN, locks the channel's lock
+ *	If Lockmode is CALL, locks the lock pointed to by callLock
+ *	Finally, locks the device semaphore, or the device lock if the LL
+ *	driver doesn't use devSemHdl (noDevSem). Reentrant LL drivers are
+ *	called without device lock (noDevLock).
+ *
+ *	The channel, call and device locks are rt_mutexes (see MK_PROCLOCK),
+ *	so waiting callers boost the priority of the lock holder. The device
+ *	semaphore is not, as the LL driver may release it with devSemHdl.
+ *	So priority inversion on the device semaphore is avoided only for
+ *	LL drivers reporting MK_LL_LOCK_NODEVSEM (none in this package yet).
  *---------------------------------------------------------------------------
  *  Input......: mkPath	  MDIS kernel path structure
- *				 callSem  semaphore to lock when lock mode is CALL
+ *				 callLock lock to take when lock mode is CALL
  *  Output.....: return   success (0) or error code
  *  Globals....:
  ****************************************************************************/
-int32 MDIS_DevLock( MK_PATH *mkPath, OSS_SEM_HANDLE *callSem )
+int32 MDIS_DevLock( MK_PATH *mkPath, MK_PROCLOCK *callLock )
 {
 	MK_DEV *dev = mkPath->dev;
+	MK_PROCLOCK *lock;
 	int32 error;
 
 	switch( dev->lockMode ){
 	case LL_LOCK_CHAN:
-		if( (error = OSS_SemWait( dev->osh, dev->semChanP[mkPath->chan],
-								  OSS_SEM_WAITFOREVER ))){
-			DBGWRT_ERR((DBH,"*** MK:DevLock Error 0x%04x locking chansem\n",
-						error));
-			return error;
-		}
+		lock = &dev->lockChanP[mkPath->chan];
 		break;
 	case LL_LOCK_CALL:
-		if( (error = OSS_SemWait( dev->osh, callSem, OSS_SEM_WAITFOREVER ))){
-			DBGWRT_ERR((DBH,"*** MK:DevLock Error 0x%04x locking callsem\n",
-						error));
-			return error;
-		}
+		lock = callLock;
 		break;
+	default:
+		lock = NULL;
 	}
-	if( (error = OSS_SemWait( dev->osh, dev->semDev, OSS_SEM_WAITFOREVER ))){
-		DBGWRT_ERR((DBH,"*** MK:DevLock Error 0x%04x locking devsem\n",
-					error));
 
-		switch( dev->lockMode ){
-		case LL_LOCK_CHAN:
-			OSS_SemSignal( dev->osh, dev->semChanP[mkPath->chan] );
-			break;
-		case LL_LOCK_CALL:
-			OSS_SemSignal( dev->osh, callSem );
-			break;
+	if( lock && MK_PROCLOCK_TAKE( lock )){
+		DBGWRT_ERR((DBH,"*** MK:DevLock signal while waiting for %s lock\n",
+					dev->lockMode == LL_LOCK_CHAN ? "chan" : "call"));
+		return ERR_OSS_SIG_OCCURED;
+	}
+
+	if( dev->noDevLock )
+		return 0;
+
+	if( dev->noDevSem ){
+		if( (error = MK_PROCLOCK_TAKE( &dev->lockDev )) ){
+			DBGWRT_ERR((DBH,"*** MK:DevLock signal while waiting for "
+						"device lock\n"));
+			error = ERR_OSS_SIG_OCCURED;
 		}
 	}
+	else if( (error = OSS_SemWait( dev->osh, dev->semDev,
+								   OSS_SEM_WAITFOREVER ))){
+		DBGWRT_ERR((DBH,"*** MK:DevLock Error 0x%04x locking devsem\n",
+					error));
+	}
+
+	if( error && lock )
+		MK_PROCLOCK_RELEASE( lock );
 	return error;
 }
 
@@ -838,22 +1081,25 @@ int32 MDIS_DevLock( MK_PATH *mkPath, OSS_SEM_HANDLE *callSem )
  *
  *---------------------------------------------------------------------------
  *  Input......: mkPath	  MDIS kernel path structure
- *				 callSem  semaphore to unlock when lock mode is CALL
+ *				 callLock lock to release when lock mode is CALL
  *  Output.....: -
  *  Globals....:
  ****************************************************************************/
-void MDIS_DevUnLock( MK_PATH *mkPath, OSS_SEM_HANDLE *callSem )
+void MDIS_DevUnLock( MK_PATH *mkPath, MK_PROCLOCK *callLock )
 {
 	MK_DEV *dev = mkPath->dev;
 
-	OSS_SemSignal( dev->osh, dev->semDev );
+	if( !dev->noDevSem )
+		OSS_SemSignal( dev->osh, dev->semDev );
+	else if( !dev->noDevLock )
+		MK_PROCLOCK_RELEASE( &dev->lockDev );
 
 	switch( dev->lockMode ){
 	case LL_LOCK_CHAN:
-		OSS_SemSignal( dev->osh, dev->semChanP[mkPath->chan] );
+		MK_PROCLOCK_RELEASE( &dev->lockChanP[mkPath->chan] );
 		break;
 	case LL_LOCK_CALL:
-		OSS_SemSignal( dev->osh, callSem );
+		MK_PROCLOCK_RELEASE( callLock );
 		break;
 	}
 }
@@ -876,11 +1122,11 @@ int32 MDIS_LlGetStat(MK_PATH *mkPath, int32 code, INT32_OR_64 *valueP)
 	MK_DEV *dev = mkPath->dev;
 	int32 error;
 
-	if( (error = MDIS_DevLock( mkPath, dev->semGetStat ))) return error;
+	if( (error = MDIS_DevLock( mkPath, &dev->lockGetStat ))) return error;
 
 	error = dev->llJumpTbl.getStat(dev->ll, code, mkPath->chan, valueP);
 
-	MDIS_DevUnLock( mkPath, dev->semGetStat );
+	MDIS_DevUnLock( mkPath, &dev->lockGetStat );
 	return error;
 }
 
@@ -920,11 +1166,11 @@ int32 MDIS_LlSetStat(MK_PATH *mkPath, int32 code, void *value)
 	MK_DEV *dev = mkPath->dev;
 	int32 error;
 
-	if( (error = MDIS_DevLock( mkPath, dev->semSetStat ))) return error;
+	if( (error = MDIS_DevLock( mkPath, &dev->lockSetStat ))) return error;
 
 	error = dev->llJumpTbl.setStat(dev->ll, code, mkPath->chan, (U_INT32_OR_64)value);
 
-	MDIS_DevUnLock( mkPath, dev->semSetStat );
+	MDIS_DevUnLock( mkPath, &dev->lockSetStat );
 	return error;
 }
 
@@ -963,11 +1209,11 @@ static int MDIS_Read( MK_PATH *mkPath, unsigned long arg )
 	int32 error, value;
 	MK_DEV *dev = mkPath->dev;
 
-	if( (error = MDIS_DevLock( mkPath, dev->semRead ))) return -error;
+	if( (error = MDIS_DevLock( mkPath, &dev->lockRead ))) return -error;
 
 	error = dev->llJumpTbl.read(dev->ll, mkPath->chan, &value);
 
-	MDIS_DevUnLock( mkPath, dev->semRead );
+	MDIS_DevUnLock( mkPath, &dev->lockRead );
 
 	/* increment channel */
 	if (mkPath->ioMode==M_IO_EXEC_INC && error==0)
@@ -995,11 +1241,11 @@ static int MDIS_Write( MK_PATH *mkPath, unsigned long arg )
 	int32 error;
 	MK_DEV *dev = mkPath->dev;
 
-	if( (error = MDIS_DevLock( mkPath, dev->semWrite ))) return -error;
+	if( (error = MDIS_DevLock( mkPath, &dev->lockWrite ))) return -error;
 
 	error = dev->llJumpTbl.write(dev->ll, mkPath->chan, arg);
 
-	MDIS_DevUnLock( mkPath, dev->semWrite );
+	MDIS_DevUnLock( mkPath, &dev->lockWrite );
 
 	/* increment channel */
 	if (mkPath->ioMode==M_IO_EXEC_INC && error==0)
@@ -1009,6 +1255,126 @@ static int MDIS_Write( MK_PATH *mkPath, unsigned long arg )
 	return -error;
 }
 
+/****************************** MDIS_RwMulti *********************************
+ *
+ *  Description:  Read or write several channels (API calls M_read_multi,
+ *				  M_write_multi)
+ *
+ *  Without a channel list, the channels are iterated from the current
+ *  channel on (wrapping at the last one), also in M_IO_EXEC mode (unlike
+ *  M_read/M_write). The current channel is moved behind the last
+ *  transferred value only if ioMode is M_IO_EXEC_INC.
+ *
+ *  The device is locked once for all values; in channel locking mode,
+ *  the lock is retaken when the channel changes.
+ *  Transfer stops at the first LL driver error, which is returned in
+ *  rw.error also if values have been transferred before.
+ *---------------------------------------------------------------------------
+ *  Input......:  mkPath		MDIS kernel path structure
+ *				  arg			user space ptr to MDIS_LINUX_RW_MULTI
+ *  Output.....:  returns		number of transferred values,
+ *								or negative error number if none transferred
+ *				  rw.error		error that stopped the transfer, 0=ok
+ *  Globals....:  -
+ ****************************************************************************/
+static int MDIS_RwMulti( MK_PATH *mkPath, unsigned long arg )
+{
+	MK_DEV *dev = mkPath->dev;
+	MDIS_LINUX_RW_MULTI rw;
+	MK_PATH lockPath = *mkPath;
+	MK_PROCLOCK *callLock;
+	int32 *values, *chans = NULL, chan, error = 0;
+	void *bufId;
+	size_t size;
+	int i, n = 0, locked = 0;
+
+	if( copy_from_user ((void *)&rw, (void *)arg, sizeof(rw)) )
+		return -EFAULT;
+
+	DBGWRT_1((DBH,"MDIS_RwMulti %s %s count=%ld chans=%p\n", dev->devName,
+			  rw.write ? "write" : "read", rw.count, rw.chans ));
+
+	if( rw.count <= 0 || rw.count > MDIS_RW_MULTI_MAX )
+		return -EINVAL;
+
+	size = rw.count * sizeof(int32);
+	if( (values = MDIS_GetUsrBuf( rw.chans ? 2*size : size, &bufId )) == NULL )
+		return -ENOMEM;
+
+	if( rw.chans ){
+		chans = values + rw.count;
+		if( copy_from_user( chans, rw.chans, size )){
+			error = EFAULT;
+			goto CLEANUP;
+		}
+		for( i=0; i<rw.count; i++ ){
+			if( chans[i] < 0 || chans[i] >= dev->devNrChan ){
+				error = ERR_MK_ILL_PARAM;
+				goto CLEANUP;
+			}
+		}
+	}
+	if( rw.write && copy_from_user( values, rw.values, size )){
+		error = EFAULT;
+		goto CLEANUP;
+	}
+
+	callLock = rw.write ? &dev->lockWrite : &dev->lockRead;
+	chan = mkPath->chan;
+
+	for( n=0; n<rw.count; n++ ){
+		if( chans )
+			chan = chans[n];
+
+		if( locked && dev->lockMode == LL_LOCK_CHAN && lockPath.chan != chan ){
+			MDIS_DevUnLock( &lockPath, callLock );
+			locked = 0;
+		}
+		if( !locked ){
+			lockPath.chan = chan;
+			if( (error = MDIS_DevLock( &lockPath, callLock )))
+				break;
+			locked = 1;
+		}
+
+		if( rw.write )
+			error = dev->llJumpTbl.write( dev->ll, chan, values[n] );
+		else
+			error = dev->llJumpTbl.read( dev->ll, chan, &values[n] );
+		if( error )
+			break;
+
+		if( !chans && ++chan == dev->devNrChan )
+			chan = 0;
+	}
+
+	if( locked )
+		MDIS_DevUnLock( &lockPath, callLock );
+
+	/* increment channel */
+	if( !chans && mkPath->ioMode == M_IO_EXEC_INC )
+		mkPath->chan = chan;
+
+	if( !rw.write && n > 0 &&
+		copy_to_user( rw.values, values, n*sizeof(int32) )){
+		n = 0;
+		error = EFAULT;
+	}
+
+ CLEANUP:
+	MDIS_RelUsrBuf( values, bufId );
+
+	DBGWRT_1((DBH, "MDIS_RwMulti: %s exit n=%d error=0x%lx\n", dev->devName,
+			  n, error ));
+
+	if( put_user( error, &((MDIS_LINUX_RW_MULTI *)arg)->error ))
+		return -EFAULT;
+
+	if( error && n == 0 )
+		return -error;
+	return n;
+}
+
 /****************************** MDIS_IrqHandler ******************************
  *
  *  Description:  Global MDIS Interrupt handler
@@ -1371,7 +1737,7 @@ int CompressErrno( int mdisErr )
 #if LINUX_VERSION_CODE < KERNEL_VERSION(3,10,0)
 static int mk_read_procmem( char *page, char **start, off_t off, int count, int *eof, void *data)
 {
-  int i, error, len = 0, rv;
+  int error, len = 0, rv;
   off_t begin = 0;
 
   DBGWRT_3((DBH,"mk_read_procmem: count %d page=%p\n", count, page));
@@ -1379,16 +1745,8 @@ static int mk_read_procmem( char *page, char **start, off_t off, int count, int
 
 
   /* user buffers */
-  {
-    OSS_DL_NODE *node;
-
-    for( i=0, node=G_freeUsrBufList.head; node->next;
-	 node=node->next, i++ ){
-    }
-  }
-  len += sprintf( page+len, "User API Buffers: total %d"
-		  ", free %d, each %d bytes\n",
-		  mk_nbufs, i, MK_USRBUF_SIZE);
+  len += MDIS_PoolShow( page+len );
+  INC_LEN;
 
   /* Drivers */
   len += sprintf( page+len, "\nDrivers:\n" );
@@ -1446,7 +1804,7 @@ static int mk_read_procmem( char *page, char **start, off_t off, int count, int
 static ssize_t mk_read_procmem( struct file *filp, char *buf, size_t count, loff_t *pos)
 {
 
-  int i,error, rv=0;
+  int error, rv=0;
   char *locbuf;
   char *tmp;
   static int len=0;
@@ -1469,15 +1827,7 @@ static ssize_t mk_read_procmem( struct file *filp, char *buf, size_t count, loff
 	memset(locbuf, 0x00, PROC_BUF_LEN);
 
   /* user buffers */
-  {
-    OSS_DL_NODE *node;
-
-    for( i=0, node=G_freeUsrBufList.head; node->next;
-	 node=node->next, i++ ){
-    }
-  }
-  len += sprintf( tmp+len, "User API Buffers: total %d, free %d, each %d bytes\n",
-		  mk_nbufs, i, MK_USRBUF_SIZE);
+  len += MDIS_PoolShow( tmp+len );
 
   /* Drivers */
   len += sprintf( tmp+len, "\nDrivers:\n" );
@@ -1550,7 +1900,7 @@ static struct file_operations mk_proc_fops = {
  */
 int init_module(void)
 {
-	int ret=0, n;
+	int ret=0;
 	
 	DBGINIT((NULL,&DBH));
 
@@ -1603,20 +1953,9 @@ int init_module(void)
 	OSS_DL_NewList( &G_drvList );
 	OSS_DL_NewList( &G_devList );
 
-	/* init user buffer pool */
-	OSS_DL_NewList( &G_freeUsrBufList );
-
-	/* allocate one page for each user buffer, put the node struct in front */
-	for( n=0; n<mk_nbufs; n++ ){
-		unsigned long pg;
-
-		if( (pg = __get_free_page( GFP_KERNEL )) == 0 ){
-			printk( KERN_INFO "Could not allocate user buffer %d\n", n );
-			goto clean3;
-		}
-
-		OSS_DL_AddTail( &G_freeUsrBufList, (OSS_DL_NODE *)pg );
-	}
+	/* init user buffer pool, preallocate mk_nbufs page sized buffers */
+	if( (ret = MDIS_PoolInit( mk_nbufs )) != 0 )
+		goto clean3;
 
 #if LINUX_VERSION_CODE < KERNEL_VERSION(3,10,0)
 	create_proc_read_entry ("mdis", 0, NULL, mk_read_procmem, NULL);
@@ -1627,14 +1966,6 @@ int init_module(void)
 	goto clean1;
 
  clean3:
-	{
-		OSS_DL_NODE *node, *nnode;
-		
-		for( node=G_freeUsrBufList.head; node->next; node = nnode ){
-			nnode = node->next;
-		    free_page( (unsigned long)node );
-		}
-	}
 	OSS_SemRemove( OSH, &G_mkLockSem );
 
  clean2:
@@ -1651,19 +1982,7 @@ void cleanup_module(void)
 
 
 	/* free the user buffers */
-	{
-		OSS_DL_NODE *node, *nnode;
-		int cnt=0;
-
-		for( node=G_freeUsrBufList.head; node->next; node = nnode ){
-			nnode = node->next;
-			free_page( (unsigned long)node );
-			cnt++;
-		}
-		if( cnt != mk_nbufs )
-			printk( KERN_ERR "*** MEN MDIS Kernel cleanup_module: Only %d"
-					" of %d user bufs free'd\n", cnt, mk_nbufs);
-	}
+	MDIS_PoolExit();
 	OSS_Exit(&OSH);
 
 	cdev_del(&c_dev);
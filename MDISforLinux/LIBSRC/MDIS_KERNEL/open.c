@@ -101,6 +101,8 @@ int32 MDIS_InitialOpen(
 	char drvName[MK_MAX_DRVNAME+1];
 	MK_DRV *drv;
 	U_INT32_OR_64 hlpNrChan;
+	U_INT32_OR_64 hlpBlkCaps;
+	U_INT32_OR_64 hlpLockCaps;
 
     DBGWRT_1((DBH,"MK - InitialOpen: dev=%s brd=%s\n", devName, brdName));
 
@@ -350,6 +352,23 @@ int32 MDIS_InitialOpen(
 	
 	DBGWRT_2((DBH," device channels: %d channels\n",dev->devNrChan));
 
+	/*------------------------------+
+	|  get block i/o capabilities   |
+	+------------------------------*/
+	/* optional, most LL drivers don't know this code */
+	if( dev->llJumpTbl.getStat(dev->ll, M_LL_BLK_CAPS, 0, &hlpBlkCaps) )
+		hlpBlkCaps = 0;
+	dev->blkCaps = (u_int32)hlpBlkCaps;
+
+	DBGWRT_2((DBH," block i/o caps: 0x%x\n",dev->blkCaps));
+
+	/* optional, as M_LL_BLK_CAPS */
+	if( dev->llJumpTbl.getStat(dev->ll, M_LL_LOCK_CAPS, 0, &hlpLockCaps) )
+		hlpLockCaps = 0;
+	dev->lockCaps = (u_int32)hlpLockCaps;
+
+	DBGWRT_2((DBH," locking caps: 0x%x\n",dev->lockCaps));
+
 	/*------------------------------+
 	|  prepare process locking      |
 	+------------------------------*/
@@ -1007,56 +1026,54 @@ int32 MDIS_InitLockMode(MK_DEV *dev)
 	u_int32 n;
 	int32 error=0;
 
+	/* LL driver doesn't use devSemHdl: take priority inheriting lock */
+	if( dev->lockCaps & MK_LL_LOCK_NODEVSEM ){
+		dev->noDevSem = TRUE;
+
+		/* reentrant LL drivers may run without device lock */
+		if( dev->lockMode == LL_LOCK_NONE &&
+			(dev->lockCaps & MK_LL_LOCK_REENTRANT) ){
+			DBGWRT_2((DBH," no device lock\n"));
+			dev->noDevLock = TRUE;
+		}
+		else {
+			DBGWRT_2((DBH," device lock instead of device semaphore\n"));
+			MK_PROCLOCK_INIT( &dev->lockDev );
+		}
+	}
+
 	switch(dev->lockMode) {
 		case LL_LOCK_NONE:
 			DBGWRT_2((DBH," prepare lockMode LL_LOCK_NONE\n"));
-			/* nothing to do */
 			break;
 
 		case LL_LOCK_CALL:
 			DBGWRT_2((DBH," prepare lockMode LL_LOCK_CALL\n"));
 
-			/* create sem's */
-			if( (error = OSS_SemCreate( dev->osh, OSS_SEM_BIN,1,
-										&dev->semRead )))
-				break;
-			if( (error = OSS_SemCreate( dev->osh, OSS_SEM_BIN,1,
-										&dev->semWrite )))
-				break;
-			if( (error = OSS_SemCreate( dev->osh, OSS_SEM_BIN,1,
-										&dev->semBlkRead)))
-				break;
-			if( (error = OSS_SemCreate( dev->osh, OSS_SEM_BIN,1,
-										&dev->semBlkWrite)))
-				break;
-			if( (error = OSS_SemCreate( dev->osh, OSS_SEM_BIN,1,
-										&dev->semSetStat )))
-				break;
-			if( (error = OSS_SemCreate( dev->osh, OSS_SEM_BIN,1,
-										&dev->semGetStat )))
-				break;
+			/* init locks */
+			MK_PROCLOCK_INIT( &dev->lockRead );
+			MK_PROCLOCK_INIT( &dev->lockWrite );
+			MK_PROCLOCK_INIT( &dev->lockBlkRead );
+			MK_PROCLOCK_INIT( &dev->lockBlkWrite );
+			MK_PROCLOCK_INIT( &dev->lockSetStat );
+			MK_PROCLOCK_INIT( &dev->lockGetStat );
 			break;
 
 		case LL_LOCK_CHAN:
 			DBGWRT_2((DBH," prepare lockMode LL_LOCK_CHAN\n"));
 
-			/* alloc space for array of sem ptr's */
-			dev->semChanP = OSS_MemGet(
+			/* alloc space for array of locks */
+			dev->lockChanP = OSS_MemGet(
 				dev->osh,
-				sizeof(OSS_SEM_HANDLE *) * dev->devNrChan,
-				&dev->semChanAlloc );
+				sizeof(MK_PROCLOCK) * dev->devNrChan,
+				&dev->lockChanAlloc );
 
-			if( dev->semChanP == NULL )
+			if( dev->lockChanP == NULL )
 				return(ERR_OSS_MEM_ALLOC);
-				
-			memset( dev->semChanP, 0, sizeof(OSS_SEM_HANDLE *) *
-					dev->devNrChan);
 
-			/* init sems */
+			/* init locks */
 			for (n=0; n<dev->devNrChan; n++)
-				if( (error = OSS_SemCreate( dev->osh, OSS_SEM_BIN,1,
-											&dev->semChanP[n] )))
-					break;
+				MK_PROCLOCK_INIT( &dev->lockChanP[n] );
 
 			break;
 		default:
@@ -195,6 +195,27 @@
   \tsi148 TSI148 VME bridge does not support hardware swapping! User
   application has to care for swapping by its own!
 
+  \subsection vme4lmapwc Write-combining mapped regions
+
+  Mapped regions are uncached, so each CPU store becomes a single-beat
+  write to the VME bridge. For write-only streaming regions (e.g. DAC
+  waveform memory), VME4L_MapModeSet() with #VME4L_MAP_WC lets the CPU
+  merge stores into bursts:
+
+  \code
+  VME4L_MapModeSet( spaceFd, VME4L_MAP_WC );
+  VME4L_Map( spaceFd, 0x10000, 0x10000, &vmeP);
+
+  memcpy( vmeP, wave, 0x10000 );
+  VME4L_MapFlush(); // writes have left the CPU \endcode
+
+  Stores to a write-combining region are buffered and may be reordered,
+  so don't use it for registers or for reading. Call VME4L_MapFlush()
+  before accessing the device by other means. As with posted writes,
+  bus errors are not reported to the writer. A range in use uncached
+  can't be mapped write-combining on bridges with fixed windows (and
+  vice versa), VME4L_Map() fails with \c EEXIST then.
+
 
   \section vme4lapiacc Use API functions to exchange data with VME
 
@@ -248,6 +269,84 @@
 
 
 
+  \section vme4lasync Asynchronous DMA transfers
+
+  VME4L_Read() and VME4L_Write() block until the DMA has finished. To
+  keep the DMA engine busy without one thread per transfer, a file
+  descriptor can be switched to asynchronous mode with VME4L_AsyncSetup().
+  This creates a submission and a completion ring shared between
+  driver and application:
+
+  - VME4L_AsyncQueue() puts a request into the submission ring
+  - VME4L_AsyncSubmit() passes all queued requests to the driver
+  - VME4L_AsyncWait() waits until requests have completed
+  - VME4L_AsyncReap() fetches the results from the completion ring
+
+  Only DMA transfers (\c _BLT spaces or #VME4L_RW_USE_SGL_DMA) are
+  supported. Once the rings are set up, mmap() on this file descriptor
+  maps the rings, so open a second path for VME4L_Map().
+
+  \code
+  VME4L_ASYNC_RING_HDR *ring;
+  VME4L_ASYNC_CQE cqe[16];
+  int i, n;
+
+  // Error checking omitted in this example
+  spaceFd = VME4L_Open( VME4L_SPC_A32_D64_BLT );
+  ring = VME4L_AsyncSetup( spaceFd, 16 );
+
+  for( i=0; i<16; i++ )
+      VME4L_AsyncQueue( ring, 0x1000000 + i*0x10000, 0, 0x10000,
+                        buf[i], VME4L_RW_NOFLAGS, i );
+
+  VME4L_AsyncSubmit( spaceFd, 16 );
+  VME4L_AsyncWait( spaceFd, 16 );
+  n = VME4L_AsyncReap( ring, cqe, 16 );
+
+  // cqe[i].result contains number of bytes transferred or -errno
+  VME4L_AsyncRelease( ring );
+  VME4L_Close( spaceFd ); \endcode
+
+
+  \section vme4ldmapol DMA completion policy
+
+  By default, the driver sleeps until the DMA finished interrupt occurs.
+  For short block transfers, interrupt latency and task switch can take
+  longer than the transfer itself. VME4L_DmaPolicySet() lets the driver
+  busy-poll the DMA status for some microseconds before it sleeps, and
+  sets the DMA timeout. The policy applies to all DMA transfers on the
+  file descriptor. Defaults are taken from the module parameters
+  \c dma_poll_us and \c dma_timeout_ms.
+
+
+  \section vme4lpinbuf Registered DMA buffers
+
+  For each VME4L_Read()/VME4L_Write() DMA transfer, the driver locks the
+  user buffer in memory and maps it for the DMA engine, and undoes this
+  afterwards. Applications that always transfer from/to the same buffers
+  can register them once with VME4L_PinBufRegister() and transfer by
+  handle and offset with VME4L_ReadPinned()/VME4L_WritePinned().
+
+  Registered buffers stay locked until VME4L_PinBufUnregister() is called
+  or the file descriptor is closed. Up to #VME4L_PINBUF_MAX buffers can be
+  registered per file descriptor. Transfers on registered buffers always
+  use the DMA engine.
+
+  \code
+  int h;
+
+  // Error checking omitted in this example
+  spaceFd = VME4L_Open( VME4L_SPC_A32_D64_BLT );
+  h = VME4L_PinBufRegister( spaceFd, ringBuf, 0x400000 );
+
+  for( i=0; i<64; i++ )
+      VME4L_ReadPinned( spaceFd, 0x1000000, h, i*0x10000, 0x10000,
+                        VME4L_RW_NOFLAGS );
+
+  VME4L_PinBufUnregister( spaceFd, h );
+  VME4L_Close( spaceFd ); \endcode
+
+
   \section vme4la32 Restrictions in VME extended (A32) space
 
   Since the VME A32 space occupies 4GB, only a part of this space
@@ -421,6 +520,40 @@
   - The same signal can be installed for the same process for
     different vectors.
 
+  \section vme4lirqev Interrupt events instead of signals
+
+  As an alternative to signals, VME4L_EventInstall() binds a vector to
+  an eventfd or to the event queue of the VME4L file descriptor. Both can
+  be waited for with poll()/epoll together with other file descriptors.
+
+  - With an eventfd, each interrupt increments the eventfd counter.
+  - Without eventfd (\em eventFd = -1), each interrupt queues a
+    #VME4L_EVENT record with vector, level and timestamp. Records are
+    fetched with read() or VME4L_EventRead(). The file becomes readable
+    when records are queued. If the queue (#VME4L_EVENT_QUEUE_LEN records)
+    is full, further records are dropped and counted in the \em lost field
+    of the next record.
+
+  The release modes (#VME4L_IRQ_ROAK) and #VME4L_IRQ_ENBL work as for
+  VME4L_SigInstall(). Events are removed with VME4L_EventUnInstall() or
+  when the file is closed.
+
+  \code
+  int efd = VME4L_Open( VME4L_SPC_A24_D16 );
+  struct pollfd pfd = { efd, POLLIN };
+  VME4L_EVENT ev[8];
+
+  VME4L_EventInstall( efd, 121, 3, -1, VME4L_IRQ_ENBL );
+
+  while( poll( &pfd, 1, -1 ) > 0 ){
+      int i, n = VME4L_EventRead( efd, ev, 8 );
+
+      for( i=0; i<n; i++ ){
+          // service device, then
+          VME4L_IrqEnable( efd, ev[i].level );
+      }
+  } \endcode
+
 */
 
 /***************************************************************************/
@@ -858,6 +991,46 @@ int VME4L_SwapModeSet( int spaceFd, int swapMode)
 	return ioctl( spaceFd, VME4L_IO_SWAP_MODE_SET, swapMode );
 }
 
+/**********************************************************************/
+/** Set map mode for this file descriptor (space)
+ *
+ * The map mode is applied to following VME4L_Map() calls on \a spaceFd.
+ * Regions that are already mapped are not changed.
+ *
+ * Write-combining regions are mapped through their own bridge window.
+ * A range can't be used write-combining and uncached (mapped or by
+ * VME4L_Read()/VME4L_Write()) at the same time when the bridge provides
+ * only one window for it (e.g. PLDZ002): VME4L_Map() fails with
+ * \c EEXIST then.
+ *
+ * \param spaceFd 	\IN File descriptor for VME master space,
+ *						returned by VME4L_Open()
+ * \param mapMode	\IN Map mode to use, see \ref VME4L_MAPMODE
+ *
+ * \return 	0 on success, or -1 on error\n
+ *			- \c EINVAL: Bad parameter
+ *
+ * \sa VME4L_Map, VME4L_MapFlush, \ref vme4lmapwc
+ *
+ */
+int VME4L_MapModeSet( int spaceFd, int mapMode)
+{
+	return ioctl( spaceFd, VME4L_IO_MAP_MODE_SET, mapMode );
+}
+
+/**********************************************************************/
+/** Flush CPU write buffers of write-combining mapped regions
+ *
+ * Returns when all stores issued before to #VME4L_MAP_WC regions
+ * have left the CPU.
+ *
+ * \sa VME4L_MapModeSet, \ref vme4lmapwc
+ */
+void VME4L_MapFlush( void )
+{
+	__sync_synchronize();
+}
+
 /**********************************************************************/
 /** Set VMEbus address modifiers for this file descriptor (space)
  *
@@ -1090,6 +1263,41 @@ int VME4L_Write(
 	return ioctl( spaceFd, VME4L_IO_RW_BLOCK, &blk );
 }
 
+/**********************************************************************/
+/** Read/write several data blocks with one call
+ *
+ * Transfers \a count independent blocks, each described like the
+ * arguments of VME4L_Read()/VME4L_Write(). Use this to access many
+ * boards per cycle with a single system call.
+ *
+ * Blocks transferred by zero-copy DMA are passed to the DMA engine
+ * together. If the bridge can prepare the next descriptor chain while
+ * DMA is running, there is no gap between the blocks.
+ *
+ * Transfer stops at the first failing block.
+ *
+ * \param spaceFd 	\IN  File descriptor for VME space,
+ *						 returned by VME4L_Open()
+ * \param blkP		\IN  array of blocks. For each block, set
+ *						 \c vmeAddr, \c direction (0=read, 1=write),
+ *						 \c accWidth, \c size, \c dataP and \c flags
+ * \param count		\IN  number of blocks (max. #VME4L_RW_VECTOR_MAX)
+ *
+ * \return 	Total number of bytes transferred or -1 on error\n
+ *			In case of error, \em errno is set as for VME4L_Read()
+ *
+ * \sa VME4L_Read, VME4L_Write
+ */
+int VME4L_RwVector( int spaceFd, VME4L_RW_BLOCK *blkP, int count )
+{
+	VME4L_RW_VECTOR vec;
+
+	vec.blkP	= blkP;
+	vec.count	= count;
+
+	return ioctl( spaceFd, VME4L_IO_RW_VECTOR, &vec );
+}
+
 /**********************************************************************/
 /** Map VMEbus address space
  *
@@ -1097,8 +1305,11 @@ int VME4L_Write(
  * with the size of \a size bytes into user address space and stores the
  * corresponding user address into \a mappedAddrP.
  *
- * Note that \a vmeAddr <b>must be aligned to an MMU page</b> (typically 4K)
- * and addresses > 0xFFFFFFFF are not supported, yet.
+ * Note that \a vmeAddr <b>must be aligned to an MMU page</b> (typically 4K).
+ * VME addresses that don't fit into the mmap() offset (e.g. A64 or A32
+ * addresses >= 2GB on 32 bit systems) are passed to the driver with
+ * VME4L_IO_MMAP_BASE_SET, so concurrent VME4L_Map() calls for such
+ * addresses on the same \a spaceFd must be serialized by the caller.
  *
  * The VMEbus address remains mapped until VME4L_UnMap() is called or
  * \a spaceFd is closed.
@@ -1129,9 +1340,26 @@ int VME4L_Map(
 	void **mappedAddrP)
 {
 	void *vaddr;
+	vmeaddr_t base = 0;
+	int err;
+
+	/* offset doesn't fit into off_t: let the driver add it */
+	if( (off_t)vmeAddr < 0 || (vmeaddr_t)(off_t)vmeAddr != vmeAddr ){
+		base = vmeAddr;
+		if( ioctl( spaceFd, VME4L_IO_MMAP_BASE_SET, &base ) < 0 )
+			return -1;
+	}
 
 	vaddr = mmap( NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, spaceFd,
-				  vmeAddr );
+				  (off_t)(vmeAddr - base) );
+
+	if( base ){
+		err = errno;
+		base = 0;
+		ioctl( spaceFd, VME4L_IO_MMAP_BASE_SET, &base );
+		errno = err;
+	}
+
 	if( vaddr == MAP_FAILED )
 		return -1;
 	*mappedAddrP = vaddr;
@@ -1165,6 +1393,399 @@ int VME4L_UnMap(
 }
 
 
+/**********************************************************************/
+/** Set DMA completion policy
+ *
+ * \param spaceFd 	\IN  File descriptor for VME space,
+ *						 returned by VME4L_Open()
+ * \param pollUs	\IN  time to busy-poll for DMA completion before
+ *						 waiting for DMA interrupt (0 = don't poll,
+ *						 max. #VME4L_DMA_POLL_MAX_US)
+ * \param timeoutMs	\IN  DMA timeout in ms (>0,
+ *						 max. #VME4L_DMA_TIMEOUT_MAX_MS)
+ *
+ * \return 	0 on success or -1 on error\n
+ *			In case of error, \em errno is set to\n
+ *			- \c EINVAL: bad parameter
+ *
+ * \sa VME4L_DmaPolicyGet, \ref vme4ldmapol
+ */
+int VME4L_DmaPolicySet( int spaceFd, uint32_t pollUs, uint32_t timeoutMs )
+{
+	VME4L_DMA_POLICY pol;
+
+	pol.pollUs		= pollUs;
+	pol.timeoutMs	= timeoutMs;
+
+	return ioctl( spaceFd, VME4L_IO_DMA_POLICY_SET, &pol );
+}
+
+/**********************************************************************/
+/** Get DMA completion policy
+ *
+ * \param spaceFd 	\IN  File descriptor for VME space,
+ *						 returned by VME4L_Open()
+ * \param pollUsP	\OUT busy-poll time (us)
+ * \param timeoutMsP \OUT DMA timeout (ms)
+ *
+ * \return 	0 on success or -1 on error
+ *
+ * \sa VME4L_DmaPolicySet, \ref vme4ldmapol
+ */
+int VME4L_DmaPolicyGet( int spaceFd, uint32_t *pollUsP, uint32_t *timeoutMsP )
+{
+	VME4L_DMA_POLICY pol;
+
+	if( ioctl( spaceFd, VME4L_IO_DMA_POLICY_GET, &pol ) < 0 )
+		return -1;
+
+	*pollUsP	= pol.pollUs;
+	*timeoutMsP	= pol.timeoutMs;
+	return 0;
+}
+
+/**********************************************************************/
+/** Get driver statistics
+ *
+ * Returns interrupt counters (total, per level and per vector) and
+ * transfer counters per VME space (DMA/PIO bytes, bus errors, address
+ * window and ioremap cache hits/misses). The counters are kept per CPU
+ * by the driver, so this never blocks interrupts or transfers.
+ *
+ * The same counters are shown in /proc/vme4l/interrupts and
+ * /proc/vme4l/transfers.
+ *
+ * \param fd	 	\IN  File descriptor for any VME space,
+ *						 returned by VME4L_Open()
+ * \param stats		\OUT counters since driver load
+ *
+ * \return 	0 on success or -1 on error
+ */
+int VME4L_StatsGet( int fd, VME4L_STATS *stats )
+{
+	return ioctl( fd, VME4L_IO_STATS_GET, stats );
+}
+
+/**********************************************************************/
+/** Register a buffer for repeated DMA transfers
+ *
+ * Locks the buffer in memory and maps it for the DMA engine until
+ * VME4L_PinBufUnregister() is called or \a spaceFd is closed.
+ *
+ * \param spaceFd 	\IN  File descriptor for VME space,
+ *						 returned by VME4L_Open()
+ * \param dataP		\IN  start of buffer
+ * \param size		\IN  size of buffer in bytes
+ *
+ * \return 	buffer handle (>=0) or -1 on error\n
+ *			In case of error, \em errno is set to\n
+ *			- \c ENOTTY: bridge has no zero-copy DMA
+ *			- \c ENOSPC: #VME4L_PINBUF_MAX buffers already registered
+ *			- \c EFAULT: bad buffer
+ *
+ * \sa VME4L_ReadPinned, VME4L_WritePinned, VME4L_PinBufUnregister,
+ *     \ref vme4lpinbuf
+ */
+int VME4L_PinBufRegister( int spaceFd, void *dataP, size_t size )
+{
+	VME4L_PINBUF_REG blk;
+
+	blk.dataP	= dataP;
+	blk.size	= size;
+	blk.handle	= -1;
+
+	if( ioctl( spaceFd, VME4L_IO_PINBUF_REGISTER, &blk ) < 0 )
+		return -1;
+
+	return blk.handle;
+}
+
+/**********************************************************************/
+/** Unregister a buffer registered by VME4L_PinBufRegister()
+ *
+ * \param spaceFd 	\IN  File descriptor for VME space,
+ *						 returned by VME4L_Open()
+ * \param handle	\IN  buffer handle
+ *
+ * \return 	0 on success or -1 on error\n
+ *			In case of error, \em errno is set to\n
+ *			- \c EINVAL: bad handle
+ *			- \c EBUSY: transfer on buffer in progress
+ *
+ * \sa VME4L_PinBufRegister, \ref vme4lpinbuf
+ */
+int VME4L_PinBufUnregister( int spaceFd, int handle )
+{
+	return ioctl( spaceFd, VME4L_IO_PINBUF_UNREGISTER, handle );
+}
+
+/**********************************************************************/
+/** Read data block from VME into registered buffer
+ *
+ * Same as VME4L_Read() but the data is transferred by DMA into a buffer
+ * registered with VME4L_PinBufRegister().
+ *
+ * \param spaceFd 	\IN  File descriptor for VME space,
+ *						 returned by VME4L_Open()
+ * \param vmeAddr	\IN  Start address within VME space
+ * \param handle	\IN  buffer handle
+ * \param offset	\IN  offset within registered buffer
+ * \param size		\IN  Number of bytes to transfer
+ * \param flags		\IN  See \ref VME4L_RWFLAGS.
+ *
+ * \return 	Number of bytes transferred or -1 on error\n
+ *			In case of error, \em errno is set to\n
+ *			- \c EINVAL: bad handle or range exceeds buffer
+ *			- \c EIO: 	 A VME bus error occurred
+ *			- \c ETIME:  DMA controller timeout (hardware problem)
+ *
+ * \sa VME4L_Read, VME4L_WritePinned, \ref vme4lpinbuf
+ */
+int VME4L_ReadPinned(
+	int spaceFd,
+	vmeaddr_t vmeAddr,
+	int handle,
+	size_t offset,
+	size_t size,
+	int flags )
+{
+	VME4L_RW_PINNED blk;
+
+	blk.vmeAddr		= vmeAddr;
+	blk.direction	= 0;	/* read */
+	blk.handle		= handle;
+	blk.offset		= offset;
+	blk.size		= size;
+	blk.flags		= flags;
+
+	return ioctl( spaceFd, VME4L_IO_RW_PINNED, &blk );
+}
+
+/**********************************************************************/
+/** Write data block from registered buffer to VME
+ *
+ * Same as VME4L_Write() but the data is transferred by DMA from a buffer
+ * registered with VME4L_PinBufRegister().
+ *
+ * \param spaceFd 	\IN  File descriptor for VME space,
+ *						 returned by VME4L_Open()
+ * \param vmeAddr	\IN  Start address within VME space
+ * \param handle	\IN  buffer handle
+ * \param offset	\IN  offset within registered buffer
+ * \param size		\IN  Number of bytes to transfer
+ * \param flags		\IN  See \ref VME4L_RWFLAGS.
+ *
+ * \return 	Number of bytes transferred or -1 on error\n
+ *			In case of error, \em errno is set to\n
+ *			- \c EINVAL: bad handle or range exceeds buffer
+ *			- \c EIO: 	 A VME bus error occurred
+ *			- \c ETIME:  DMA controller timeout (hardware problem)
+ *
+ * \sa VME4L_Write, VME4L_ReadPinned, \ref vme4lpinbuf
+ */
+int VME4L_WritePinned(
+	int spaceFd,
+	vmeaddr_t vmeAddr,
+	int handle,
+	size_t offset,
+	size_t size,
+	int flags )
+{
+	VME4L_RW_PINNED blk;
+
+	blk.vmeAddr		= vmeAddr;
+	blk.direction	= 1;	/* write */
+	blk.handle		= handle;
+	blk.offset		= offset;
+	blk.size		= size;
+	blk.flags		= flags;
+
+	return ioctl( spaceFd, VME4L_IO_RW_PINNED, &blk );
+}
+
+
+/**********************************************************************/
+/** Setup asynchronous DMA rings
+ *
+ * Creates the submission and completion rings for \a spaceFd and maps
+ * them into the caller's address space. The rings exist until
+ * \a spaceFd is closed.
+ *
+ * After this call, mmap() on \a spaceFd maps the rings, therefore
+ * VME4L_Map() must use a different file descriptor.
+ *
+ * \param spaceFd 	\IN  File descriptor for VME space,
+ *						 returned by VME4L_Open()
+ * \param entries	\IN  number of ring entries (power of 2, max.
+ *						 #VME4L_ASYNC_MAX_ENTRIES)
+ *
+ * \return 	pointer to mapped ring header or NULL on error\n
+ *			In case of error, \em errno is set to\n
+ *			- \c ENOTTY: bridge has no zero-copy DMA or slave space
+ *			- \c EBUSY: rings already set up for \a spaceFd
+ *			- \c EINVAL: bad \a entries
+ *
+ * \sa VME4L_AsyncQueue, VME4L_AsyncRelease, \ref vme4lasync
+ */
+VME4L_ASYNC_RING_HDR *VME4L_AsyncSetup( int spaceFd, uint32_t entries )
+{
+	VME4L_ASYNC_SETUP blk;
+	void *vaddr;
+
+	blk.entries = entries;
+	blk.mapSize = 0;
+
+	if( ioctl( spaceFd, VME4L_IO_ASYNC_SETUP, &blk ) < 0 )
+		return NULL;
+
+	vaddr = mmap( NULL, blk.mapSize, PROT_READ|PROT_WRITE, MAP_SHARED,
+				  spaceFd, 0 );
+	if( vaddr == MAP_FAILED )
+		return NULL;
+
+	return (VME4L_ASYNC_RING_HDR *)vaddr;
+}
+
+/**********************************************************************/
+/** Unmap asynchronous DMA rings
+ *
+ * The rings itself are freed when the file descriptor is closed.
+ *
+ * \param ring		\IN  ring header returned by VME4L_AsyncSetup()
+ *
+ * \return 	0 on success or -1 on error\n
+ *			In case of error, \em errno is set.
+ *
+ * \sa VME4L_AsyncSetup, \ref vme4lasync
+ */
+int VME4L_AsyncRelease( VME4L_ASYNC_RING_HDR *ring )
+{
+	return munmap( ring, ring->cqOff +
+				   ring->entries * sizeof(VME4L_ASYNC_CQE) );
+}
+
+/**********************************************************************/
+/** Put request into asynchronous DMA submission ring
+ *
+ * The request is not passed to the driver before VME4L_AsyncSubmit()
+ * is called. The buffer must not be touched until the request's
+ * completion entry has been reaped.
+ *
+ * \param ring		\IN  ring header returned by VME4L_AsyncSetup()
+ * \param vmeAddr	\IN  VME start address
+ * \param direction	\IN  0=read from VME, 1=write to VME
+ * \param size		\IN  number of bytes to transfer
+ * \param dataP		\IN  user buffer
+ * \param flags		\IN  see \ref VME4L_RWFLAGS
+ * \param userData	\IN  value passed back in completion entry
+ *
+ * \return 	0 on success or -1 on error\n
+ *			In case of error, \em errno is set to\n
+ *			- \c EAGAIN: submission ring is full
+ *
+ * \sa VME4L_AsyncSubmit, \ref vme4lasync
+ */
+int VME4L_AsyncQueue(
+	VME4L_ASYNC_RING_HDR *ring,
+	vmeaddr_t vmeAddr,
+	int direction,
+	size_t size,
+	void *dataP,
+	int flags,
+	uint64_t userData)
+{
+	VME4L_ASYNC_SQE *sqe;
+	uint32_t tail = ring->sqTail;
+
+	if( tail - ring->sqHead >= ring->entries ){
+		errno = EAGAIN;
+		return -1;
+	}
+
+	sqe = (VME4L_ASYNC_SQE *)((char *)ring + ring->sqOff) +
+		(tail & (ring->entries - 1));
+	sqe->userData	= userData;
+	sqe->vmeAddr	= vmeAddr;
+	sqe->direction	= direction;
+	sqe->flags		= flags;
+	sqe->size		= size;
+	sqe->dataP		= dataP;
+
+	__sync_synchronize();	/* SQE must be visible before new tail */
+	ring->sqTail = tail + 1;
+
+	return 0;
+}
+
+/**********************************************************************/
+/** Pass queued requests to the driver
+ *
+ * \param spaceFd 	\IN  File descriptor passed to VME4L_AsyncSetup()
+ * \param count		\IN  max. number of requests to submit
+ *
+ * \return 	number of requests submitted or -1 on error\n
+ *			In case of error, \em errno is set to\n
+ *			- \c EBUSY: no free completion entries, reap first
+ *			- \c EINVAL: rings not set up
+ *
+ * \sa VME4L_AsyncQueue, VME4L_AsyncWait, \ref vme4lasync
+ */
+int VME4L_AsyncSubmit( int spaceFd, unsigned int count )
+{
+	return ioctl( spaceFd, VME4L_IO_ASYNC_SUBMIT, count );
+}
+
+/**********************************************************************/
+/** Wait for completion of asynchronous requests
+ *
+ * Returns when at least \a minComplete completion entries are
+ * available or no more requests are in progress.
+ *
+ * \param spaceFd 	\IN  File descriptor passed to VME4L_AsyncSetup()
+ * \param minComplete \IN number of completion entries to wait for
+ *
+ * \return 	number of completion entries available or -1 on error\n
+ *			In case of error, \em errno is set to\n
+ *			- \c EINTR: interrupted by signal
+ *			- \c EINVAL: rings not set up or bad \a minComplete
+ *
+ * \sa VME4L_AsyncReap, \ref vme4lasync
+ */
+int VME4L_AsyncWait( int spaceFd, unsigned int minComplete )
+{
+	return ioctl( spaceFd, VME4L_IO_ASYNC_WAIT, minComplete );
+}
+
+/**********************************************************************/
+/** Fetch entries from asynchronous DMA completion ring
+ *
+ * \param ring		\IN  ring header returned by VME4L_AsyncSetup()
+ * \param cqeP		\OUT receives completion entries
+ * \param maxCqe	\IN  max. number of entries to fetch
+ *
+ * \return 	number of entries fetched (0 if none available)
+ *
+ * \sa VME4L_AsyncWait, \ref vme4lasync
+ */
+int VME4L_AsyncReap(
+	VME4L_ASYNC_RING_HDR *ring,
+	VME4L_ASYNC_CQE *cqeP,
+	int maxCqe)
+{
+	VME4L_ASYNC_CQE *cq = (VME4L_ASYNC_CQE *)((char *)ring + ring->cqOff);
+	uint32_t head = ring->cqHead;
+	int n = 0;
+
+	while( n < maxCqe && head != ring->cqTail ){
+		__sync_synchronize();	/* read CQE after tail */
+		cqeP[n++] = cq[head++ & (ring->entries - 1)];
+	}
+
+	ring->cqHead = head;
+
+	return n;
+}
+
 
 
 /*---- Interrupts ----*/
@@ -1249,6 +1870,88 @@ int VME4L_SigUnInstall( int fd, int vector )
 	return ioctl( fd, VME4L_IO_SIG_UNINSTALL, vector );
 }
 
+/**********************************************************************/
+/** Install event for VME interrupt or special interrupts
+ *
+ * Binds \a vector either to the eventfd \a eventFd or, when \a eventFd
+ * is -1, to the event queue of \a fd (see \ref vme4lirqev).
+ *
+ * \param fd	 	\IN  File descriptor for any VME space,
+ *						 returned by VME4L_Open()
+ * \param vector	\IN  VMEbus interrupt vector (0..255) or special interrupt
+ *                       vector (see \ref VME4L_IRQVEC)
+ * \param level 	\IN  VMEbus interrupt level or special interrupt level
+ *						 (see \ref VME4L_IRQLEV)
+ * \param eventFd   \IN  eventfd to signal or -1 to queue records on \a fd
+ * \param flags		\IN  Bitwise OR of the \ref VME4L_IRQFLAGS flags
+ *
+ * \return 	0=success <0=error\n
+ *			In case of error, \em errno is set.
+ *
+ * \sa VME4L_EventUnInstall, VME4L_EventRead, \ref vme4lirqev
+ */
+int VME4L_EventInstall( int fd, int vector, int level, int eventFd, int flags )
+{
+	VME4L_EVENT_INSTALL blk;
+
+	blk.vector			= vector;
+	blk.level			= level;
+	blk.eventFd			= eventFd;
+	blk.flags			= flags;
+
+	return ioctl( fd, VME4L_IO_EVENT_INSTALL, &blk );
+}
+
+/**********************************************************************/
+/** Uninstall events for VME interrupt or special interrupts
+ *
+ * Removes all events installed on \a fd for that vector.
+ *
+ * \param fd	 	\IN  File descriptor passed to VME4L_EventInstall()
+ * \param vector	\IN  VMEbus interrupt vector (0..255) or special interrupt
+ *                       vector (see \ref VME4L_IRQVEC)
+ *
+ * \return 	0=success <0=error\n
+ *			In case of error, \em errno is set.
+ *
+ * \sa VME4L_EventInstall, \ref vme4lirqev
+ */
+int VME4L_EventUnInstall( int fd, int vector )
+{
+	return ioctl( fd, VME4L_IO_EVENT_UNINSTALL, vector );
+}
+
+/**********************************************************************/
+/** Read queued interrupt records
+ *
+ * Blocks until at least one record is queued, unless \a fd has been set
+ * to O_NONBLOCK.
+ *
+ * \param fd	 	\IN  File descriptor passed to VME4L_EventInstall()
+ * \param evP		\OUT receives up to \a maxEv records
+ * \param maxEv		\IN  number of entries in \a evP
+ *
+ * \return 	number of records read or -1 on error\n
+ *			In case of error, \em errno is set to\n
+ *			- \c EAGAIN: no record queued (O_NONBLOCK)
+ *
+ * \sa VME4L_EventInstall, \ref vme4lirqev
+ */
+int VME4L_EventRead( int fd, VME4L_EVENT *evP, int maxEv )
+{
+	ssize_t n;
+
+	if( maxEv <= 0 ){
+		errno = EINVAL;
+		return -1;
+	}
+
+	if( (n = read( fd, evP, maxEv * sizeof(*evP) )) < 0 )
+		return -1;
+
+	return (int)(n / sizeof(*evP));
+}
+
 /***********************************************************************/
 /** Enables the specified VME interrupt level.
  *
@@ -1,10 +1,6 @@
 #***************************  M a k e f i l e  *******************************
 #
-#         Author: kp
-#          $Date: 2003/12/15 15:02:29 $
-#      $Revision: 1.1 $
-#
-#    Description: Makefile definitions for VME4L_RWSPEED
+#    Description: Makefile definitions for VME4L_BENCH
 #
 #-----------------------------------------------------------------------------
 #   Copyright (c) 2003-2019, MEN Mikro Elektronik GmbH
@@ -22,13 +18,16 @@
 # You should have received a copy of the GNU General Public License
 # along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
-MAK_NAME=vme4l_rwspeed
+MAK_NAME=vme4l_bench
 
-MAK_LIBS=$(LIB_PREFIX)$(MEN_LIB_DIR)/vme4l_api$(LIB_SUFFIX)
+MAK_LIBS=$(LIB_PREFIX)$(MEN_LIB_DIR)/vme4l_api$(LIB_SUFFIX)\
+		 $(LIB_PREFIX)$(MEN_LIB_DIR)/usr_oss$(LIB_SUFFIX)\
+		 $(LIB_PREFIX)$(MEN_LIB_DIR)/usr_utl$(LIB_SUFFIX) -lrt -lpthread
 
 MAK_INCL=$(MEN_INC_DIR)/../../NATIVE/MEN/vme4l_api.h	\
-		 $(MEN_INC_DIR)/../../NATIVE/MEN/vme4l.h
+		 $(MEN_INC_DIR)/../../NATIVE/MEN/vme4l.h \
+		 $(MEN_INC_DIR)/usr_utl.h
 
-MAK_INP1=vme4l_rwspeed$(INP_SUFFIX)
+MAK_INP1=vme4l_bench$(INP_SUFFIX)
 
 MAK_INP=$(MAK_INP1)
@@ -0,0 +1,559 @@
+/*********************  P r o g r a m  -  M o d u l e ***********************/
+/*!
+ *        \file  vme4l_bench.c
+ *
+ *  	 \brief  Throughput and latency benchmark for VME4L
+ *
+ * Sweeps transfer sizes, access widths, transfer modes (PIO, block PIO,
+ * DMA, DMA into pinned buffers, mmap) and number of concurrent threads.
+ * Every operation is timed with CLOCK_MONOTONIC_RAW, results contain the
+ * throughput and the latency percentiles p50/p99/p99.9 per operation.
+ *
+ * Whether "dma" uses zero-copy or bounce buffer DMA depends on the bridge
+ * driver (zero-copy if the bridge supports it). "pin" always uses
+ * zero-copy DMA.
+ *
+ *     Switches: -
+ *     Required: libraries: vme4l_api, usr_utl, pthread
+ */
+/*
+ *---------------------------------------------------------------------------
+ * Copyright (c) 2003-2019, MEN Mikro Elektronik GmbH
+ ******************************************************************************/
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <signal.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <MEN/vme4l.h>
+#include <MEN/vme4l_api.h>
+#include <MEN/men_typs.h>
+#include <MEN/usr_utl.h>
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+#define _1MB 			(1*1024*1024)	/* for MB/s */
+#define MAX_LIST		16				/* max. values in option lists */
+
+#ifndef CLOCK_MONOTONIC_RAW
+# define CLOCK_MONOTONIC_RAW	CLOCK_MONOTONIC
+#endif
+
+/*--------------------------------------+
+|   TYPDEFS                             |
++--------------------------------------*/
+/** transfer modes */
+typedef enum {
+	MODE_PIO,			/**< VME4L_Read/Write */
+	MODE_BLK,			/**< VME4L_Read/Write with VME4L_RW_PIO_BLOCK */
+	MODE_DMA,			/**< VME4L_Read/Write with VME4L_RW_USE_SGL_DMA */
+	MODE_PIN,			/**< VME4L_ReadPinned/WritePinned */
+	MODE_MMAP,			/**< CPU access to VME4L_Map'ed window */
+	MODE_NUM
+} BENCH_MODE;
+
+/** output formats */
+typedef enum {
+	OUT_TXT,
+	OUT_CSV,
+	OUT_JSON
+} BENCH_OUT;
+
+/** one measurement point */
+typedef struct {
+	VME4L_SPACE	spc;
+	vmeaddr_t	vmeAddr;
+	BENCH_MODE	mode;
+	int			doRead;
+	int			accWidth;
+	size_t		size;
+	int			nThreads;
+	int			nOps;
+} BENCH_POINT;
+
+/** per thread data */
+typedef struct {
+	pthread_t	tid;
+	int			idx;			/**< thread number */
+	BENCH_POINT	*pt;
+	uint64_t	*lat;			/**< latency of each operation (ns) */
+	uint64_t	tStart;			/**< time of first operation (ns) */
+	uint64_t	tEnd;			/**< time after last operation (ns) */
+	int			err;			/**< errno of first failure */
+} BENCH_THREAD;
+
+/** results of one measurement point */
+typedef struct {
+	double		mbps;
+	double		min, avg, p50, p99, p999, max;	/* us */
+} BENCH_RESULT;
+
+/*--------------------------------------+
+|   GLOBALS                             |
++--------------------------------------*/
+static const char *G_modeName[MODE_NUM] = {
+	"pio", "blk", "dma", "pin", "mmap"
+};
+static pthread_barrier_t G_barrier;
+static int G_points;			/* results printed so far */
+
+/**********************************************************************/
+static void usage(int excode)
+{
+	printf("Syntax:   vme4l_bench [<opts>] <vmeaddr> [<opts>]\n");
+	printf("Function: VME4L throughput and latency benchmark\n");
+	printf("Options:\n\n");
+	printf("-s=<spc>          VME4L space number                       [0]\n");
+	printf("-m=<mode,..>      transfer modes: pio,blk,dma,pin,mmap      [pio]\n");
+	printf("-a=<width,..>     access widths in bytes (1/2/4/8)         [4]\n");
+	printf("-z=<min>[:<max>]  transfer size(s), doubled from min to max [0x100]\n");
+	printf("-t=<n,..>         number of concurrent threads             [1]\n");
+	printf("                  (each thread uses the next <size> bytes)\n");
+	printf("-n=<ops>          operations per thread and point          [1000]\n");
+	printf("-r                read from VME space (default)\n");
+	printf("-w                write to VME space (with -r: both)\n");
+	printf("-o=<fmt>          output format: txt, csv or json          [txt]\n");
+	printf("\nExample: vme4l_bench -s=10 -m=pio,dma -z=0x100:0x100000 -r -w "
+		   "-o=csv 0x80000000\n");
+	exit(excode);
+}
+
+static void SigHandler( int sigNum )
+{
+	fprintf(stderr, "Signal \"%s\" (%d) received\n", strsignal(sigNum),
+			sigNum);
+	exit(1);
+}
+
+/**********************************************************************/
+/** Get time from raw monotonic clock
+ *
+ * \return time in ns
+ */
+static uint64_t NowNs( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC_RAW, &ts );
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**********************************************************************/
+/** Parse comma separated list of numbers
+ *
+ * \param str		option string
+ * \param list		(OUT) values
+ * \return number of values
+ */
+static int ParseList( const char *str, int *list )
+{
+	int n = 0;
+	char *end;
+
+	while( *str && n < MAX_LIST ){
+		list[n++] = strtol( str, &end, 0 );
+		if( *end != ',' )
+			break;
+		str = end + 1;
+	}
+	return n;
+}
+
+/**********************************************************************/
+/** Parse comma separated list of mode names
+ *
+ * \param str		option string
+ * \param list		(OUT) modes
+ * \return number of modes, -1 on unknown mode
+ */
+static int ParseModes( const char *str, int *list )
+{
+	int n = 0, m;
+	size_t len;
+
+	while( *str && n < MAX_LIST ){
+		len = strcspn( str, "," );
+		for( m=0; m<MODE_NUM; m++ )
+			if( strlen(G_modeName[m]) == len &&
+				!strncmp( str, G_modeName[m], len ))
+				break;
+		if( m == MODE_NUM )
+			return -1;
+		list[n++] = m;
+		str += len;
+		if( *str == ',' )
+			str++;
+	}
+	return n;
+}
+
+/**********************************************************************/
+/** Copy between buffer and mapped VME window with given access width
+ *
+ * \param dst		destination
+ * \param src		source
+ * \param size		number of bytes (multiple of accWidth)
+ * \param accWidth	access width
+ */
+#define COPY_XX(size,type) \
+static void Copy##size( volatile type *dst, volatile type *src, size_t n )\
+{\
+	for( n /= sizeof(type); n > 0; n-- )\
+		*dst++ = *src++;\
+}
+
+COPY_XX(  8, uint8_t  )
+COPY_XX( 16, uint16_t )
+COPY_XX( 32, uint32_t )
+COPY_XX( 64, uint64_t )
+
+static void CopyMapped( void *dst, void *src, size_t size, int accWidth )
+{
+	switch( accWidth ){
+	case 1:	Copy8( dst, src, size ); break;
+	case 2:	Copy16( dst, src, size ); break;
+	case 8:	Copy64( dst, src, size ); break;
+	default: Copy32( dst, src, size ); break;
+	}
+}
+
+/**********************************************************************/
+/** Benchmark thread
+ *
+ * Sets up the transfer, waits for all threads and performs nOps timed
+ * operations.
+ */
+static void *BenchThread( void *arg )
+{
+	BENCH_THREAD *th = arg;
+	BENCH_POINT *pt = th->pt;
+	vmeaddr_t vmeAddr = pt->vmeAddr + th->idx * pt->size;
+	long pageSize = sysconf( _SC_PAGESIZE );
+	vmeaddr_t mapAddr = vmeAddr & ~(vmeaddr_t)(pageSize - 1);
+	size_t mapSize = pt->size + (vmeAddr - mapAddr);
+	int fd, handle = -1, flags = VME4L_RW_NOFLAGS, i, rv = 0;
+	void *buf = NULL, *map = NULL, *vaddr = NULL;
+	uint64_t t;
+
+	th->err = 0;
+
+	if( (fd = VME4L_Open( pt->spc )) < 0 ){
+		th->err = errno;
+		pthread_barrier_wait( &G_barrier );
+		return NULL;
+	}
+
+	if( posix_memalign( &buf, pageSize, pt->size ) != 0 ){
+		th->err = ENOMEM;
+		goto SYNC;
+	}
+	for( i=0; i<pt->size; i++ )
+		((uint8_t *)buf)[i] = i;
+
+	switch( pt->mode ){
+	case MODE_BLK:
+		flags = VME4L_RW_PIO_BLOCK;
+		break;
+	case MODE_DMA:
+		flags = VME4L_RW_USE_SGL_DMA;
+		break;
+	case MODE_PIN:
+		if( (handle = VME4L_PinBufRegister( fd, buf, pt->size )) < 0 )
+			th->err = errno;
+		break;
+	case MODE_MMAP:
+		if( VME4L_Map( fd, mapAddr, mapSize, &map ) < 0 )
+			th->err = errno;
+		else
+			vaddr = (char *)map + (vmeAddr - mapAddr);
+		break;
+	default:
+		break;
+	}
+
+ SYNC:
+	/* all threads start together */
+	pthread_barrier_wait( &G_barrier );
+	if( th->err )
+		goto CLEANUP;
+
+	th->tStart = NowNs();
+
+	for( i=0; i<pt->nOps && rv >= 0; i++ ){
+		t = NowNs();
+
+		switch( pt->mode ){
+		case MODE_PIN:
+			rv = pt->doRead ?
+				VME4L_ReadPinned( fd, vmeAddr, handle, 0, pt->size, 0 ) :
+				VME4L_WritePinned( fd, vmeAddr, handle, 0, pt->size, 0 );
+			break;
+		case MODE_MMAP:
+			if( pt->doRead )
+				CopyMapped( buf, vaddr, pt->size, pt->accWidth );
+			else
+				CopyMapped( vaddr, buf, pt->size, pt->accWidth );
+			break;
+		default:
+			rv = pt->doRead ?
+				VME4L_Read( fd, vmeAddr, pt->accWidth, pt->size, buf, flags ) :
+				VME4L_Write( fd, vmeAddr, pt->accWidth, pt->size, buf, flags );
+			break;
+		}
+
+		th->lat[i] = NowNs() - t;
+	}
+
+	th->tEnd = NowNs();
+	if( rv < 0 )
+		th->err = errno;
+
+ CLEANUP:
+	if( map )
+		VME4L_UnMap( fd, map, mapSize );
+	if( handle >= 0 )
+		VME4L_PinBufUnregister( fd, handle );
+	free( buf );
+	VME4L_Close( fd );
+	return NULL;
+}
+
+static int CmpU64( const void *a, const void *b )
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/**********************************************************************/
+/** Run one measurement point
+ *
+ * \param pt		measurement point
+ * \param res		(OUT) results
+ * \return 0 on success, errno of failing thread otherwise
+ */
+static int RunPoint( BENCH_POINT *pt, BENCH_RESULT *res )
+{
+	BENCH_THREAD th[MAX_LIST * 16];
+	uint64_t *lat, tStart = UINT64_MAX, tEnd = 0, sum = 0;
+	size_t nLat = (size_t)pt->nThreads * pt->nOps, i;
+	int t, err = 0;
+
+	if( pt->nThreads > sizeof(th)/sizeof(th[0]) )
+		return EINVAL;
+
+	if( (lat = malloc( nLat * sizeof(*lat) )) == NULL )
+		return ENOMEM;
+
+	pthread_barrier_init( &G_barrier, NULL, pt->nThreads );
+
+	for( t=0; t<pt->nThreads; t++ ){
+		th[t].idx = t;
+		th[t].pt  = pt;
+		th[t].lat = lat + (size_t)t * pt->nOps;
+		if( pthread_create( &th[t].tid, NULL, BenchThread, &th[t] ) != 0 ){
+			fprintf( stderr, "*** cannot create thread\n" );
+			exit(1);
+		}
+	}
+
+	for( t=0; t<pt->nThreads; t++ ){
+		pthread_join( th[t].tid, NULL );
+		if( th[t].err && !err )
+			err = th[t].err;
+		if( th[t].tStart < tStart )
+			tStart = th[t].tStart;
+		if( th[t].tEnd > tEnd )
+			tEnd = th[t].tEnd;
+	}
+
+	pthread_barrier_destroy( &G_barrier );
+
+	if( err == 0 ){
+		qsort( lat, nLat, sizeof(*lat), CmpU64 );
+		for( i=0; i<nLat; i++ )
+			sum += lat[i];
+
+		res->mbps = ((double)pt->size * nLat / _1MB) /
+			((double)(tEnd - tStart) / 1E9);
+		res->min  = lat[0] / 1E3;
+		res->avg  = (double)sum / nLat / 1E3;
+		res->p50  = lat[(size_t)(0.5 * (nLat - 1))] / 1E3;
+		res->p99  = lat[(size_t)(0.99 * (nLat - 1))] / 1E3;
+		res->p999 = lat[(size_t)(0.999 * (nLat - 1))] / 1E3;
+		res->max  = lat[nLat - 1] / 1E3;
+	}
+
+	free( lat );
+	return err;
+}
+
+/**********************************************************************/
+/** Print result of one measurement point
+ */
+static void PrintResult( BENCH_OUT out, BENCH_POINT *pt, BENCH_RESULT *res )
+{
+	const char *dir = pt->doRead ? "read" : "write";
+
+	switch( out ){
+	case OUT_CSV:
+		if( G_points == 0 )
+			printf("mode,dir,space,width,size,threads,ops,mbps,"
+				   "lat_min_us,lat_avg_us,lat_p50_us,lat_p99_us,"
+				   "lat_p999_us,lat_max_us\n");
+		printf("%s,%s,%d,%d,%lu,%d,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n",
+			   G_modeName[pt->mode], dir, pt->spc, pt->accWidth,
+			   (unsigned long)pt->size, pt->nThreads, pt->nOps, res->mbps,
+			   res->min, res->avg, res->p50, res->p99, res->p999, res->max);
+		break;
+	case OUT_JSON:
+		printf("%s  {\"mode\": \"%s\", \"dir\": \"%s\", \"space\": %d, "
+			   "\"width\": %d, \"size\": %lu, \"threads\": %d, \"ops\": %d, "
+			   "\"mbps\": %.3f, \"lat_us\": {\"min\": %.3f, \"avg\": %.3f, "
+			   "\"p50\": %.3f, \"p99\": %.3f, \"p999\": %.3f, \"max\": %.3f}}",
+			   G_points ? ",\n" : "",
+			   G_modeName[pt->mode], dir, pt->spc, pt->accWidth,
+			   (unsigned long)pt->size, pt->nThreads, pt->nOps, res->mbps,
+			   res->min, res->avg, res->p50, res->p99, res->p999, res->max);
+		break;
+	default:
+		if( G_points == 0 )
+			printf("%-4s %-5s %2s %9s %3s %10s %10s %10s %10s %10s\n",
+				   "mode", "dir", "w", "size", "thr", "MB/s", "p50[us]",
+				   "p99[us]", "p99.9[us]", "max[us]");
+		printf("%-4s %-5s %2d %9lx %3d %7.3f MB/s %10.3f %10.3f %10.3f "
+			   "%10.3f\n", G_modeName[pt->mode], dir, pt->accWidth,
+			   (unsigned long)pt->size, pt->nThreads, res->mbps, res->p50,
+			   res->p99, res->p999, res->max);
+		break;
+	}
+	fflush( stdout );
+	G_points++;
+}
+
+/**********************************************************************/
+/** Program entry point
+ *
+ * \return 0 if all points were measured, 1 otherwise
+ */
+int main( int argc, char *argv[] )
+{
+	int modes[MAX_LIST] = { MODE_PIO }, nModes = 1;
+	int widths[MAX_LIST] = { 4 }, nWidths = 1;
+	int threads[MAX_LIST] = { 1 }, nThreads = 1;
+	int dirs[2], nDirs = 0;
+	size_t minSize = 0x100, maxSize;
+	BENCH_OUT out = OUT_TXT;
+	BENCH_POINT pt;
+	BENCH_RESULT res;
+	char *optp, *end;
+	int i, m, w, t, d, err, fails = 0, haveAddr = 0;
+
+	memset( &pt, 0, sizeof(pt) );
+	pt.nOps = 1000;
+
+	if( UTL_TSTOPT("?") || UTL_TSTOPT("h") || (argc == 1) )
+		usage(0);
+
+	for( i=1; i<argc; i++ )
+		if( *argv[i] != '-' ){
+			pt.vmeAddr = strtoull( argv[i], NULL, 0 );
+			haveAddr = 1;
+		}
+	if( !haveAddr )
+		usage(1);
+
+	if( (optp = UTL_TSTOPT("s=")) )
+		pt.spc = strtoul( optp, NULL, 0 );
+	if( (optp = UTL_TSTOPT("m=")) && (nModes = ParseModes( optp, modes )) <= 0 )
+		usage(1);
+	if( (optp = UTL_TSTOPT("a=")) && (nWidths = ParseList( optp, widths )) <= 0 )
+		usage(1);
+	if( (optp = UTL_TSTOPT("t=")) && (nThreads = ParseList( optp, threads )) <= 0 )
+		usage(1);
+	if( (optp = UTL_TSTOPT("n=")) )
+		pt.nOps = strtoul( optp, NULL, 0 );
+	if( (optp = UTL_TSTOPT("z=")) )
+		minSize = strtoul( optp, &end, 0 );
+	else
+		end = "";
+	maxSize = (*end == ':') ? strtoul( end+1, NULL, 0 ) : minSize;
+
+	if( UTL_TSTOPT("r") || !UTL_TSTOPT("w") )
+		dirs[nDirs++] = 1;
+	if( UTL_TSTOPT("w") )
+		dirs[nDirs++] = 0;
+
+	if( (optp = UTL_TSTOPT("o=")) ){
+		if( !strcmp( optp, "csv" ))
+			out = OUT_CSV;
+		else if( !strcmp( optp, "json" ))
+			out = OUT_JSON;
+		else if( strcmp( optp, "txt" ))
+			usage(1);
+	}
+
+	if( minSize == 0 || maxSize < minSize || pt.nOps <= 0 )
+		usage(1);
+
+	signal( SIGBUS, SigHandler ); /* bus error on mapped window */
+
+	if( out == OUT_TXT )
+		printf("Space %s, VME address 0x%llx\n", VME4L_SpaceName(pt.spc),
+			   (unsigned long long)pt.vmeAddr );
+	else if( out == OUT_JSON )
+		printf("{\"space_name\": \"%s\", \"vme_addr\": %llu, \"results\": [\n",
+			   VME4L_SpaceName(pt.spc), (unsigned long long)pt.vmeAddr );
+
+	for( m=0; m<nModes; m++ )
+		for( d=0; d<nDirs; d++ )
+			for( w=0; w<nWidths; w++ )
+				for( t=0; t<nThreads; t++ )
+					for( pt.size = minSize; pt.size <= maxSize; pt.size *= 2 ){
+						pt.mode		= modes[m];
+						pt.doRead	= dirs[d];
+						pt.accWidth = widths[w];
+						pt.nThreads = threads[t];
+
+						if( pt.size % pt.accWidth || pt.nThreads < 1 )
+							continue;
+
+						if( (err = RunPoint( &pt, &res )) != 0 ){
+							fprintf( stderr, "*** %s %s w=%d size=0x%lx "
+									 "threads=%d failed: %s\n",
+									 G_modeName[pt.mode],
+									 pt.doRead ? "read" : "write",
+									 pt.accWidth, (unsigned long)pt.size,
+									 pt.nThreads, strerror(err) );
+							fails++;
+							continue;
+						}
+						PrintResult( out, &pt, &res );
+					}
+
+	if( out == OUT_JSON )
+		printf("\n]}\n");
+
+	return fails ? 1 : 0;
+}